@@ -911,6 +911,11 @@ namespace Mapper
     {
         private delegate void HandlerDelegate(IntPtr sig, int evt, UInt64 instanceId, int length,
                                               int type, IntPtr value, long time);
+
+        // Handler receiving a read-only view of the value held by libmapper. The Signal and Time
+        // objects are reused for every update, and the span and time are only valid during the call.
+        public delegate void SpanHandler<T>(Signal signal, Event evt, UInt64 instanceId,
+                                            ReadOnlySpan<T> value, Time time) where T : unmanaged;
         [Flags]
         public enum Event
         {
@@ -943,7 +948,10 @@ namespace Mapper
             InstancedDouble,
             InstancedIntVector,
             InstancedFloatVector,
-            InstancedDoubleVector
+            InstancedDoubleVector,
+            SpanInt,
+            SpanFloat,
+            SpanDouble
         }
 
         public Signal()
@@ -1003,6 +1011,27 @@ namespace Mapper
                 mpr_sig_set_value(this._obj, instanceId, value.Length, (int)Type.Double, (void*)intPtr);
             }
         }
+        unsafe private void _SetValue(ReadOnlySpan<int> value, UInt64 instanceId)
+        {
+            fixed(int* temp = value)
+            {
+                mpr_sig_set_value(this._obj, instanceId, value.Length, (int)Type.Int32, temp);
+            }
+        }
+        unsafe private void _SetValue(ReadOnlySpan<float> value, UInt64 instanceId)
+        {
+            fixed(float* temp = value)
+            {
+                mpr_sig_set_value(this._obj, instanceId, value.Length, (int)Type.Float, temp);
+            }
+        }
+        unsafe private void _SetValue(ReadOnlySpan<double> value, UInt64 instanceId)
+        {
+            fixed(double* temp = value)
+            {
+                mpr_sig_set_value(this._obj, instanceId, value.Length, (int)Type.Double, temp);
+            }
+        }
 
         public Signal SetValue<T>(T value)
         {
@@ -1011,6 +1040,21 @@ namespace Mapper
             return this;
         }
 
+        // Spans are passed to libmapper without copying or boxing, e.g. from a stackalloc buffer
+        // or a NativeArray.
+        public Signal SetValue(ReadOnlySpan<int> value)
+            { _SetValue(value, 0); return this; }
+        public Signal SetValue(ReadOnlySpan<float> value)
+            { _SetValue(value, 0); return this; }
+        public Signal SetValue(ReadOnlySpan<double> value)
+            { _SetValue(value, 0); return this; }
+        public Signal SetValue(Span<int> value)
+            { _SetValue((ReadOnlySpan<int>)value, 0); return this; }
+        public Signal SetValue(Span<float> value)
+            { _SetValue((ReadOnlySpan<float>)value, 0); return this; }
+        public Signal SetValue(Span<double> value)
+            { _SetValue((ReadOnlySpan<double>)value, 0); return this; }
+
         [DllImport("mapper", CharSet = CharSet.Ansi, CallingConvention = CallingConvention.StdCall)]
         unsafe private static extern void* mpr_sig_get_value(IntPtr sig, UInt64 id, ref long time);
         unsafe public (dynamic, Time) GetValue(UInt64 instanceId = 0)
@@ -1069,6 +1113,19 @@ namespace Mapper
                 return this;
             }
 
+            public new Instance SetValue(ReadOnlySpan<int> value)
+                { _SetValue(value, id); return this; }
+            public new Instance SetValue(ReadOnlySpan<float> value)
+                { _SetValue(value, id); return this; }
+            public new Instance SetValue(ReadOnlySpan<double> value)
+                { _SetValue(value, id); return this; }
+            public new Instance SetValue(Span<int> value)
+                { _SetValue((ReadOnlySpan<int>)value, id); return this; }
+            public new Instance SetValue(Span<float> value)
+                { _SetValue((ReadOnlySpan<float>)value, id); return this; }
+            public new Instance SetValue(Span<double> value)
+                { _SetValue((ReadOnlySpan<double>)value, id); return this; }
+
             [DllImport("mapper", CharSet = CharSet.Ansi, CallingConvention = CallingConvention.StdCall)]
             unsafe private static extern void mpr_sig_release_inst(IntPtr sig, UInt64 id);
             public void Release()
@@ -1228,6 +1285,40 @@ namespace Mapper
             }
         }
 
+        private void _spanHandler(IntPtr sig, int evt, UInt64 inst, int length,
+                                  int type, IntPtr value, long time)
+        {
+            if (value == IntPtr.Zero)
+                length = 0;
+            callbackTime.data.ntp = time;
+            switch (this.handlerType)
+            {
+                case HandlerType.SpanInt:
+                    unsafe
+                    {
+                        this.handlers.spanInt(this, (Event)evt, inst,
+                                              new ReadOnlySpan<int>((void*)value, length), callbackTime);
+                    }
+                    break;
+                case HandlerType.SpanFloat:
+                    unsafe
+                    {
+                        this.handlers.spanFloat(this, (Event)evt, inst,
+                                                new ReadOnlySpan<float>((void*)value, length), callbackTime);
+                    }
+                    break;
+                case HandlerType.SpanDouble:
+                    unsafe
+                    {
+                        this.handlers.spanDouble(this, (Event)evt, inst,
+                                                 new ReadOnlySpan<double>((void*)value, length), callbackTime);
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+
         ~Signal()
             {}
 
@@ -1339,6 +1430,33 @@ namespace Mapper
             return true;
         }
 
+        private Boolean _SetCallback(SpanHandler<int> h, int type)
+        {
+            if (type != (int)Type.Int32)
+                return false;
+            handlerType = HandlerType.SpanInt;
+            handlers.spanInt = h;
+            return true;
+        }
+
+        private Boolean _SetCallback(SpanHandler<float> h, int type)
+        {
+            if (type != (int)Type.Float)
+                return false;
+            handlerType = HandlerType.SpanFloat;
+            handlers.spanFloat = h;
+            return true;
+        }
+
+        private Boolean _SetCallback(SpanHandler<double> h, int type)
+        {
+            if (type != (int)Type.Double)
+                return false;
+            handlerType = HandlerType.SpanDouble;
+            handlers.spanDouble = h;
+            return true;
+        }
+
         public Signal SetCallback<T>(T handler, Event events = Event.All)
         {
             dynamic temp = handler;
@@ -1348,12 +1466,33 @@ namespace Mapper
                 Console.WriteLine("error: wrong data type in signal handler.");
                 return this;
             }
-            mpr_sig_set_cb(this._obj,
-                           Marshal.GetFunctionPointerForDelegate(new HandlerDelegate(_handler)),
+            // keep a reference to the delegate so it is not collected while libmapper uses it
+            if (handlerType >= HandlerType.SpanInt)
+            {
+                callbackTime = callbackTime ?? new Time();
+                handlerDelegate = new HandlerDelegate(_spanHandler);
+            }
+            else
+                handlerDelegate = new HandlerDelegate(_handler);
+            mpr_sig_set_cb(this._obj, Marshal.GetFunctionPointerForDelegate(handlerDelegate),
                            (int)events);
             return this;
         }
 
+#if NET5_0_OR_GREATER || UNITY_2021_2_OR_NEWER
+        // Call an unmanaged function, e.g. a static method marked [UnmanagedCallersOnly], directly
+        // from libmapper without marshalling. Its arguments are the signal, event, instance id,
+        // vector length, data type, a pointer to the value and the NTP time of the update.
+        unsafe public Signal SetCallback(delegate* unmanaged[Cdecl]<IntPtr, int, UInt64, int, byte, IntPtr, long, void> handler,
+                                         Event events = Event.All)
+        {
+            handlerType = HandlerType.None;
+            handlerDelegate = null;
+            mpr_sig_set_cb(this._obj, (IntPtr)handler, (int)events);
+            return this;
+        }
+#endif
+
         public new Signal SetProperty<P, T>(P property, T value)
         {
             base.SetProperty(property, value);
@@ -1400,9 +1539,17 @@ namespace Mapper
             internal Action<Signal.Instance, Signal.Event, float[], Time> instancedFloatVector;
             [FieldOffset(0)]
             internal Action<Signal.Instance, Signal.Event, double[], Time> instancedDoubleVector;
+            [FieldOffset(0)]
+            internal SpanHandler<int> spanInt;
+            [FieldOffset(0)]
+            internal SpanHandler<float> spanFloat;
+            [FieldOffset(0)]
+            internal SpanHandler<double> spanDouble;
         }
         private Handlers handlers;
         private HandlerType handlerType = HandlerType.None;
+        private HandlerDelegate handlerDelegate;
+        private Time callbackTime;
     }
 
     public class Device : Object
@@ -1456,6 +1603,49 @@ namespace Mapper
             return this;
         }
 
+        [DllImport("mapper", CharSet = CharSet.Ansi, CallingConvention = CallingConvention.StdCall)]
+        unsafe private static extern int mpr_dev_set_values(IntPtr dev, int num_sigs, IntPtr* sigs,
+                                                            UInt64* ids, int len, int type, void* vals);
+        private const int MaxStackSignals = 128;
+        unsafe private int _SetValues(Signal[] signals, UInt64[] instanceIds, int len, Type type, void* vals)
+        {
+            // the native code reads one instance id for each signal
+            if (signals == null || (instanceIds != null && instanceIds.Length < signals.Length))
+                return 0;
+            // keep stack use bounded for long signal arrays
+            Span<IntPtr> sigs = signals.Length <= MaxStackSignals
+                              ? stackalloc IntPtr[signals.Length] : new IntPtr[signals.Length];
+            for (int i = 0; i < signals.Length; i++)
+                sigs[i] = signals[i]._obj;
+            fixed (IntPtr* sigPtrs = sigs)
+            fixed (UInt64* ids = instanceIds)
+            {
+                return mpr_dev_set_values(this._obj, signals.Length, sigPtrs, ids, len, (int)type, vals);
+            }
+        }
+        // update many local signals at once, the vector of each signal following that of the previous one
+        unsafe public int SetValues(Signal[] signals, int[] values, UInt64[] instanceIds = null)
+        {
+            fixed (int* vals = values)
+            {
+                return _SetValues(signals, instanceIds, values.Length, Type.Int32, vals);
+            }
+        }
+        unsafe public int SetValues(Signal[] signals, float[] values, UInt64[] instanceIds = null)
+        {
+            fixed (float* vals = values)
+            {
+                return _SetValues(signals, instanceIds, values.Length, Type.Float, vals);
+            }
+        }
+        unsafe public int SetValues(Signal[] signals, double[] values, UInt64[] instanceIds = null)
+        {
+            fixed (double* vals = values)
+            {
+                return _SetValues(signals, instanceIds, values.Length, Type.Double, vals);
+            }
+        }
+
         [DllImport("mapper", CharSet = CharSet.Ansi, CallingConvention = CallingConvention.StdCall)]
         private static extern IntPtr mpr_sig_new(IntPtr dev, int direction,
                                                  [MarshalAs(UnmanagedType.LPStr)] string name,
@@ -9,6 +9,12 @@ public class TestVector
         Console.WriteLine("Signal received value [" + String.Join(",", value) + "]");
     }
 
+    private static void SpanHandler(Signal sig, Mapper.Signal.Event evt, UInt64 instanceId,
+                                    ReadOnlySpan<float> value, Time time)
+    {
+        Console.WriteLine("Signal received span [" + String.Join(",", value.ToArray()) + "]");
+    }
+
     public static void Main(string[] args)
     {
         Device dev = new Device("csharp.testvector");
@@ -24,6 +30,12 @@ public class TestVector
                                        Mapper.Signal.Event.Update);
         Console.WriteLine("created Signal insig");
 
+        // values are delivered to this handler without copying
+        Signal spansig = dev.AddSignal(Direction.Incoming, "spansig", 4, Mapper.Type.Float)
+                            .SetCallback((Signal.SpanHandler<float>)SpanHandler,
+                                         Mapper.Signal.Event.Update);
+        Console.WriteLine("created Signal spansig");
+
         Console.Write("Waiting for Device...");
         while (dev.GetIsReady() == 0)
         {
@@ -33,9 +45,11 @@ public class TestVector
 
         Map map = new Map(outsig, insig);
         map.Push();
+        Map spanmap = new Map(outsig, spansig);
+        spanmap.Push();
 
         Console.Write("Waiting for Map...");
-        while (map.GetIsReady() == 0)
+        while (map.GetIsReady() == 0 || spanmap.GetIsReady() == 0)
         {
             dev.Poll(25);
         }
@@ -45,7 +59,10 @@ public class TestVector
         int counter = 0;
         while (++counter < 100)
         {
-            outsig.SetValue(sig_val);
+            if ((counter % 2) == 0)
+                outsig.SetValue(sig_val);
+            else
+                outsig.SetValue(new ReadOnlySpan<float>(sig_val));
             dev.Poll(100);
             for (int i = 0; i < 4; i++)
                 sig_val[i] *= 1.1F;
@@ -1,22 +1,42 @@
 #!/usr/bin/env python
 
 from __future__ import print_function
-import sys, random, libmapper as mpr
+import sys, time, random, libmapper as mpr
 
 try:
-    import numpy23b as np
+    import numpy as np
 except:
     print('this test requires numpy, quitting now')
     quit()
 
+VEC_LEN = 512
+NUM_UPDATES = 200
+
+received = 0
+errors = 0
+
 def h(sig, event, id, val, time):
     print('  handler got', sig['name'], '=', type(val), val, 'at time', time.get_double())
 
+def h_view(sig, event, id, val, time):
+    global received, errors
+    # views wrap the signal value rather than owning a copy of it
+    if not isinstance(val, np.ndarray) or val.flags.writeable or val.flags.owndata:
+        errors += 1
+    elif len(val) != VEC_LEN:
+        errors += 1
+    elif val[1] - val[0] != 1:
+        errors += 1
+    received += 1
+
 src = mpr.Device("py.testnumpy.src")
 outsig = src.add_signal(mpr.Direction.OUTGOING, "outsig", 10, mpr.Type.NP_INT32, None, 0, 1)
+vecout = src.add_signal(mpr.Direction.OUTGOING, "vecout", VEC_LEN, mpr.Type.NP_FLOAT, None, 0, 1)
 
 dest = mpr.Device("py.testnumpy.dst")
 insig = dest.add_signal(mpr.Direction.INCOMING, "insig", 10, mpr.Type.NP_FLOAT, None, 0, np.array([1,2,3]), None, h)
+vecin = dest.add_signal(mpr.Direction.INCOMING, "vecin", VEC_LEN, mpr.Type.NP_FLOAT, None, 0, 1)
+vecin.set_callback(h_view, mpr.Signal.Event.UPDATE, copy=False)
 
 print("insig properties:")
 print("  type:", insig['type'])
@@ -31,8 +51,10 @@ while not src.ready or not dest.ready:
 
 map = mpr.Map(outsig, insig)
 map.push()
+vecmap = mpr.Map(vecout, vecin)
+vecmap.push()
 
-while not map.ready:
+while not map.ready or not vecmap.ready:
     src.poll(10)
     dest.poll(10)
 
@@ -41,6 +63,46 @@ for i in range(100):
     dest.poll(10)
     src.poll(0)
 
+# contiguous float32 arrays are passed to libmapper without copying, so set_value() must not
+# convert them; other arrays are converted with np.ascontiguousarray()
+conversions = 0
+ascontiguousarray = np.ascontiguousarray
+def counting_ascontiguousarray(*args, **kwargs):
+    global conversions
+    conversions += 1
+    return ascontiguousarray(*args, **kwargs)
+np.ascontiguousarray = counting_ascontiguousarray
+
+vec = np.arange(VEC_LEN, dtype=np.float32)
+for i in range(1000):
+    vec[0] = i
+    vecout.set_value(vec)
+assert conversions == 0, 'set_value() copied a contiguous float32 array'
+vecout.set_value(np.arange(VEC_LEN, dtype=np.float64)[::-1])
+assert conversions == 1, 'set_value() did not convert a float64 array'
+np.ascontiguousarray = ascontiguousarray
+vecout.set_value(vec)
+
+val, t = vecout.get_value()
+assert isinstance(val, np.ndarray) and len(val) == VEC_LEN and val[0] == 999
+
+# every update should be delivered to the callback as a read-only view
+src.poll(0)
+while dest.poll(0):
+    pass
+vec[0] = vec[1] - 1
+received = errors = 0
+start = time.perf_counter()
+for i in range(NUM_UPDATES):
+    vec += 1
+    vecout.set_value(vec)
+    src.poll(0)
+    deadline = time.perf_counter() + 1.0
+    while received <= i and time.perf_counter() < deadline:
+        dest.poll(1)
+elapsed = (time.perf_counter() - start) / NUM_UPDATES
+print('received', received, 'of', NUM_UPDATES, 'read-only views,', elapsed * 1e3, 'ms per update')
+assert received == NUM_UPDATES and errors == 0, 'callback did not receive read-only numpy views'
+
 src.free()
 dest.free()
-
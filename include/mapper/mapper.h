@@ -246,6 +246,90 @@ int mpr_dev_start_polling(mpr_dev device);
  *  \return             Zero if successful, less than zero otherwise. */
 int mpr_dev_stop_polling(mpr_dev device);
 
+/*! Share a fixed number of polling threads between all devices in this process instead of
+ *  starting one thread per device in mpr_dev_start_polling(). Each thread is pinned to a CPU
+ *  where supported, and devices belonging to the same graph are polled by the same thread.
+ *  Must be called while no devices are being polled.
+ *  \param num_threads  The number of shared threads, or 0 to use one thread per device (the
+ *                      default).
+ *  \return             Zero if successful, less than zero otherwise. */
+int mpr_set_poll_threads(int num_threads);
+
+/*! Evaluate the expressions of updated maps on several threads at once. Messages are still
+ *  queued and signal handlers called by the polling thread, in the same order as when maps are
+ *  evaluated serially. Must not be called while the device is being polled.
+ *  \param device       The device.
+ *  \param num_threads  The number of threads to use including the polling thread, or 0 or 1 to
+ *                      evaluate maps on the polling thread only (the default).
+ *  \return             Zero if successful, less than zero otherwise. */
+int mpr_dev_set_eval_threads(mpr_dev device, int num_threads);
+
+/*! Count runtime statistics for a device and its links and maps. The counters are exposed as
+ *  the read-only MPR_INT64 vector property "@stats" of each object and are published to
+ *  subscribers every few seconds. For devices they are the numbers of signal updates received
+ *  and sent, received updates dropped or arriving out of order, instances stolen, and bundles
+ *  and bytes sent. For maps they are the numbers of source updates received, destination
+ *  updates sent and expression evaluations, the total evaluation time in nanoseconds, and a
+ *  histogram of evaluation times with bins of under 1, 4, 16, 64, 256, 1024 and 4096
+ *  microseconds and longer. For links they are the numbers of messages, bundles and bytes
+ *  sent. Counting has almost no cost while disabled, the default.
+ *  \param device       The device.
+ *  \param enable       Non-zero to start counting from zero, or zero to stop.
+ *  \return             Zero if successful, less than zero otherwise. */
+int mpr_dev_set_stats(mpr_dev device, int enable);
+
+/*! Trace signal updates through chains of maps to measure their latency. A device with tracing
+ *  enabled appends a trace id and the time of the originating update to the messages sent for
+ *  each signal update, and passes received traces on to the updates they cause if those are
+ *  sent by maps. Received traces are recorded in the read-only MPR_INT64 vector property
+ *  "@latency" of the device, which is published to subscribers every few seconds. It holds the
+ *  number of traced updates received, the total latency in microseconds since the originating
+ *  update and since the update was sent by the previous device, and histograms of both latencies
+ *  with bins of under 10, 40, 160 and 640 microseconds, 2.56, 10.24, 40.96, 163.84 and 655.36
+ *  milliseconds and longer. Latencies are corrected for the clock offset of each link. Traces
+ *  are only passed on by devices with tracing enabled, and peers running older versions of
+ *  libmapper will discard traced updates.
+ *  \param device       The device.
+ *  \param enable       Non-zero to start tracing, or zero to stop.
+ *  \return             Zero if successful, less than zero otherwise. */
+int mpr_dev_set_tracing(mpr_dev device, int enable);
+
+/*! Register a device quickly. Normally a device waits at least two seconds after probing its
+ *  name on the bus before locking its ordinal. With fast registration the ordinal is locked once
+ *  the probe has been seen on the bus for 100 milliseconds without any collision. If a cache file
+ *  is given, the ordinals of registered devices are stored in it by name and probed first by
+ *  devices with the same name, so that restarted devices usually keep their previous names.
+ *  Probes from devices created in a row are sent together in a single bundle. Devices holding a
+ *  name only answer probes while they are polled, so devices that are polled less often than
+ *  every 100 milliseconds may end up sharing a name with a device registered this way. Must be
+ *  called before the device is registered, typically right after mpr_dev_new().
+ *  \param device       The device.
+ *  \param cache_path   A file for storing ordinals, or NULL to only lock ordinals early.
+ *  \return             Zero if successful, less than zero otherwise. */
+int mpr_dev_set_fast_registration(mpr_dev device, const char *cache_path);
+
+/*! Retrieve the sockets used by this device so that it can be driven by an external event loop
+ *  instead of mpr_dev_poll(). Call mpr_dev_on_readable() when any of them is readable or when the
+ *  timeout from mpr_dev_get_timeout() has elapsed. The set of sockets may change, e.g. once the
+ *  device is registered, so it should be retrieved again after each call to mpr_dev_on_readable().
+ *  \param device       The device to query.
+ *  \param fds          An array to fill with file descriptors, or NULL to query the number.
+ *  \param num          The size of the fds array.
+ *  \return             The number of sockets in use, which may exceed num. */
+int mpr_dev_get_fds(mpr_dev device, int *fds, int num);
+
+/*! Get the longest time an external event loop may wait before calling mpr_dev_on_readable() if
+ *  none of the sockets from mpr_dev_get_fds() become readable.
+ *  \param device       The device to query.
+ *  \return             The timeout in milliseconds, or 0 if there is work to do now. */
+int mpr_dev_get_timeout(mpr_dev device);
+
+/*! Process any messages that are ready on the sockets of this device without blocking, send any
+ *  updated signals, and perform periodic tasks if they are due.
+ *  \param device       The device to process.
+ *  \return             The number of handled messages. */
+int mpr_dev_on_readable(mpr_dev device);
+
 /*! Detect whether a device is completely initialized.
  *  \param device       The device to query.
  *  \return             Non-zero if device is completely initialized, i.e., has an allocated
@@ -270,6 +354,23 @@ void mpr_dev_set_time(mpr_dev device, mpr_time time);
  *  \param device       The device to use. */
 void mpr_dev_update_maps(mpr_dev device);
 
+/*! Update the values of many local signals at once. All updates share a single timestamp and are
+ *  sent together as by mpr_dev_update_maps(), which is much cheaper than calling
+ *  mpr_sig_set_value() for each signal when many signals change at the same time.
+ *  \param device       The local device owning the signals.
+ *  \param num_sigs     The number of signals to update.
+ *  \param sigs         The signals to update.
+ *  \param ids          The instance to update for each signal, or NULL to use instance 0 of
+ *                      every signal.
+ *  \param len          The total number of values, which must be at least the sum of the signal
+ *                      lengths.
+ *  \param type         The data type of the values.
+ *  \param values       The new values, the vector of each signal following that of the previous
+ *                      one. Values containing NaN are ignored as by mpr_sig_set_value().
+ *  \return             The number of signals updated. */
+int mpr_dev_set_values(mpr_dev device, int num_sigs, mpr_sig *sigs, mpr_id *ids, int len,
+                       mpr_type type, const void *values);
+
 /** @} */ /* end of group Devices */
 
 /*** Signals ***/
@@ -638,6 +739,12 @@ void mpr_graph_set_address(mpr_graph graph, const char *group, int port);
  *                      distributed graph. */
 const char *mpr_graph_get_address(mpr_graph graph);
 
+/*! Set how often linked devices exchange pings to synchronize their clocks. Timetags of updates
+ *  arriving from linked devices are converted to local time using the resulting estimate.
+ *  \param graph        The graph structure to modify.
+ *  \param interval     The average number of seconds between pings, 2 by default. */
+void mpr_graph_set_ping_interval(mpr_graph graph, double interval);
+
 /*! Synchonize a local graph copy with the distributed graph.
  *  \param graph        The graph to update.
  *  \param block_ms     The number of milliseconds to block, or 0 for non-blocking behaviour.
@@ -654,6 +761,29 @@ int mpr_graph_start_polling(mpr_graph graph);
  *  \return             Zero if successful, less than zero otherwise. */
 int mpr_graph_stop_polling(mpr_graph graph);
 
+/*! Retrieve the sockets used by this graph so that it can be synchronized by an external event
+ *  loop instead of mpr_graph_poll(). Call mpr_graph_on_readable() when any of them is readable or
+ *  when the timeout from mpr_graph_get_timeout() has elapsed. The set of sockets may change, e.g.
+ *  when subscribing to devices, so it should be retrieved again after each call to
+ *  mpr_graph_on_readable().
+ *  \param graph        The graph to query.
+ *  \param fds          An array to fill with file descriptors, or NULL to query the number.
+ *  \param num          The size of the fds array.
+ *  \return             The number of sockets in use, which may exceed num. */
+int mpr_graph_get_fds(mpr_graph graph, int *fds, int num);
+
+/*! Get the longest time an external event loop may wait before calling mpr_graph_on_readable()
+ *  if none of the sockets from mpr_graph_get_fds() become readable.
+ *  \param graph        The graph to query.
+ *  \return             The timeout in milliseconds, or 0 if there is work to do now. */
+int mpr_graph_get_timeout(mpr_graph graph);
+
+/*! Process any messages that are ready on the sockets of this graph without blocking, and
+ *  perform periodic tasks if they are due.
+ *  \param graph        The graph to process.
+ *  \return             The number of handled messages. */
+int mpr_graph_on_readable(mpr_graph graph);
+
 /*! Free a graph.
  *  \param graph        The graph to free. */
 void mpr_graph_free(mpr_graph graph);
@@ -709,6 +839,36 @@ void *mpr_graph_remove_cb(mpr_graph graph, mpr_graph_handler *handler, const voi
  *  \return             A list of results.  Use mpr_list_get_next() to iterate. */
 mpr_list mpr_graph_get_list(mpr_graph graph, int types);
 
+/*! Push many new maps at once. Instead of announcing each map on the bus, the definitions of maps
+ *  sharing a destination device are sent to that device in batches, each acknowledged by a single
+ *  message. When a batch is acknowledged the status of each of its maps is updated and graph
+ *  callbacks are called with the event MPR_OBJ_MOD; maps rejected by their destination have the
+ *  status MPR_STATUS_EXPIRED. Maps that are already established or whose destination is a local
+ *  device are pushed individually as by mpr_obj_push().
+ *  \param graph        The graph owning the maps.
+ *  \param num_maps     The number of maps.
+ *  \param maps         The maps to push.
+ *  \return             The number of maps sent in batches. */
+int mpr_graph_push_maps(mpr_graph graph, int num_maps, mpr_map *maps);
+
+/*! Save the maps known to a graph to a session file. The binary format is a compressed bundle of
+ *  the messages that would recreate each map, including its expression, scope, protocol and other
+ *  properties and the properties of its slots. The JSON format holds the same information in a
+ *  form intended to be read by humans and cannot be loaded again.
+ *  \param graph        The graph to save.
+ *  \param path         The path of the file to write.
+ *  \param json         Non-zero to write JSON instead of the binary format.
+ *  \return             The number of maps saved, or -1 if the file could not be written. */
+int mpr_graph_save_session(mpr_graph graph, const char *path, int json);
+
+/*! Load maps from a binary session file written by mpr_graph_save_session(). The maps are staged
+ *  all at once and sent to their destination devices in batches as by mpr_graph_push_maps();
+ *  maps that are already established are skipped.
+ *  \param graph        The graph that will own the maps.
+ *  \param path         The path of the file to read.
+ *  \return             The number of maps staged, or -1 if the file could not be read. */
+int mpr_graph_load_session(mpr_graph graph, const char *path);
+
 /** @} */ /* end of group Graphs */
 
 /***** Time *****/
@@ -752,6 +912,19 @@ void mpr_time_set_dbl(mpr_time *time, double value);
  *  \param timer        The source time. */
 void mpr_time_set(mpr_time *timel, mpr_time timer);
 
+/*! A function that provides the current time.
+ *  \param time         Set to the current time.
+ *  \param data         The user data passed to mpr_set_time_source(). */
+typedef void mpr_time_source(mpr_time *time, void *data);
+
+/*! Replace the clock used for MPR_NOW, e.g. to drive time deterministically in tests and
+ *  simulations. By default a monotonic clock mapped to NTP time when it is first read is used, so
+ *  that timetags do not jump when the system clock is adjusted.
+ *  \param source       The function providing the current time, or NULL to restore the
+ *                      default clock.
+ *  \param data         User data passed to the function. */
+void mpr_set_time_source(mpr_time_source *source, void *data);
+
 /*! Compare two timetags, returning zero if they all match or a value different from zero
  *  representing which is greater if they do not.
  *  \param time1        A previously allocated time to augment.
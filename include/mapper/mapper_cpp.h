@@ -15,6 +15,9 @@
 #include <iterator>
 #include <cstring>
 #include <iostream>
+#if __cplusplus >= 202002L
+#include <span>
+#endif
 
 #ifdef interface
 #undef interface
@@ -46,6 +49,33 @@ namespace mapper {
     class PropVal;
     class Graph;
 
+#if __cplusplus >= 202002L
+    template <typename T>
+    using Span = std::span<T>;
+#else
+    /*! A non-owning view of a contiguous vector of values, used in place of std::span before
+     *  C++20. */
+    template <typename T>
+    class Span
+    {
+    public:
+        Span() : _data(0), _size(0) {}
+        Span(T *data, size_t size) : _data(data), _size(size) {}
+        template <size_t N>
+        Span(T (&data)[N]) : _data(data), _size(N) {}
+
+        T *data() const { return _data; }
+        size_t size() const { return _size; }
+        bool empty() const { return !_size; }
+        T *begin() const { return _data; }
+        T *end() const { return _data + _size; }
+        T& operator [] (size_t idx) const { return _data[idx]; }
+    private:
+        T *_data;
+        size_t _size;
+    };
+#endif
+
     /*! The set of possible datatypes. */
     enum class Type : char
     {
@@ -853,18 +883,28 @@ namespace mapper {
         Signal& _set_value(const T* val)
             { return set_value(val, len); }
         template <typename T, size_t N>
-        Signal& _set_value(std::array<T,N> val)
+        Signal& _set_value(const std::array<T,N>& val)
             { return set_value(&val[0], N); }
         template <typename T>
-        Signal& _set_value(std::vector<T> val)
+        Signal& _set_value(const std::vector<T>& val)
             { return set_value(&val[0], (int)val.size()); }
+#if __cplusplus >= 202002L
+        template <typename T, size_t N>
+        Signal& _set_value(std::span<T, N> val)
+            { return set_value(val.data(), (int)val.size()); }
+#else
+        template <typename T>
+        Signal& _set_value(Span<T> val)
+            { return set_value(val.data(), (int)val.size()); }
+#endif
     public:
-        /*! Set the current value for this Signal.
-         *  \param vals     The value to set. Can be scalar, array, std::array, or std::vector of
-         *                  int, float, or double
+        /*! Set the current value for this Signal. Values are passed to the underlying library
+         *  without being copied.
+         *  \param vals     The value to set. Can be scalar, array, pointer and length,
+         *                  std::array, std::vector, or Span of int, float, or double
          *  \return         Self. */
         template <typename... Values>
-        Signal& set_value(Values... vals)
+        Signal& set_value(const Values&... vals)
             { return _set_value(vals...); }
 
         const void *value() const
@@ -918,18 +958,28 @@ namespace mapper {
             Instance& _set_value(const T* val)
                 { return set_value(val, len); }
             template <typename T, size_t N>
-            Instance& _set_value(std::array<T,N> val)
+            Instance& _set_value(const std::array<T,N>& val)
                 { return set_value(&val[0], N); }
             template <typename T>
-            Instance& _set_value(std::vector<T> val)
-                { return set_value(&val[0], val.size()); }
+            Instance& _set_value(const std::vector<T>& val)
+                { return set_value(&val[0], (int)val.size()); }
+#if __cplusplus >= 202002L
+            template <typename T, size_t N>
+            Instance& _set_value(std::span<T, N> val)
+                { return set_value(val.data(), (int)val.size()); }
+#else
+            template <typename T>
+            Instance& _set_value(Span<T> val)
+                { return set_value(val.data(), (int)val.size()); }
+#endif
         public:
-            /*! Set the current value for this Instance.
-             *  \param vals     The value to set. Can be scalar, array, std::array, or std::vector
-             *                  of int, float, or double
+            /*! Set the current value for this Instance. Values are passed to the underlying
+             *  library without being copied.
+             *  \param vals     The value to set. Can be scalar, array, pointer and length,
+             *                  std::array, std::vector, or Span of int, float, or double
              *  \return         Self. */
             template <typename... Values>
-            Instance& set_value(Values... vals)
+            Instance& set_value(const Values&... vals)
                 { return _set_value(vals...); }
 
             /*! Release this Instance.
@@ -987,7 +1037,13 @@ namespace mapper {
             INST_INT,
             INST_FLT,
             INST_DBL,
-            INST_EVT
+            INST_EVT,
+            SIG_SPAN_INT,
+            SIG_SPAN_FLT,
+            SIG_SPAN_DBL,
+            INST_SPAN_INT,
+            INST_SPAN_FLT,
+            INST_SPAN_DBL
         };
         typedef struct _handler_data {
             union {
@@ -1001,6 +1057,12 @@ namespace mapper {
                 void (*inst_flt)(Signal::Instance&&, Signal::Event, float, Time&&);
                 void (*inst_dbl)(Signal::Instance&&, Signal::Event, double, Time&&);
                 void (*inst_evt)(Signal::Instance&&, Signal::Event, Time&&);
+                void (*sig_span_int)(Signal&&, Span<const int>, Time&&);
+                void (*sig_span_flt)(Signal&&, Span<const float>, Time&&);
+                void (*sig_span_dbl)(Signal&&, Span<const double>, Time&&);
+                void (*inst_span_int)(Signal::Instance&&, Signal::Event, Span<const int>, Time&&);
+                void (*inst_span_flt)(Signal::Instance&&, Signal::Event, Span<const float>, Time&&);
+                void (*inst_span_dbl)(Signal::Instance&&, Signal::Event, Span<const double>, Time&&);
             } handler;
             enum handler_type type;
         } *handler_data;
@@ -1048,10 +1110,44 @@ namespace mapper {
                 case INST_DBL:
                     data->handler.inst_dbl(Signal::Instance(sig, inst), Signal::Event(evt),
                                            val ? *(double*)val : 0, Time(time));
+                    break;
                 case INST_EVT:
                     data->handler.inst_evt(Signal::Instance(sig, inst), Signal::Event(evt),
                                            Time(time));
                     break;
+                case SIG_SPAN_INT:
+                    if (val)
+                        data->handler.sig_span_int(Signal(sig), Span<const int>((const int*)val, len),
+                                                   Time(time));
+                    break;
+                case SIG_SPAN_FLT:
+                    if (val)
+                        data->handler.sig_span_flt(Signal(sig),
+                                                   Span<const float>((const float*)val, len),
+                                                   Time(time));
+                    break;
+                case SIG_SPAN_DBL:
+                    if (val)
+                        data->handler.sig_span_dbl(Signal(sig),
+                                                   Span<const double>((const double*)val, len),
+                                                   Time(time));
+                    break;
+                case INST_SPAN_INT:
+                    data->handler.inst_span_int(Signal::Instance(sig, inst), Signal::Event(evt),
+                                                Span<const int>((const int*)val, val ? len : 0),
+                                                Time(time));
+                    break;
+                case INST_SPAN_FLT:
+                    data->handler.inst_span_flt(Signal::Instance(sig, inst), Signal::Event(evt),
+                                                Span<const float>((const float*)val, val ? len : 0),
+                                                Time(time));
+                    break;
+                case INST_SPAN_DBL:
+                    data->handler.inst_span_dbl(Signal::Instance(sig, inst), Signal::Event(evt),
+                                                Span<const double>((const double*)val,
+                                                                   val ? len : 0),
+                                                Time(time));
+                    break;
                 default:
                     return;
             }
@@ -1146,6 +1242,59 @@ namespace mapper {
             data->type = INST_EVT;
             data->handler.inst_evt = h;
         }
+        bool _check_span_type(handler_data data, mpr_type type)
+        {
+            if (mpr_obj_get_prop_as_int32(_obj, MPR_PROP_TYPE, NULL) == type)
+                return true;
+            printf("wrong type '%c' in handler definition\n", type);
+            data->type = NONE;
+            return false;
+        }
+        void _set_callback(handler_data data, void (*h)(Signal&&, Span<const int>, Time&&))
+        {
+            if (!_check_span_type(data, MPR_INT32))
+                return;
+            data->type = SIG_SPAN_INT;
+            data->handler.sig_span_int = h;
+        }
+        void _set_callback(handler_data data, void (*h)(Signal&&, Span<const float>, Time&&))
+        {
+            if (!_check_span_type(data, MPR_FLT))
+                return;
+            data->type = SIG_SPAN_FLT;
+            data->handler.sig_span_flt = h;
+        }
+        void _set_callback(handler_data data, void (*h)(Signal&&, Span<const double>, Time&&))
+        {
+            if (!_check_span_type(data, MPR_DBL))
+                return;
+            data->type = SIG_SPAN_DBL;
+            data->handler.sig_span_dbl = h;
+        }
+        void _set_callback(handler_data data,
+                           void (*h)(Signal::Instance&&, Signal::Event, Span<const int>, Time&&))
+        {
+            if (!_check_span_type(data, MPR_INT32))
+                return;
+            data->type = INST_SPAN_INT;
+            data->handler.inst_span_int = h;
+        }
+        void _set_callback(handler_data data,
+                           void (*h)(Signal::Instance&&, Signal::Event, Span<const float>, Time&&))
+        {
+            if (!_check_span_type(data, MPR_FLT))
+                return;
+            data->type = INST_SPAN_FLT;
+            data->handler.inst_span_flt = h;
+        }
+        void _set_callback(handler_data data,
+                           void (*h)(Signal::Instance&&, Signal::Event, Span<const double>, Time&&))
+        {
+            if (!_check_span_type(data, MPR_DBL))
+                return;
+            data->type = INST_SPAN_DBL;
+            data->handler.inst_span_dbl = h;
+        }
     public:
         /*! Add an Event Callback to a signal.
          *  \param h    Callback function to call on Signal Events.
@@ -1160,6 +1309,10 @@ namespace mapper {
          *              * void (Signal::Instance&& inst, Signal::Event evt, float val, Time&& time);
          *              * void (Signal::Instance&& inst, Signal::Event evt, double val, Time&& time);
          *              * void (Signal::Instance&& inst, Signal::Event evt, Time&& time);
+         *              * void (Signal&& sig, Span<const T> val, Time&& time);
+         *              * void (Signal::Instance&& inst, Signal::Event evt, Span<const T> val, Time&& time);
+         *              where T is int, float, or double. Spans refer to the value without copying it
+         *              and are only valid during the call.
          *  \param events   Types of Events to listen for.
          *  \return         Self. */
         template <typename H>
@@ -1290,6 +1443,12 @@ namespace mapper {
     class Device : public Object
     {
     private:
+        int _set_values(const std::vector<Signal>& sigs, mpr_type type, const void *vals, int len)
+        {
+            std::vector<mpr_sig> _sigs(sigs.begin(), sigs.end());
+            return mpr_dev_set_values(_obj, (int)_sigs.size(), _sigs.data(), NULL, len, type, vals);
+        }
+
         void maybe_free() {
             if (_owned && _obj && decr_refcount() <= 0) {
                 mpr_list sigs = mpr_dev_get_sigs(_obj, MPR_DIR_ANY);
@@ -1433,6 +1592,54 @@ namespace mapper {
         Device& stop()
             { mpr_dev_stop_polling(_obj); RETURN_SELF }
 
+        /*! Evaluate the expressions of updated maps on several threads at once.
+         *  \param num_threads  The number of threads including the polling thread.
+         *  \return             Self. */
+        Device& eval_threads(int num_threads)
+            { mpr_dev_set_eval_threads(_obj, num_threads); RETURN_SELF }
+
+        /*! Count runtime statistics for this Device and its links and maps, exposed as the
+         *  read-only property "@stats".
+         *  \param enable       True to start counting, false to stop.
+         *  \return             Self. */
+        Device& stats(bool enable)
+            { mpr_dev_set_stats(_obj, enable); RETURN_SELF }
+
+        /*! Trace signal updates to measure their latency, exposed as the read-only property
+         *  "@latency".
+         *  \param enable       True to start tracing, false to stop.
+         *  \return             Self. */
+        Device& tracing(bool enable)
+            { mpr_dev_set_tracing(_obj, enable); RETURN_SELF }
+
+        /*! Lock the ordinal of this Device early, optionally reusing the ordinal it was
+         *  registered with last time. Must be called before the Device is registered.
+         *  \param cache_path   A file for storing ordinals, or NULL.
+         *  \return             Self. */
+        Device& fast_registration(const char *cache_path = NULL)
+            { mpr_dev_set_fast_registration(_obj, cache_path); RETURN_SELF }
+
+        /*! Get the sockets used by this Device, for driving it from an external event loop.
+         *  \return         The file descriptors to watch for readability. */
+        std::vector<int> fds() const
+        {
+            std::vector<int> v(mpr_dev_get_fds(_obj, NULL, 0));
+            size_t n = mpr_dev_get_fds(_obj, v.data(), v.size());
+            if (n < v.size())
+                v.resize(n);
+            return v;
+        }
+
+        /*! Get the longest time an external event loop may wait before calling on_readable().
+         *  \return         The timeout in milliseconds. */
+        int timeout() const
+            { return mpr_dev_get_timeout(_obj); }
+
+        /*! Process messages that are ready without blocking and perform any due tasks.
+         *  \return         The number of handled messages. */
+        int on_readable() const
+            { return mpr_dev_on_readable(_obj); }
+
         /*! Detect whether a device is completely initialized.
          *  \return         Non-zero if device is completely initialized, i.e., has an allocated
          *                  receiving port and unique identifier. Zero otherwise. */
@@ -1459,6 +1666,18 @@ namespace mapper {
         Device& update_maps()
             { mpr_dev_update_maps(_obj); RETURN_SELF }
 
+        /*! Update the values of many local Signals at once and send all updates together.
+         *  \param sigs     The Signals to update.
+         *  \param vals     The new values, the vector of each Signal following that of the
+         *                  previous one.
+         *  \return         The number of Signals updated. */
+        int set_values(const std::vector<Signal>& sigs, const std::vector<int>& vals)
+            { return _set_values(sigs, MPR_INT32, vals.data(), (int)vals.size()); }
+        int set_values(const std::vector<Signal>& sigs, const std::vector<float>& vals)
+            { return _set_values(sigs, MPR_FLT, vals.data(), (int)vals.size()); }
+        int set_values(const std::vector<Signal>& sigs, const std::vector<double>& vals)
+            { return _set_values(sigs, MPR_DBL, vals.data(), (int)vals.size()); }
+
         OBJ_METHODS(Device);
 
         friend std::ostream& operator<<(std::ostream& os, const mapper::Device& dev);
@@ -1642,6 +1861,12 @@ namespace mapper {
         Graph& set_address(const str_type &group, int port)
             { mpr_graph_set_address(_obj, group, port); RETURN_SELF }
 
+        /*! Set how often linked devices exchange pings to synchronize their clocks.
+         *  \param interval The average number of seconds between pings.
+         *  \return         Self. */
+        Graph& set_ping_interval(double interval)
+            { mpr_graph_set_ping_interval(_obj, interval); RETURN_SELF }
+
         /*! Retrieve the multicast url currently in use.
          *  \return     A string specifying the multicast url in use. */
         std::string address() const
@@ -1663,6 +1888,27 @@ namespace mapper {
         Graph& stop()
             { mpr_graph_stop_polling(_obj); RETURN_SELF }
 
+        /*! Get the sockets used by this Graph, for driving it from an external event loop.
+         *  \return         The file descriptors to watch for readability. */
+        std::vector<int> fds() const
+        {
+            std::vector<int> v(mpr_graph_get_fds(_obj, NULL, 0));
+            size_t n = mpr_graph_get_fds(_obj, v.data(), v.size());
+            if (n < v.size())
+                v.resize(n);
+            return v;
+        }
+
+        /*! Get the longest time an external event loop may wait before calling on_readable().
+         *  \return         The timeout in milliseconds. */
+        int timeout() const
+            { return mpr_graph_get_timeout(_obj); }
+
+        /*! Process messages that are ready without blocking and perform any due tasks.
+         *  \return         The number of handled messages. */
+        int on_readable() const
+            { return mpr_graph_on_readable(_obj); }
+
         // subscriptions
         /*! Subscribe to information about a specific Device.
          *  \param dev      The Device of interest.
@@ -1695,6 +1941,29 @@ namespace mapper {
         const Graph& unsubscribe()
             { mpr_graph_unsubscribe(_obj, 0); RETURN_SELF }
 
+        /*! Push many new Maps at once, sending them to each destination Device in batches.
+         *  \param maps     The Maps to push.
+         *  \return         Self. */
+        const Graph& push_maps(const std::vector<Map>& maps)
+        {
+            std::vector<mpr_map> _maps(maps.begin(), maps.end());
+            mpr_graph_push_maps(_obj, (int)_maps.size(), _maps.data());
+            RETURN_SELF
+        }
+
+        /*! Save the Maps known to this Graph to a session file.
+         *  \param path     The path of the file to write.
+         *  \param json     True to write human-readable JSON instead of the binary format.
+         *  \return         The number of Maps saved, or -1 on error. */
+        int save_session(const str_type &path, bool json = false) const
+            { return mpr_graph_save_session(_obj, path, json); }
+
+        /*! Load and stage all the Maps stored in a binary session file.
+         *  \param path     The path of the file to read.
+         *  \return         The number of Maps staged, or -1 on error. */
+        int load_session(const str_type &path)
+            { return mpr_graph_load_session(_obj, path); }
+
         /*! Register a callback for when an Object record is added, updated, or removed.
          *  \param h        Callback function.
          *  \param types    Bitflags setting the type of information of interest.
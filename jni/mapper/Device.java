@@ -86,6 +86,27 @@ public class Device extends mapper.AbstractObject
     }
 
 
+    /* update many signals at once, values holds the vector of each signal in turn */
+    private native int setValues(long dev, long[] sigs, long[] ids, java.lang.Object values);
+    private int _setValues(Signal[] signals, long[] instanceIds, java.lang.Object values) {
+        long[] sigs = new long[signals.length];
+        for (int i = 0; i < signals.length; i++)
+            sigs[i] = signals[i]._obj;
+        return setValues(_obj, sigs, instanceIds, values);
+    }
+    public int setValues(Signal[] signals, long[] instanceIds, int[] values)
+        { return _setValues(signals, instanceIds, values); }
+    public int setValues(Signal[] signals, long[] instanceIds, float[] values)
+        { return _setValues(signals, instanceIds, values); }
+    public int setValues(Signal[] signals, long[] instanceIds, double[] values)
+        { return _setValues(signals, instanceIds, values); }
+    public int setValues(Signal[] signals, int[] values)
+        { return _setValues(signals, null, values); }
+    public int setValues(Signal[] signals, float[] values)
+        { return _setValues(signals, null, values); }
+    public int setValues(Signal[] signals, double[] values)
+        { return _setValues(signals, null, values); }
+
     /* property: ready */
     public native boolean ready();
 
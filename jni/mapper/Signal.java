@@ -25,10 +25,11 @@ public class Signal extends AbstractObject
     public native Device device();
 
     /* callbacks */
-    private native void mapperSignalSetCB(long sig, Listener l, String methodSig, int flags);
-    private void _setListener(Listener l, int flags) {
+    private native void mapperSignalSetCB(long sig, Listener l, String methodSig, int flags,
+                                          boolean copy);
+    private void _setListener(Listener l, int flags, boolean copy) {
         if (l == null) {
-            mapperSignalSetCB(_obj, null, null, 0);
+            mapperSignalSetCB(_obj, null, null, 0, true);
             return;
         }
 
@@ -39,28 +40,35 @@ public class Signal extends AbstractObject
                 continue;
             String methodName = method.toString();
             if (methodName.startsWith("public void "+instanceName[0]+".")) {
-                mapperSignalSetCB(_obj, l, methodName, flags);
+                mapperSignalSetCB(_obj, l, methodName, flags, copy);
                 return;
             }
         }
         System.out.println("Error: no match for listener.");
     }
-    public Signal setListener(Listener l, Event event) {
-        _setListener(l, event.value());
+    /* If copy is false, vector values are delivered in the same preallocated array for every
+     * update of this signal, so listeners must not keep a reference to it. */
+    public Signal setListener(Listener l, Event event, boolean copy) {
+        _setListener(l, event.value(), copy);
         return this;
     }
-    public Signal setListener(Listener l, Set<Event> events) {
+    public Signal setListener(Listener l, Event event) {
+        return setListener(l, event, true);
+    }
+    public Signal setListener(Listener l, Set<Event> events, boolean copy) {
         int flags = 0;
         for (Event e : Event.values()) {
             if (events.contains(e))
                 flags |= e.value();
         }
-        _setListener(l, flags);
+        _setListener(l, flags, copy);
         return this;
     }
+    public Signal setListener(Listener l, Set<Event> events) {
+        return setListener(l, events, true);
+    }
     public Signal setListener(Listener l) {
-        _setListener(l, Event.UPDATE.value());
-        return this;
+        return setListener(l, Event.UPDATE, true);
     }
 
     private native void mapperSignalReserveInstances(long sig, int num, long[] ids);
@@ -96,6 +104,41 @@ public class Signal extends AbstractObject
         return setValue(0, value);
     }
 
+    /* typed arrays and direct buffers skip the type lookup and are not copied to the heap; a
+     * direct buffer must hold a value of the signal's type in native byte order */
+    private native void mapperSignalSetInts(long sig, long id, int[] value);
+    private native void mapperSignalSetFloats(long sig, long id, float[] value);
+    private native void mapperSignalSetDoubles(long sig, long id, double[] value);
+    private native void mapperSignalSetBuffer(long sig, long id, java.nio.ByteBuffer value);
+    public Signal setValue(long id, int[] value) {
+        mapperSignalSetInts(_obj, id, value);
+        return this;
+    }
+    public Signal setValue(long id, float[] value) {
+        mapperSignalSetFloats(_obj, id, value);
+        return this;
+    }
+    public Signal setValue(long id, double[] value) {
+        mapperSignalSetDoubles(_obj, id, value);
+        return this;
+    }
+    public Signal setValue(long id, java.nio.ByteBuffer value) {
+        mapperSignalSetBuffer(_obj, id, value);
+        return this;
+    }
+    public Signal setValue(int[] value) {
+        return setValue(0, value);
+    }
+    public Signal setValue(float[] value) {
+        return setValue(0, value);
+    }
+    public Signal setValue(double[] value) {
+        return setValue(0, value);
+    }
+    public Signal setValue(java.nio.ByteBuffer value) {
+        return setValue(0, value);
+    }
+
     /* get value */
     public native boolean hasValue(long id);
     public boolean hasValue() { return hasValue(0); }
@@ -140,6 +140,8 @@ typedef struct {
     jobject signal;
     jobject listener;
     int listener_type;
+    int reuse_buffer;   // deliver vector values in the same Java array for every update
+    jarray buffer;
 } signal_jni_context_t, *signal_jni_context;
 
 typedef struct {
@@ -541,6 +543,37 @@ static jobject build_value_object(JNIEnv *env, mpr_prop prop, const int len,
     return ret;
 }
 
+/* Return the array used to deliver a vector value to a listener: the signal's reusable buffer if
+ * enabled, otherwise a new local array that must be deleted after the call. */
+static jarray get_callback_array(signal_jni_context ctx, int len, mpr_type type)
+{
+    jarray arr;
+    if (ctx->buffer && (*genv)->GetArrayLength(genv, ctx->buffer) == len)
+        return ctx->buffer;
+    switch (type) {
+        case MPR_INT32: arr = (*genv)->NewIntArray(genv, len);      break;
+        case MPR_FLT:   arr = (*genv)->NewFloatArray(genv, len);    break;
+        default:        arr = (*genv)->NewDoubleArray(genv, len);   break;
+    }
+    if (arr && ctx->reuse_buffer && !ctx->buffer) {
+        ctx->buffer = (*genv)->NewGlobalRef(genv, arr);
+        (*genv)->DeleteLocalRef(genv, arr);
+        return ctx->buffer;
+    }
+    return arr;
+}
+
+static void free_signal_ctx(JNIEnv *env, signal_jni_context ctx)
+{
+    if (ctx->signal)
+        (*env)->DeleteGlobalRef(env, ctx->signal);
+    if (ctx->listener)
+        (*env)->DeleteGlobalRef(env, ctx->listener);
+    if (ctx->buffer)
+        (*env)->DeleteGlobalRef(env, ctx->buffer);
+    free(ctx);
+}
+
 static void java_signal_update_cb(mpr_sig sig, mpr_sig_evt evt, mpr_id id, int len,
                                   mpr_type type, const void *val, mpr_time time)
 {
@@ -649,7 +682,7 @@ static void java_signal_update_cb(mpr_sig sig, mpr_sig_evt evt, mpr_id id, int l
                 (*genv)->CallVoidMethod(genv, update_cb, mid, sig_ptr, eventobj, 0, jtime);
                 break;
             }
-            jintArray arr = (*genv)->NewIntArray(genv, len);
+            jintArray arr = get_callback_array(ctx, len, MPR_INT32);
             if (!arr)
                 return;
             switch (type) {
@@ -672,7 +705,8 @@ static void java_signal_update_cb(mpr_sig sig, mpr_sig_evt evt, mpr_id id, int l
                 }
             }
             (*genv)->CallVoidMethod(genv, update_cb, mid, sig_ptr, eventobj, arr, jtime);
-            (*genv)->DeleteLocalRef(genv, arr);
+            if (arr != ctx->buffer)
+                (*genv)->DeleteLocalRef(genv, arr);
             break;
         }
         case SIG_CB_VECT_FLT: {
@@ -680,7 +714,7 @@ static void java_signal_update_cb(mpr_sig sig, mpr_sig_evt evt, mpr_id id, int l
                 (*genv)->CallVoidMethod(genv, update_cb, mid, sig_ptr, eventobj, 0, jtime);
                 break;
             }
-            jfloatArray arr = (*genv)->NewFloatArray(genv, len);
+            jfloatArray arr = get_callback_array(ctx, len, MPR_FLT);
             if (!arr)
                 return;
             switch (type) {
@@ -705,7 +739,8 @@ static void java_signal_update_cb(mpr_sig sig, mpr_sig_evt evt, mpr_id id, int l
             (*genv)->CallVoidMethod(genv, update_cb, mid, sig_ptr, eventobj, arr, jtime);
             if ((*genv)->ExceptionOccurred(genv))
                 bailing = 1;
-            (*genv)->DeleteLocalRef(genv, arr);
+            if (arr != ctx->buffer)
+                (*genv)->DeleteLocalRef(genv, arr);
             break;
         }
         case SIG_CB_VECT_DBL: {
@@ -713,7 +748,7 @@ static void java_signal_update_cb(mpr_sig sig, mpr_sig_evt evt, mpr_id id, int l
                 (*genv)->CallVoidMethod(genv, update_cb, mid, sig_ptr, eventobj, 0, jtime);
                 break;
             }
-            jdoubleArray arr = (*genv)->NewDoubleArray(genv, len);
+            jdoubleArray arr = get_callback_array(ctx, len, MPR_DBL);
             if (!arr)
                 return;
             switch (type) {
@@ -738,7 +773,8 @@ static void java_signal_update_cb(mpr_sig sig, mpr_sig_evt evt, mpr_id id, int l
             (*genv)->CallVoidMethod(genv, update_cb, mid, sig_ptr, eventobj, arr, jtime);
             if ((*genv)->ExceptionOccurred(genv))
                 bailing = 1;
-            (*genv)->DeleteLocalRef(genv, arr);
+            if (arr != ctx->buffer)
+                (*genv)->DeleteLocalRef(genv, arr);
             break;
         }
         default:
@@ -1450,13 +1486,8 @@ JNIEXPORT void JNICALL Java_mapper_Device_mapperDeviceFree
             free(ictx);
         }
         signal_jni_context ctx = (signal_jni_context)signal_user_data(temp);
-        if (!ctx)
-            continue;
-        if (ctx->signal)
-            (*env)->DeleteGlobalRef(env, ctx->signal);
-        if (ctx->listener)
-            (*env)->DeleteGlobalRef(env, ctx->listener);
-        free(ctx);
+        if (ctx)
+            free_signal_ctx(env, ctx);
     }
     mpr_dev_free(dev);
 }
@@ -1556,13 +1587,8 @@ JNIEXPORT void JNICALL Java_mapper_Device_remove_1signal
     }
 
     signal_jni_context ctx = (signal_jni_context)signal_user_data(sig);
-    if (ctx) {
-        if (ctx->signal)
-            (*env)->DeleteGlobalRef(env, ctx->signal);
-        if (ctx->listener)
-            (*env)->DeleteGlobalRef(env, ctx->listener);
-        free(ctx);
-    }
+    if (ctx)
+        free_signal_ctx(env, ctx);
 
     mpr_sig_free(sig);
 }
@@ -1597,6 +1623,71 @@ JNIEXPORT jobject JNICALL Java_mapper_Device_setTime
     return obj;
 }
 
+JNIEXPORT jint JNICALL Java_mapper_Device_setValues
+  (JNIEnv *env, jobject obj, jlong jdev, jlongArray jsigs, jlongArray jids, jobject jvals)
+{
+    mpr_dev dev = (mpr_dev)ptr_jlong(jdev);
+    int i, num_sigs, len, num_set = 0;
+    mpr_sig *sigs;
+    jlong *ptrs, *ids = 0;
+    mpr_type type;
+    void *vals;
+    if (!dev || !is_local((mpr_obj)dev) || !jsigs || !jvals)
+        return 0;
+    num_sigs = (*env)->GetArrayLength(env, jsigs);
+    if (!num_sigs || (jids && (*env)->GetArrayLength(env, jids) < num_sigs))
+        return 0;
+
+    if ((*env)->IsInstanceOf(env, jvals, (*env)->FindClass(env, "[I")))
+        type = MPR_INT32;
+    else if ((*env)->IsInstanceOf(env, jvals, (*env)->FindClass(env, "[F")))
+        type = MPR_FLT;
+    else if ((*env)->IsInstanceOf(env, jvals, (*env)->FindClass(env, "[D")))
+        type = MPR_DBL;
+    else {
+        printf("Object type not supported!\n");
+        return 0;
+    }
+
+    /* signal pointers may be narrower than jlong */
+    ptrs = (*env)->GetLongArrayElements(env, jsigs, NULL);
+    sigs = malloc(num_sigs * sizeof(mpr_sig));
+    if (ptrs && sigs) {
+        for (i = 0; i < num_sigs; i++)
+            sigs[i] = (mpr_sig)ptr_jlong(ptrs[i]);
+    }
+    if (ptrs)
+        (*env)->ReleaseLongArrayElements(env, jsigs, ptrs, JNI_ABORT);
+    if (!ptrs || !sigs)
+        goto done;
+
+    if (jids && !(ids = (*env)->GetLongArrayElements(env, jids, NULL)))
+        goto done;
+
+    /* updates to local maps may call Java signal handlers, so the values are not accessed
+     * in a critical region */
+    len = (*env)->GetArrayLength(env, jvals);
+    switch (type) {
+        case MPR_INT32: vals = (*env)->GetIntArrayElements(env, jvals, NULL);      break;
+        case MPR_FLT:   vals = (*env)->GetFloatArrayElements(env, jvals, NULL);    break;
+        default:        vals = (*env)->GetDoubleArrayElements(env, jvals, NULL);   break;
+    }
+    if (vals) {
+        num_set = mpr_dev_set_values(dev, num_sigs, sigs, (mpr_id*)ids, len, type, vals);
+        switch (type) {
+            case MPR_INT32: (*env)->ReleaseIntArrayElements(env, jvals, vals, JNI_ABORT);     break;
+            case MPR_FLT:   (*env)->ReleaseFloatArrayElements(env, jvals, vals, JNI_ABORT);   break;
+            default:        (*env)->ReleaseDoubleArrayElements(env, jvals, vals, JNI_ABORT);  break;
+        }
+    }
+    if (ids)
+        (*env)->ReleaseLongArrayElements(env, jids, ids, JNI_ABORT);
+  done:
+    if (sigs)
+        free(sigs);
+    return num_set;
+}
+
 JNIEXPORT jlong JNICALL Java_mapper_Device_signals
   (JNIEnv *env, jobject obj, jlong jdev, jint dir)
 {
@@ -1893,13 +1984,19 @@ JNIEXPORT jobject JNICALL Java_mapper_Signal_device
 
 JNIEXPORT void JNICALL Java_mapper_Signal_mapperSignalSetCB
   (JNIEnv *env, jobject obj, jlong jsig, jobject listener, jstring methodSig,
-    jint flags)
+    jint flags, jboolean copy)
 {
     mpr_sig sig = (mpr_sig) ptr_jlong(jsig);
     signal_jni_context ctx = (signal_jni_context)signal_user_data(sig);
     if (!ctx) {
         return;
     }
+    // the buffer element type depends on the listener so it is allocated again on the next update
+    if (ctx->buffer) {
+        (*env)->DeleteGlobalRef(env, ctx->buffer);
+        ctx->buffer = 0;
+    }
+    ctx->reuse_buffer = !copy;
     if (ctx->listener == listener) {
         mpr_sig_set_cb(sig, java_signal_update_cb, flags);
         return;
@@ -2060,6 +2157,87 @@ JNIEXPORT jobject JNICALL Java_mapper_Signal_setValue
     return obj;
 }
 
+/* The typed entry points below avoid looking up the class of the value. Vectors are copied rather
+ * than accessed in a critical region since updating local maps may call Java listeners; short
+ * vectors are copied to the stack and longer ones to the heap. */
+#define MAX_STACK_VEC_BYTES 1024
+JNIEXPORT void JNICALL Java_mapper_Signal_mapperSignalSetInts
+  (JNIEnv *env, jobject obj, jlong jsig, jlong jid, jintArray jval)
+{
+    mpr_sig sig = (mpr_sig) ptr_jlong(jsig);
+    int len = jval ? (*env)->GetArrayLength(env, jval) : 0;
+    jint buf[MAX_STACK_VEC_BYTES / sizeof(jint)], *vals;
+    if (!sig || !len || len != signal_length(sig))
+        return;
+    vals = len <= MAX_STACK_VEC_BYTES / sizeof(jint) ? buf : malloc(len * sizeof(jint));
+    if (!vals)
+        return;
+    (*env)->GetIntArrayRegion(env, jval, 0, len, vals);
+    mpr_sig_set_value(sig, (mpr_id)ptr_jlong(jid), len, MPR_INT32, vals);
+    if (vals != buf)
+        free(vals);
+}
+
+JNIEXPORT void JNICALL Java_mapper_Signal_mapperSignalSetFloats
+  (JNIEnv *env, jobject obj, jlong jsig, jlong jid, jfloatArray jval)
+{
+    mpr_sig sig = (mpr_sig) ptr_jlong(jsig);
+    int len = jval ? (*env)->GetArrayLength(env, jval) : 0;
+    jfloat buf[MAX_STACK_VEC_BYTES / sizeof(jfloat)], *vals;
+    if (!sig || !len || len != signal_length(sig))
+        return;
+    vals = len <= MAX_STACK_VEC_BYTES / sizeof(jfloat) ? buf : malloc(len * sizeof(jfloat));
+    if (!vals)
+        return;
+    (*env)->GetFloatArrayRegion(env, jval, 0, len, vals);
+    mpr_sig_set_value(sig, (mpr_id)ptr_jlong(jid), len, MPR_FLT, vals);
+    if (vals != buf)
+        free(vals);
+}
+
+JNIEXPORT void JNICALL Java_mapper_Signal_mapperSignalSetDoubles
+  (JNIEnv *env, jobject obj, jlong jsig, jlong jid, jdoubleArray jval)
+{
+    mpr_sig sig = (mpr_sig) ptr_jlong(jsig);
+    int len = jval ? (*env)->GetArrayLength(env, jval) : 0;
+    jdouble buf[MAX_STACK_VEC_BYTES / sizeof(jdouble)], *vals;
+    if (!sig || !len || len != signal_length(sig))
+        return;
+    vals = len <= MAX_STACK_VEC_BYTES / sizeof(jdouble) ? buf : malloc(len * sizeof(jdouble));
+    if (!vals)
+        return;
+    (*env)->GetDoubleArrayRegion(env, jval, 0, len, vals);
+    mpr_sig_set_value(sig, (mpr_id)ptr_jlong(jid), len, MPR_DBL, vals);
+    if (vals != buf)
+        free(vals);
+}
+
+/* Direct buffers are read in place and must hold a vector of the signal's own type. */
+JNIEXPORT void JNICALL Java_mapper_Signal_mapperSignalSetBuffer
+  (JNIEnv *env, jobject obj, jlong jsig, jlong jid, jobject jbuf)
+{
+    mpr_sig sig = (mpr_sig) ptr_jlong(jsig);
+    void *val;
+    int len, size;
+    if (!sig || !jbuf)
+        return;
+    if (!(val = (*env)->GetDirectBufferAddress(env, jbuf))) {
+        throwIllegalArgument(env, "ByteBuffer must be direct");
+        return;
+    }
+    len = signal_length(sig);
+    switch (signal_type(sig)) {
+        case MPR_INT32: size = sizeof(int);     break;
+        case MPR_FLT:   size = sizeof(float);   break;
+        default:        size = sizeof(double);  break;
+    }
+    if ((*env)->GetDirectBufferCapacity(env, jbuf) < len * size) {
+        throwIllegalArgument(env, "ByteBuffer is too small for signal value");
+        return;
+    }
+    mpr_sig_set_value(sig, (mpr_id)ptr_jlong(jid), len, signal_type(sig), val);
+}
+
 JNIEXPORT jboolean JNICALL Java_mapper_Signal_hasValue
   (JNIEnv *env, jobject obj, jlong id)
 {
@@ -2,9 +2,36 @@
 import mapper.*;
 import mapper.signal.*;
 import java.util.Arrays;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 
 class testspeed {
     public static boolean updated = true;
+    public static final int VEC_LEN = 64;
+    public static final int NUM_UPDATES = 10000;
+
+    interface Update {
+        void send(int i);
+    }
+
+    // send updates one at a time, waiting for each to be received
+    static double measure(Device dev, String label, Update update) {
+        Time time = new Time();
+        double then = time.getDouble();
+        int i = 0;
+        testspeed.updated = true;
+        while (i < NUM_UPDATES) {
+            if (testspeed.updated) {
+                testspeed.updated = false;
+                update.send(i);
+                i++;
+            }
+            dev.poll(testspeed.updated ? 0 : 1);
+        }
+        double elapsed = time.now().getDouble() - then;
+        System.out.println(label+": sent "+i+" updates in "+elapsed+" seconds.");
+        return elapsed;
+    }
 
     public static void main(String [] args) {
         final Device dev = new Device("java.testspeed");
@@ -66,6 +93,36 @@ class testspeed {
         }
         double elapsed = time.now().getDouble() - then;
         System.out.println("Sent "+i+" messages in "+elapsed+" seconds.");
+
+        // compare ways of sending and receiving vector updates
+        Listener vl = new Listener() {
+            public void onEvent(Signal sig, mapper.signal.Event e, float[] v, Time time) {
+                if (e == mapper.signal.Event.UPDATE)
+                    testspeed.updated = true;
+            }
+        };
+        Signal vecin = dev.addSignal(Direction.IN, "vecin", VEC_LEN, Type.FLOAT,
+                                     null, null, null, null, vl);
+        final Signal vecout = dev.addSignal(Direction.OUT, "vecout", VEC_LEN, Type.FLOAT,
+                                            null, null, null, null, null);
+        Map vecmap = new Map(vecout, vecin);
+        vecmap.push();
+        while (!vecmap.ready()) {
+            System.out.println("waiting for vector map");
+            dev.poll(100);
+        }
+
+        final float[] vec = new float[VEC_LEN];
+        final ByteBuffer buf = ByteBuffer.allocateDirect(VEC_LEN * 4).order(ByteOrder.nativeOrder());
+        measure(dev, "float[] as Object", (int n) -> { vec[0] = n; vecout.setValue((Object)vec); });
+        measure(dev, "float[]", (int n) -> { vec[0] = n; vecout.setValue(vec); });
+        measure(dev, "direct ByteBuffer", (int n) -> { buf.putFloat(0, n); vecout.setValue(buf); });
+
+        // deliver values in a preallocated array instead of allocating one per update
+        vecin.setListener(vl, mapper.signal.Event.UPDATE, false);
+        measure(dev, "direct ByteBuffer, reused callback array",
+                (int n) -> { buf.putFloat(0, n); vecout.setValue(buf); });
+
         dev.free();
     }
 }
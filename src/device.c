@@ -38,6 +38,12 @@ MPR_INLINE static int _process_outgoing_maps(mpr_local_dev dev);
 
 mpr_time ts = {0,1};
 
+/* Minimum number of signals and maps for sending metadata in bulk. */
+#define BULK_MIN_OBJS 32
+
+/* Number of subscribers above which metadata is multicast to a per-device group. */
+#define SUB_GROUP_MIN 4
+
 static int cmp_qry_linked(const void *ctx, mpr_dev dev)
 {
     int i;
@@ -73,7 +79,9 @@ void init_dev_prop_tbl(mpr_dev dev)
     mpr_tbl_link(tbl, PROP(ID), 1, MPR_INT64, &dev->obj.id, mod);
     qry = mpr_list_new_query((const void**)&dev->obj.graph->devs, (void*)cmp_qry_linked, "v", &dev);
     mpr_tbl_link(tbl, PROP(LINKED), 1, MPR_LIST, qry, NON_MODIFIABLE | PROP_OWNED);
-    mpr_tbl_link(tbl, PROP(NAME), 1, MPR_STR, &dev->name, mod | INDIRECT | LOCAL_ACCESS_ONLY);
+    /* the name is interned and identifies the device, so it cannot be changed through the table */
+    mpr_tbl_link(tbl, PROP(NAME), 1, MPR_STR, &dev->name,
+                 NON_MODIFIABLE | INDIRECT | LOCAL_ACCESS_ONLY);
     mpr_tbl_link(tbl, PROP(NUM_MAPS_IN), 1, MPR_INT32, &dev->num_maps_in, mod);
     mpr_tbl_link(tbl, PROP(NUM_MAPS_OUT), 1, MPR_INT32, &dev->num_maps_out, mod);
     mpr_tbl_link(tbl, PROP(NUM_SIGS_IN), 1, MPR_INT32, &dev->num_inputs, mod);
@@ -160,6 +168,9 @@ void mpr_dev_free(mpr_dev dev)
     gph = dev->obj.graph;
     net = &gph->net;
 
+    /* make sure a shared polling thread no longer uses this device */
+    mpr_pool_remove_dev(ldev);
+
     /* free any queued graph messages without sending */
     mpr_net_free_msgs(net);
 
@@ -179,9 +190,13 @@ void mpr_dev_free(mpr_dev dev)
     while (ldev->subscribers) {
         mpr_subscriber sub = ldev->subscribers;
         FUNC_IF(lo_address_free, sub->addr);
+        FUNC_IF(lo_address_free, sub->bulk_addr);
         ldev->subscribers = sub->next;
         free(sub);
     }
+    mpr_dev_release_sub_group(ldev);
+    FUNC_IF(mpr_reactor_free, ldev->reactor);
+    FUNC_IF(mpr_eval_pool_free, ldev->eval_pool);
 
     /* free signals owned by this device */
     list = mpr_dev_get_sigs(dev, MPR_DIR_ANY);
@@ -235,17 +250,102 @@ void mpr_dev_free(mpr_dev dev)
     }
 
     FUNC_IF(free, dev->prefix);
+    FUNC_IF(free, ldev->reg_cache);
 
     mpr_expr_stack_free(ldev->expr_stack);
 
     FUNC_IF(lo_server_free, ldev->servers[SERVER_UDP]);
     FUNC_IF(lo_server_free, ldev->servers[SERVER_TCP]);
 
+    if (ldev->stats) {
+        mpr_tbl_unlink_key(dev->obj.props.synced, "stats");
+        free(ldev->stats);
+    }
+    if (ldev->latency) {
+        mpr_tbl_unlink_key(dev->obj.props.synced, "latency");
+        free(ldev->latency);
+    }
+
     mpr_graph_remove_dev(gph, dev, MPR_OBJ_REM, 1);
     if (!gph->own)
         mpr_graph_free(gph);
 }
 
+/* Each line of the registration cache holds a device name prefix and an ordinal. */
+static int _parse_cache_line(char *line, const char *prefix)
+{
+    int ordinal;
+    char *sep = strrchr(line, ' ');
+    RETURN_ARG_UNLESS(sep, 0);
+    *sep = 0;
+    RETURN_ARG_UNLESS(0 == strcmp(line, prefix), 0);
+    ordinal = atoi(sep + 1);
+    return ordinal > 0 ? ordinal : 0;
+}
+
+/*! Find a cached ordinal that is not already proposed by another device on the same network. */
+static int _get_cached_ordinal(mpr_local_dev dev)
+{
+    int i, ordinal = 0;
+    char line[256];
+    mpr_net net = &dev->obj.graph->net;
+    FILE *file = fopen(dev->reg_cache, "r");
+    RETURN_ARG_UNLESS(file, 0);
+    while (!ordinal && fgets(line, 256, file)) {
+        line[strcspn(line, "\r\n")] = 0;
+        ordinal = _parse_cache_line(line, dev->prefix);
+        for (i = 0; ordinal && i < net->num_devs; i++) {
+            mpr_local_dev other = net->devs[i];
+            if (other != dev && other->ordinal_allocator.val == ordinal
+                && 0 == strcmp(other->prefix, dev->prefix))
+                ordinal = 0;
+        }
+    }
+    fclose(file);
+    return ordinal;
+}
+
+/*! Add the ordinal of a newly registered device to its registration cache. */
+static void _cache_ordinal(mpr_local_dev dev)
+{
+    char line[256];
+    int ordinal = dev->ordinal_allocator.val;
+    FILE *file = fopen(dev->reg_cache, "a+");
+    if (!file) {
+        trace_dev(dev, "couldn't open registration cache '%s'\n", dev->reg_cache);
+        return;
+    }
+    rewind(file);
+    while (fgets(line, 256, file)) {
+        line[strcspn(line, "\r\n")] = 0;
+        if (_parse_cache_line(line, dev->prefix) == ordinal) {
+            fclose(file);
+            return;
+        }
+    }
+    fprintf(file, "%s %d\n", dev->prefix, ordinal);
+    fclose(file);
+}
+
+int mpr_dev_set_fast_registration(mpr_dev dev, const char *cache_path)
+{
+    mpr_local_dev ldev = (mpr_local_dev)dev;
+    int ordinal;
+    RETURN_ARG_UNLESS(dev && dev->is_local && !ldev->ordinal_allocator.locked, -1);
+    ldev->ordinal_allocator.fast = 1;
+    FUNC_IF(free, ldev->reg_cache);
+    ldev->reg_cache = cache_path ? strdup(cache_path) : 0;
+    RETURN_ARG_UNLESS(ldev->reg_cache, 0);
+
+    ordinal = _get_cached_ordinal(ldev);
+    if (ordinal && ordinal != ldev->ordinal_allocator.val) {
+        trace_dev(ldev, "reusing cached ordinal %d\n", ordinal);
+        ldev->ordinal_allocator.val = ordinal;
+        mpr_net_probe_dev_name(&dev->obj.graph->net, ldev);
+    }
+    return 0;
+}
+
 void mpr_dev_on_registered(mpr_local_dev dev)
 {
     int i;
@@ -271,6 +371,8 @@ void mpr_dev_on_registered(mpr_local_dev dev)
     dev->status = MPR_STATUS_READY;
 
     mpr_dev_get_name((mpr_dev)dev);
+    if (dev->reg_cache)
+        _cache_ordinal(dev);
 
     /* Check if we have any staged maps */
     mpr_graph_cleanup(dev->obj.graph);
@@ -295,6 +397,34 @@ int mpr_dev_bundle_start(lo_timetag t, void *data)
     return 0;
 }
 
+MPR_INLINE static void _add_latency(int64_t *latency, int total_idx, int bin_idx, double sec)
+{
+    int64_t us = sec > 0 ? (int64_t)(sec * 1000000) : 0, scaled = us / 10;
+    int bin = 0;
+    latency[total_idx] += us;
+    for (; scaled && bin < NUM_LATENCY_BINS - 1; scaled >>= 2)
+        ++bin;
+    ++latency[bin_idx + bin];
+}
+
+/* Record the latency of a traced update since it was sent and since its origin. The origin is
+ * converted to local time so that it can be passed on to the next hop. */
+static void _record_latency(mpr_local_dev dev, mpr_link link, mpr_trace tr, mpr_time sent)
+{
+    mpr_time now;
+    mpr_time_set(&now, MPR_NOW);
+    if (link && !link->is_local_only)
+        mpr_sync_clock_to_local(&link->clock, &tr->origin);
+    ++dev->latency[LATENCY_NUM_TRACED];
+    _add_latency(dev->latency, LATENCY_ORIGIN_US, LATENCY_ORIGIN_BINS,
+                 mpr_time_get_diff(now, tr->origin));
+    _add_latency(dev->latency, LATENCY_HOP_US, LATENCY_HOP_BINS, mpr_time_get_diff(now, sent));
+}
+
+/* Discard an incoming signal update, counting it if statistics are enabled. */
+#define DROP_UNLESS(a, ...) \
+if (!(a)) { STAT_INC(dev, DEV_STAT_DROPPED); trace_dev(dev, __VA_ARGS__); return 0; }
+
 /* Notes:
  * - Incoming signal values may be scalars or vectors, but much match the
  *   length of the target signal or mapping slot.
@@ -324,12 +454,15 @@ int mpr_dev_handler(const char *path, const char *types, lo_arg **argv, int argc
     mpr_id_map idmap;
     mpr_local_map map = 0;
     mpr_local_slot slot = 0;
+    mpr_time t;
+    mpr_trace_t tr = {0}, prev_trace;
     float diff;
 
     TRACE_RETURN_UNLESS(sig && (dev = sig->dev), 0,
                         "error in mpr_dev_handler, cannot retrieve user data\n");
     TRACE_DEV_RETURN_UNLESS(sig->num_inst, 0, "signal '%s' has no instances.\n", sig->name);
     RETURN_ARG_UNLESS(argc, 0);
+    STAT_INC(dev, DEV_STAT_UPDATES_IN);
 
     /* We need to consider that there may be properties appended to the msg
      * check length and find properties if any */
@@ -352,6 +485,13 @@ int mpr_dev_handler(const char *path, const char *types, lo_arg **argv, int argc
             slot_idx = argv[i+1]->i32;
             i += 2;
         }
+        else if ((strcmp(&argv[i]->s, "@tr") == 0) && argc >= i + 3) {
+            TRACE_DEV_RETURN_UNLESS(types[i+1] == MPR_INT64 && types[i+2] == MPR_TIME, 0, "error "
+                                    "in mpr_dev_handler: bad arguments for 'trace' prop.\n")
+            tr.id = argv[i+1]->i64;
+            memcpy(&tr.origin, &argv[i+2]->t, sizeof(mpr_time));
+            i += 3;
+        }
         else {
 #ifdef DEBUG
             trace_dev(dev, "error in mpr_dev_handler: unknown property name '%s'.\n", &argv[i]->s);
@@ -363,10 +503,10 @@ int mpr_dev_handler(const char *path, const char *types, lo_arg **argv, int argc
     if (slot_idx >= 0) {
         /* retrieve mapping associated with this slot */
         slot = mpr_rtr_get_slot(rtr, sig, slot_idx);
-        TRACE_DEV_RETURN_UNLESS(slot, 0, "error in mpr_dev_handler: slot %d not found.\n", slot_idx);
+        DROP_UNLESS(slot, "error in mpr_dev_handler: slot %d not found.\n", slot_idx);
         map = slot->map;
-        TRACE_DEV_RETURN_UNLESS(map->status >= MPR_STATUS_READY, 0, "error in mpr_dev_handler: "
-                                "mapping not yet ready.\n");
+        DROP_UNLESS(map->status >= MPR_STATUS_READY, "error in mpr_dev_handler: "
+                    "mapping not yet ready.\n");
         if (map->expr && !map->is_local_only) {
             vals = check_types(types, val_len, slot->sig->type, slot->sig->len);
             map_manages_inst = mpr_expr_get_manages_inst(map->expr);
@@ -379,7 +519,18 @@ int mpr_dev_handler(const char *path, const char *types, lo_arg **argv, int argc
     }
     else
         vals = check_types(types, val_len, sig->type, sig->len);
-    RETURN_ARG_UNLESS(vals >= 0, 0);
+    DROP_UNLESS(vals >= 0, "error in mpr_dev_handler: unexpected value types.\n");
+
+    /* express the bundle timetag in local time if the sender's clock offset is known */
+    mpr_time_set(&t, ts);
+    if (slot && slot->link && !slot->link->is_local_only)
+        mpr_sync_clock_to_local(&slot->link->clock, &t);
+
+    /* traces are only recorded and passed on by devices with tracing enabled */
+    if (tr.id && dev->latency)
+        _record_latency(dev, slot ? slot->link : 0, &tr, t);
+    else
+        tr.id = 0;
 
     /* TODO: optionally discard out-of-order messages
      * requires timebase sync for many-to-one mappings or local updates
@@ -388,7 +539,7 @@ int mpr_dev_handler(const char *path, const char *types, lo_arg **argv, int argc
      */
 
     if (GID) {
-        idmap_idx = mpr_sig_get_idmap_with_GID(sig, GID, RELEASED_LOCALLY, ts, 0);
+        idmap_idx = mpr_sig_get_idmap_with_GID(sig, GID, RELEASED_LOCALLY, t, 0);
         if (idmap_idx < 0) {
             /* No instance found with this map – don't activate instance just to release it again */
             RETURN_ARG_UNLESS(vals && sig->dir == MPR_DIR_IN, 0);
@@ -396,14 +547,13 @@ int mpr_dev_handler(const char *path, const char *types, lo_arg **argv, int argc
             if (map_manages_inst && vals == slot->sig->len) {
                 /* special case: do a dry-run to check whether this map will
                  * cause a release. If so, don't bother stealing an instance. */
-                mpr_value *src;
+                mpr_value src[MAX_NUM_MAP_SRC];
                 mpr_value_t v = {0, 0, 1, 0, 1};
                 mpr_value_buffer_t b = {0, 0, -1};
                 b.samps = argv[0];
                 v.inst = &b;
                 v.vlen = val_len;
                 v.type = slot->sig->type;
-                src = alloca(map->num_src * sizeof(mpr_value));
                 for (i = 0; i < map->num_src; i++)
                     src[i] = (i == slot->id) ? &v : 0;
                 if (mpr_expr_eval(dev->expr_stack, map->expr, src, 0, 0, 0, 0, 0) & EXPR_RELEASE_BEFORE_UPDATE)
@@ -411,9 +561,8 @@ int mpr_dev_handler(const char *path, const char *types, lo_arg **argv, int argc
             }
 
             /* otherwise try to init reserved/stolen instance with device map */
-            idmap_idx = mpr_sig_get_idmap_with_GID(sig, GID, RELEASED_REMOTELY, ts, 1);
-            TRACE_DEV_RETURN_UNLESS(idmap_idx >= 0, 0,
-                                    "no instances available for GUID %"PR_MPR_ID" (1)\n", GID);
+            idmap_idx = mpr_sig_get_idmap_with_GID(sig, GID, RELEASED_REMOTELY, t, 1);
+            DROP_UNLESS(idmap_idx >= 0, "no instances available for GUID %"PR_MPR_ID" (1)\n", GID);
         }
         else if (sig->idmaps[idmap_idx].status & RELEASED_LOCALLY) {
             /* map was already released locally, we are only interested in release messages */
@@ -436,13 +585,15 @@ int mpr_dev_handler(const char *path, const char *types, lo_arg **argv, int argc
         }
         if (i >= sig->num_inst)
             i = 0;
-        idmap_idx = mpr_sig_get_idmap_with_LID(sig, sig->inst[i]->id, RELEASED_REMOTELY, ts, 1);
-        RETURN_ARG_UNLESS(idmap_idx >= 0, 0);
+        idmap_idx = mpr_sig_get_idmap_with_LID(sig, sig->inst[i]->id, RELEASED_REMOTELY, t, 1);
+        DROP_UNLESS(idmap_idx >= 0, "no instances available\n");
     }
     si = sig->idmaps[idmap_idx].inst;
     inst_idx = si->idx;
-    diff = mpr_time_get_diff(ts, si->time);
+    diff = mpr_time_get_diff(t, si->time);
     idmap = sig->idmaps[idmap_idx].map;
+    if (diff < 0 && si->has_val)
+        STAT_INC(dev, DEV_STAT_OUT_OF_ORDER);
 
     size = mpr_type_get_size(map ? slot->sig->type : sig->type);
     if (vals == 0) {
@@ -462,9 +613,9 @@ int mpr_dev_handler(const char *path, const char *types, lo_arg **argv, int argc
         /* Try to release instance, but do not call mpr_rtr_process_sig() here, since we don't
          * know if the local signal instance will actually be released. */
         if (sig->dir == MPR_DIR_IN)
-            mpr_sig_call_handler(sig, MPR_SIG_REL_UPSTRM, idmap->LID, 0, 0, &ts, diff);
+            mpr_sig_call_handler(sig, MPR_SIG_REL_UPSTRM, idmap->LID, 0, 0, &t, diff);
         else
-            mpr_sig_call_handler(sig, MPR_SIG_REL_DNSTRM, idmap->LID, 0, 0, &ts, diff);
+            mpr_sig_call_handler(sig, MPR_SIG_REL_DNSTRM, idmap->LID, 0, 0, &t, diff);
 
         RETURN_ARG_UNLESS(map && MPR_LOC_DST == map->process_loc && sig->dir == MPR_DIR_IN, 0);
 
@@ -478,13 +629,8 @@ int mpr_dev_handler(const char *path, const char *types, lo_arg **argv, int argc
 
     /* Partial vector updates are not allowed in convergent maps since the slot value mirrors the
      * remote signal value. */
-    if (map && vals != slot->sig->len) {
-#ifdef DEBUG
-        trace_dev(dev, "error in mpr_dev_handler: partial vector update "
-                  "applied to convergent mapping slot.");
-#endif
-        return 0;
-    }
+    DROP_UNLESS(!map || vals == slot->sig->len, "error in mpr_dev_handler: partial vector "
+                "update applied to convergent mapping slot.");
 
     all = !GID;
     if (map) {
@@ -500,9 +646,14 @@ int mpr_dev_handler(const char *path, const char *types, lo_arg **argv, int argc
             /* check if map instance is active */
             if ((si = sig->idmaps[idmap_idx].inst) && si->active) {
                 inst_idx = si->idx;
-                /* Setting to local timestamp here */
+                /* Use the sender's timetag once the clocks are synchronized */
                 /* TODO: jitter mitigation etc. */
-                mpr_value_set_samp(&slot->val, inst_idx, argv[0], dev->time);
+                mpr_value_set_samp(&slot->val, inst_idx, argv[0],
+                                   (!slot->link || slot->link->is_local_only || slot->link->clock.new)
+                                   ? dev->time : t);
+                STAT_INC(map, MAP_STAT_UPDATES_IN);
+                if (tr.id)
+                    map->trace = tr;
                 if (slot->causes_update) {
                     set_bitflag(map->updated_inst, inst_idx);
                     map->updated = 1;
@@ -515,6 +666,9 @@ int mpr_dev_handler(const char *path, const char *types, lo_arg **argv, int argc
         return 0;
     }
 
+    /* updates passed downstream continue this trace */
+    prev_trace = dev->trace;
+    dev->trace = tr;
     for (; idmap_idx < sig->idmap_len; idmap_idx++) {
         /* check if instance is active */
         if ((si = sig->idmaps[idmap_idx].inst) && si->active) {
@@ -528,12 +682,12 @@ int mpr_dev_handler(const char *path, const char *types, lo_arg **argv, int argc
             if (!compare_bitflags(si->has_val_flags, sig->vec_known, sig->len))
                 si->has_val = 1;
             if (si->has_val) {
-                memcpy(&si->time, &ts, sizeof(mpr_time));
+                memcpy(&si->time, &t, sizeof(mpr_time));
                 unset_bitflag(sig->updated_inst, si->idx);
-                mpr_sig_call_handler(sig, MPR_SIG_UPDATE, idmap->LID, sig->len, si->val, &ts, diff);
+                mpr_sig_call_handler(sig, MPR_SIG_UPDATE, idmap->LID, sig->len, si->val, &t, diff);
                 /* Pass this update downstream if signal is an input and was not updated in handler. */
                 if (!(sig->dir & MPR_DIR_OUT) && !get_bitflag(sig->updated_inst, si->idx)) {
-                    mpr_rtr_process_sig(rtr, sig, idmap_idx, si->val, ts);
+                    mpr_rtr_process_sig(rtr, sig, idmap_idx, si->val, t);
                     /* TODO: ensure update is propagated within this poll cycle */
                 }
             }
@@ -541,6 +695,7 @@ int mpr_dev_handler(const char *path, const char *types, lo_arg **argv, int argc
         if (!all)
             break;
     }
+    dev->trace = prev_trace;
     return 0;
 }
 
@@ -593,11 +748,14 @@ mpr_list mpr_dev_get_sigs(mpr_dev dev, mpr_dir dir)
 mpr_sig mpr_dev_get_sig_by_name(mpr_dev dev, const char *sig_name)
 {
     mpr_list sigs;
+    const char *path;
     RETURN_ARG_UNLESS(dev && sig_name, 0);
+    /* signal paths are interned, so an unknown path cannot match any signal */
+    RETURN_ARG_UNLESS(path = mpr_str_find_path(sig_name), 0);
     sigs = mpr_list_from_data(dev->obj.graph->sigs);
     while (sigs) {
         mpr_sig sig = (mpr_sig)*sigs;
-        if ((sig->dev == dev) && strcmp(sig->name, skip_slash(sig_name))==0)
+        if ((sig->dev == dev) && sig->path == path)
             return sig;
         sigs = mpr_list_get_next(sigs);
     }
@@ -681,6 +839,16 @@ mpr_link mpr_dev_get_link_by_remote(mpr_local_dev dev, mpr_dev remote)
     return 0;
 }
 
+MPR_INLINE static int _has_local_src(mpr_local_map map)
+{
+    int i;
+    for (i = 0; i < map->num_src; i++) {
+        if (map->src[i]->sig->is_local)
+            return 1;
+    }
+    return 0;
+}
+
 /* TODO: handle interrupt-driven updates that omit call to this function */
 MPR_INLINE static void _process_incoming_maps(mpr_local_dev dev)
 {
@@ -692,6 +860,19 @@ MPR_INLINE static void _process_incoming_maps(mpr_local_dev dev)
     /* TODO: speed this up! */
     dev->receiving = 0;
     maps = mpr_list_from_data(graph->maps);
+    if (dev->eval_pool) {
+        /* Evaluate maps with only remote sources concurrently. Maps with local sources may
+         * depend on signal handlers called for other maps so they are evaluated in order. */
+        while (maps) {
+            mpr_local_map map = *(mpr_local_map*)maps;
+            maps = mpr_list_get_next(maps);
+            if (map->is_local && map->updated && map->expr && !map->muted
+                && !_has_local_src(map))
+                mpr_eval_pool_add(dev->eval_pool, map);
+        }
+        mpr_eval_pool_run(dev->eval_pool, dev->expr_stack, dev->time);
+        maps = mpr_list_from_data(graph->maps);
+    }
     while (maps) {
         mpr_local_map map = *(mpr_local_map*)maps;
         maps = mpr_list_get_next(maps);
@@ -712,6 +893,18 @@ MPR_INLINE static int _process_outgoing_maps(mpr_local_dev dev)
     /* process and send updated maps */
     /* TODO: speed this up! */
     list = mpr_list_from_data(graph->maps);
+    if (dev->eval_pool) {
+        /* evaluate maps concurrently, then queue their messages in order below */
+        while (list) {
+            mpr_local_map map = *(mpr_local_map*)list;
+            list = mpr_list_get_next(list);
+            if (map->is_local && map->updated && map->expr && !map->muted
+                && MPR_DIR_OUT == map->src[0]->dir)
+                mpr_eval_pool_add(dev->eval_pool, map);
+        }
+        mpr_eval_pool_run(dev->eval_pool, dev->expr_stack, dev->time);
+        list = mpr_list_from_data(graph->maps);
+    }
     while (list) {
         mpr_local_map map = *(mpr_local_map*)list;
         list = mpr_list_get_next(list);
@@ -734,20 +927,41 @@ void mpr_dev_update_maps(mpr_dev dev) {
         _process_outgoing_maps((mpr_local_dev)dev);
 }
 
+/* Fill an array with the admin bus and mesh, followed by the device servers and
+ * the admin TCP server. Unregistered devices only use the admin servers. */
+int mpr_dev_get_servers(mpr_local_dev dev, lo_server *servers)
+{
+    mpr_net net = &dev->obj.graph->net;
+    if (!dev->registered) {
+        memcpy(servers, net->servers, sizeof(lo_server) * 3);
+        return 3;
+    }
+    memcpy(servers, net->servers, sizeof(lo_server) * 2);
+    memcpy(servers + 2, dev->servers, sizeof(lo_server) * 2);
+    servers[4] = net->servers[SERVER_MESH_TCP];
+    return 5;
+}
+
+/* Blocking polls return early when the polling thread is being stopped. */
+MPR_INLINE static int _stopping(mpr_local_dev dev)
+{
+    return dev->thread_data && !dev->thread_data->is_active;
+}
+
 int mpr_dev_poll(mpr_dev dev, int block_ms)
 {
-    int admin_count = 0, device_count = 0, status[4];
+    int admin_count = 0, device_count = 0, status[5];
     mpr_local_dev ldev = (mpr_local_dev)dev;
     mpr_net net;
-    lo_server servers[4];
+    lo_server servers[5];
     RETURN_ARG_UNLESS(dev && dev->is_local, 0);
     net = &dev->obj.graph->net;
     mpr_net_poll(net);
     mpr_graph_housekeeping(dev->obj.graph);
 
     if (!ldev->registered) {
-        if (lo_servers_recv_noblock(net->servers, status, 2, block_ms)) {
-            admin_count = (status[0] > 0) + (status[1] > 0);
+        if (lo_servers_recv_noblock(net->servers, status, 3, block_ms)) {
+            admin_count = (status[0] > 0) + (status[1] > 0) + (status[2] > 0);
             net->msgs_recvd |= admin_count;
         }
         ldev->bundle_idx = 1;
@@ -760,12 +974,11 @@ int mpr_dev_poll(mpr_dev dev, int block_ms)
     _process_outgoing_maps(ldev);
     ldev->polling = 0;
 
-    memcpy(servers, net->servers, sizeof(lo_server) * 2);
-    memcpy(servers + 2, ldev->servers, sizeof(lo_server) * 2);
+    mpr_dev_get_servers(ldev, servers);
 
     if (!block_ms) {
-        if (lo_servers_recv_noblock(servers, status, 4, 0)) {
-            admin_count = (status[0] > 0) + (status[1] > 0);
+        if (lo_servers_recv_noblock(servers, status, 5, 0)) {
+            admin_count = (status[0] > 0) + (status[1] > 0) + (status[4] > 0);
             device_count = (status[2] > 0) + (status[3] > 0);
             net->msgs_recvd |= admin_count;
         }
@@ -773,13 +986,40 @@ int mpr_dev_poll(mpr_dev dev, int block_ms)
     else {
         double then = mpr_get_current_time();
         int left_ms = block_ms, elapsed, checked_admin = 0;
-        while (left_ms > 0) {
+        if (!ldev->reactor)
+            ldev->reactor = mpr_reactor_new();
+        if (ldev->reactor)
+            mpr_reactor_set_servers(ldev->reactor, servers, 5);
+        while (ldev->reactor && left_ms > 0 && !_stopping(ldev)) {
+            /* sleep until a socket is readable, a signal is updated from
+             * another thread or the next ping/housekeeping deadline */
+            int due_ms = mpr_net_get_ms_until_due(net);
+            if (mpr_reactor_wait(ldev->reactor, due_ms < left_ms ? due_ms : left_ms)) {
+                ldev->wake_pending = 0;
+                ldev->polling = 1;
+                if (lo_servers_recv_noblock(servers, status, 5, 0)) {
+                    admin_count += (status[0] > 0) + (status[1] > 0) + (status[4] > 0);
+                    device_count += (status[2] > 0) + (status[3] > 0);
+                }
+                _process_incoming_maps(ldev);
+                _process_outgoing_maps(ldev);
+                ldev->polling = 0;
+                mpr_net_send(net);
+            }
+            if (due_ms <= left_ms && mpr_net_get_ms_until_due(net) <= 0) {
+                mpr_net_poll(net);
+                mpr_graph_housekeeping(dev->obj.graph);
+            }
+            elapsed = (mpr_get_current_time() - then) * 1000;
+            left_ms = block_ms - elapsed;
+        }
+        while (!ldev->reactor && left_ms > 0 && !_stopping(ldev)) {
             /* set timeout to a maximum of 100ms */
             if (left_ms > 100)
                 left_ms = 100;
             ldev->polling = 1;
-            if (lo_servers_recv_noblock(servers, status, 4, left_ms)) {
-                admin_count += (status[0] > 0) + (status[1] > 0);
+            if (lo_servers_recv_noblock(servers, status, 5, left_ms)) {
+                admin_count += (status[0] > 0) + (status[1] > 0) + (status[4] > 0);
                 device_count += (status[2] > 0) + (status[3] > 0);
             }
             /* check if any signal update bundles need to be sent */
@@ -820,12 +1060,92 @@ int mpr_dev_poll(mpr_dev dev, int block_ms)
     return admin_count + device_count;
 }
 
+int mpr_dev_get_fds(mpr_dev dev, int *fds, int num)
+{
+    int i, fd, num_servers, count = 0;
+    lo_server servers[5];
+    RETURN_ARG_UNLESS(dev && dev->is_local, 0);
+    num_servers = mpr_dev_get_servers((mpr_local_dev)dev, servers);
+    for (i = 0; i < num_servers; i++) {
+        if (!servers[i] || (fd = lo_server_get_socket_fd(servers[i])) < 0)
+            continue;
+        if (fds && count < num)
+            fds[count] = fd;
+        ++count;
+    }
+    return count;
+}
+
+int mpr_dev_get_timeout(mpr_dev dev)
+{
+    int timeout;
+    mpr_local_dev ldev = (mpr_local_dev)dev;
+    RETURN_ARG_UNLESS(dev && dev->is_local, 0);
+    RETURN_ARG_UNLESS(!ldev->sending, 0);
+    /* queued admin messages are sent by the next call to mpr_dev_on_readable() */
+    RETURN_ARG_UNLESS(!dev->obj.graph->net.bundle, 0);
+    timeout = mpr_net_get_ms_until_due(&dev->obj.graph->net);
+    /* connections accepted by TCP servers are not exposed by liblo */
+    if (ldev->tcp_open && timeout > TCP_POLL_MS)
+        timeout = TCP_POLL_MS;
+    return timeout;
+}
+
+int mpr_dev_on_readable(mpr_dev dev)
+{
+    int admin_count = 0, device_count = 0, status[5], num_servers;
+    mpr_local_dev ldev = (mpr_local_dev)dev;
+    mpr_net net;
+    lo_server servers[5];
+    RETURN_ARG_UNLESS(dev && dev->is_local, 0);
+    net = &dev->obj.graph->net;
+
+    num_servers = mpr_dev_get_servers(ldev, servers);
+    ldev->wake_pending = 0;
+    ldev->polling = 1;
+    if (ldev->registered) {
+        ldev->time_is_stale = 1;
+        mpr_dev_get_time(dev);
+    }
+    if (lo_servers_recv_noblock(servers, status, num_servers, 0)) {
+        admin_count = (status[0] > 0) + (status[1] > 0) + (status[num_servers - 1] > 0);
+        if (ldev->registered) {
+            device_count = (status[2] > 0) + (status[3] > 0);
+            if (status[3] > 0 || status[4] > 0)
+                ldev->tcp_open = 1;
+        }
+        net->msgs_recvd |= admin_count;
+    }
+    if (ldev->registered) {
+        _process_incoming_maps(ldev);
+        _process_outgoing_maps(ldev);
+    }
+    else
+        ldev->bundle_idx = 1;
+    ldev->polling = 0;
+
+    /* admin handlers only queue their replies */
+    mpr_net_send(net);
+
+    if (mpr_net_get_ms_until_due(net) <= 0) {
+        mpr_net_poll(net);
+        mpr_graph_housekeeping(dev->obj.graph);
+    }
+
+    if (dev->obj.props.synced->dirty && mpr_dev_get_is_ready(dev) && ldev->subscribers) {
+        /* inform device subscribers of changed properties */
+        mpr_net_use_subscribers(net, ldev, MPR_DEV);
+        mpr_dev_send_state(dev, MSG_DEV);
+    }
+    return admin_count + device_count;
+}
+
 #ifdef HAVE_LIBPTHREAD
 static void *device_thread_func(void *data)
 {
     mpr_thread_data td = (mpr_thread_data)data;
     while (td->is_active) {
-        mpr_dev_poll((mpr_dev)td->object, 100);
+        mpr_dev_poll((mpr_dev)td->object, 1000);
     }
     td->is_done = 1;
     pthread_exit(NULL);
@@ -838,7 +1158,7 @@ static unsigned __stdcall device_thread_func(void *data)
 {
     mpr_thread_data td = (mpr_thread_data)data;
     while (td->is_active) {
-        mpr_dev_poll((mpr_dev)td->object, 100);
+        mpr_dev_poll((mpr_dev)td->object, 1000);
     }
     td->is_done = 1;
     _endthread();
@@ -851,9 +1171,14 @@ int mpr_dev_start_polling(mpr_dev dev)
     mpr_thread_data td;
     int result = 0;
     RETURN_ARG_UNLESS(dev && dev->is_local, 0);
-    if (((mpr_local_dev)dev)->thread_data)
+    if (((mpr_local_dev)dev)->thread_data || ((mpr_local_dev)dev)->pool_worker)
         return 0;
 
+    /* use a shared polling thread if enabled with mpr_set_poll_threads() */
+    if ((result = mpr_pool_add_dev((mpr_local_dev)dev)) <= 0)
+        return result;
+    result = 0;
+
     td = (mpr_thread_data)malloc(sizeof(mpr_thread_data_t));
     td->object = (mpr_obj)dev;
     td->is_active = 1;
@@ -885,10 +1210,15 @@ int mpr_dev_stop_polling(mpr_dev dev)
     mpr_thread_data td;
     int result = 0;
     RETURN_ARG_UNLESS(dev && dev->is_local, 0);
+    if (((mpr_local_dev)dev)->pool_worker) {
+        mpr_pool_remove_dev((mpr_local_dev)dev);
+        return 0;
+    }
     td = ((mpr_local_dev)dev)->thread_data;
     if (!td || !td->is_active)
         return 0;
     td->is_active = 0;
+    mpr_reactor_wake(((mpr_local_dev)dev)->reactor);
 
 #ifdef HAVE_LIBPTHREAD
     result = pthread_join(td->thread, NULL);
@@ -916,6 +1246,118 @@ int mpr_dev_stop_polling(mpr_dev dev)
     return result;
 }
 
+int mpr_dev_set_eval_threads(mpr_dev dev, int num_threads)
+{
+    mpr_local_dev ldev = (mpr_local_dev)dev;
+    RETURN_ARG_UNLESS(dev && dev->is_local && num_threads >= 0, -1);
+    FUNC_IF(mpr_eval_pool_free, ldev->eval_pool);
+    ldev->eval_pool = 0;
+    RETURN_ARG_UNLESS(num_threads > 1, 0);
+    ldev->eval_pool = mpr_eval_pool_new(num_threads);
+    return ldev->eval_pool ? 0 : -1;
+}
+
+static mpr_local_slot _first_local_slot(mpr_local_map map)
+{
+    int i;
+    if (map->dst->rsig)
+        return map->dst;
+    for (i = 0; i < map->num_src; i++) {
+        if (map->src[i]->rsig)
+            return map->src[i];
+    }
+    return 0;
+}
+
+/* Call a function once for each local map of a device. */
+static void _for_each_local_map(mpr_local_dev dev, void (*func)(mpr_local_map, void*), void *data)
+{
+    mpr_rtr_sig rs = dev->obj.graph->net.rtr->sigs;
+    int i;
+    for (; rs; rs = rs->next) {
+        if (rs->sig->dev != dev)
+            continue;
+        for (i = 0; i < rs->num_slots; i++) {
+            if (rs->slots[i] && rs->slots[i] == _first_local_slot(rs->slots[i]->map))
+                func(rs->slots[i]->map, data);
+        }
+    }
+}
+
+static void _set_map_stats(mpr_local_map map, void *enable)
+{
+    mpr_map_set_stats(map, *(int*)enable);
+}
+
+static void _send_map_stats(mpr_local_map map, void *dev)
+{
+    RETURN_UNLESS(map->stats && map->status >= MPR_STATUS_READY);
+    mpr_net_use_subscribers(&map->obj.graph->net, (mpr_local_dev)dev,
+                            map->dst->rsig ? MPR_MAP_IN : MPR_MAP_OUT);
+    mpr_map_send_state((mpr_map)map, -1, MSG_MAPPED);
+}
+
+int mpr_dev_set_stats(mpr_dev dev, int enable)
+{
+    mpr_local_dev ldev = (mpr_local_dev)dev;
+    mpr_list links;
+    RETURN_ARG_UNLESS(dev && dev->is_local, -1);
+    enable = enable != 0;
+    RETURN_ARG_UNLESS(enable != (ldev->stats != 0), 0);
+    if (enable) {
+        ldev->stats = (int64_t*)calloc(1, NUM_DEV_STATS * sizeof(int64_t));
+        RETURN_ARG_UNLESS(ldev->stats, -1);
+        mpr_tbl_link_key(dev->obj.props.synced, "stats", NUM_DEV_STATS, MPR_INT64,
+                         ldev->stats, NON_MODIFIABLE);
+    }
+    else {
+        mpr_tbl_unlink_key(dev->obj.props.synced, "stats");
+        free(ldev->stats);
+        ldev->stats = 0;
+    }
+    links = mpr_dev_get_links(dev, MPR_DIR_ANY);
+    while (links) {
+        mpr_link link = (mpr_link)*links;
+        links = mpr_list_get_next(links);
+        if (link->devs[LOCAL_DEV] == dev)
+            mpr_link_set_stats(link, enable);
+    }
+    _for_each_local_map(ldev, _set_map_stats, &enable);
+    dev->obj.props.synced->dirty = 1;
+    return 0;
+}
+
+int mpr_dev_set_tracing(mpr_dev dev, int enable)
+{
+    mpr_local_dev ldev = (mpr_local_dev)dev;
+    RETURN_ARG_UNLESS(dev && dev->is_local, -1);
+    enable = enable != 0;
+    RETURN_ARG_UNLESS(enable != (ldev->latency != 0), 0);
+    if (enable) {
+        ldev->latency = (int64_t*)calloc(1, NUM_LATENCY_STATS * sizeof(int64_t));
+        RETURN_ARG_UNLESS(ldev->latency, -1);
+        mpr_tbl_link_key(dev->obj.props.synced, "latency", NUM_LATENCY_STATS, MPR_INT64,
+                         ldev->latency, NON_MODIFIABLE);
+    }
+    else {
+        mpr_tbl_unlink_key(dev->obj.props.synced, "latency");
+        free(ldev->latency);
+        ldev->latency = 0;
+    }
+    dev->obj.props.synced->dirty = 1;
+    return 0;
+}
+
+void mpr_dev_send_stats(mpr_local_dev dev)
+{
+    mpr_net net = &dev->obj.graph->net;
+    RETURN_UNLESS((dev->stats || dev->latency) && dev->subscribers
+                  && mpr_dev_get_is_ready((mpr_dev)dev));
+    mpr_net_use_subscribers(net, dev, MPR_DEV);
+    mpr_dev_send_state((mpr_dev)dev, MSG_DEV);
+    _for_each_local_map(dev, _send_map_stats, dev);
+}
+
 mpr_time mpr_dev_get_time(mpr_dev dev)
 {
     RETURN_ARG_UNLESS(dev && dev->is_local, MPR_NOW);
@@ -1091,15 +1533,13 @@ static void mpr_dev_start_servers(mpr_local_dev dev)
 
 const char *mpr_dev_get_name(mpr_dev dev)
 {
-    unsigned int len;
+    char name[256];
     RETURN_ARG_UNLESS(!dev->is_local || (   ((mpr_local_dev)dev)->registered
                                          && ((mpr_local_dev)dev)->ordinal_allocator.locked), 0);
     if (dev->name)
         return dev->name;
-    len = strlen(dev->prefix) + 6;
-    dev->name = (char*)malloc(len);
-    dev->name[0] = 0;
-    snprintf(dev->name, len, "%s.%d", dev->prefix, ((mpr_local_dev)dev)->ordinal_allocator.val);
+    snprintf(name, 256, "%s.%d", dev->prefix, ((mpr_local_dev)dev)->ordinal_allocator.val);
+    dev->name = mpr_str_intern(name);
     return dev->name;
 }
 
@@ -1129,6 +1569,12 @@ void mpr_dev_send_state(mpr_dev dev, net_msg_t cmd)
     /* properties */
     mpr_tbl_add_to_msg(dev->is_local ? dev->obj.props.synced : 0, dev->obj.props.staged, msg);
 
+    /* multicast group shared by subscribers */
+    if (dev->is_local && ((mpr_local_dev)dev)->sub_group_url) {
+        lo_message_add_string(msg, "@group");
+        lo_message_add_string(msg, ((mpr_local_dev)dev)->sub_group_url);
+    }
+
     if (cmd == MSG_DEV_MOD) {
         char str[1024];
         snprintf(str, 1024, "/%s/modify", dev->name);
@@ -1256,11 +1702,14 @@ int mpr_dev_set_from_msg(mpr_dev dev, mpr_msg m)
     return updated;
 }
 
-static int mpr_dev_send_sigs(mpr_local_dev dev, mpr_dir dir)
+static int mpr_dev_send_sigs(mpr_local_dev dev, mpr_dir dir, int version)
 {
     mpr_list l = mpr_dev_get_sigs((mpr_dev)dev, dir);
     while (l) {
-        mpr_sig_send_state((mpr_sig)*l, MSG_SIG);
+        if (version < 0)
+            mpr_sig_send_state((mpr_sig)*l, MSG_SIG);
+        else
+            mpr_sig_send_changes((mpr_sig)*l, version);
         l = mpr_list_get_next(l);
     }
     return 0;
@@ -1287,13 +1736,35 @@ int mpr_dev_send_maps(mpr_local_dev dev, mpr_dir dir, int msg)
     return 0;
 }
 
+void mpr_dev_record_change(mpr_local_dev dev, int maps, int removed)
+{
+    mpr_obj_increment_version((mpr_obj)dev);
+    if (maps)
+        dev->maps_version = dev->obj.version;
+    if (removed)
+        dev->removed_version = dev->obj.version;
+}
+
+void mpr_dev_release_sub_group(mpr_local_dev dev)
+{
+    RETURN_UNLESS(dev->sub_group && !dev->subscribers);
+    trace_dev(dev, "releasing subscriber group %s\n", dev->sub_group_url);
+    lo_address_free(dev->sub_group);
+    dev->sub_group = 0;
+    FUNC_IF(free, dev->sub_group_url);
+    dev->sub_group_url = 0;
+}
+
 /* Add/renew/remove a subscription. */
 void mpr_dev_manage_subscriber(mpr_local_dev dev, lo_address addr, int flags,
-                               int timeout_sec, int revision)
+                               int timeout_sec, int revision, int bulk_port,
+                               int in_group)
 {
     mpr_time t;
     mpr_net net;
-    mpr_subscriber *s = &dev->subscribers;
+    lo_address bulk_addr = 0;
+    int num_subs = 0;
+    mpr_subscriber *s = &dev->subscribers, rec = 0;
     const char *ip = lo_address_get_hostname(addr);
     const char *port = lo_address_get_port(addr);
     RETURN_UNLESS(ip && port);
@@ -1312,7 +1783,9 @@ void mpr_dev_manage_subscriber(mpr_local_dev dev, lo_address addr, int flags,
                     trace_dev(dev, "removing subscription from %s:%s\n", s_ip, s_port);
                     *s = temp->next;
                     FUNC_IF(lo_address_free, temp->addr);
+                    FUNC_IF(lo_address_free, temp->bulk_addr);
                     free(temp);
+                    mpr_dev_release_sub_group(dev);
                     RETURN_UNLESS(flags && (flags &= ~prev_flags));
                 }
                 else {
@@ -1324,8 +1797,10 @@ void mpr_dev_manage_subscriber(mpr_local_dev dev, lo_address addr, int flags,
                     print_subscription_flags(flags);
     #endif
                     (*s)->lease_exp = t.sec + timeout_sec;
+                    (*s)->in_group = in_group && dev->sub_group;
                     flags &= ~(*s)->flags;
                     (*s)->flags = temp;
+                    rec = *s;
                 }
                 break;
             }
@@ -1345,34 +1820,96 @@ void mpr_dev_manage_subscriber(mpr_local_dev dev, lo_address addr, int flags,
         sub->addr = lo_address_new(ip, port);
         sub->lease_exp = t.sec + timeout_sec;
         sub->flags = flags;
+        sub->in_group = in_group && dev->sub_group;
+        sub->bulk_addr = 0;
         sub->next = dev->subscribers;
-        dev->subscribers = sub;
+        dev->subscribers = rec = sub;
+
+        /* Once there are enough subscribers, open a multicast group for them so
+         * that each metadata change is sent once rather than once per peer.
+         * Subscribers that join it say so when they next renew their lease. */
+        if (!dev->sub_group) {
+            for (sub = dev->subscribers; sub; sub = sub->next)
+                ++num_subs;
+            if (num_subs >= SUB_GROUP_MIN) {
+                net = &dev->obj.graph->net;
+                dev->sub_group = mpr_net_new_sub_group(net, dev->obj.id, &dev->sub_group_url);
+                if (dev->sub_group) {
+                    /* advertise the group to existing subscribers */
+                    mpr_net_use_subscribers(net, dev, MPR_DEV);
+                    mpr_dev_send_state((mpr_dev)dev, MSG_DEV);
+                }
+            }
+        }
     }
 
+    /* A revision newer than our own must have been recorded from a previous
+     * instance of this device, and removals cannot be sent as changes since a
+     * revision, so in both cases we need to send everything. */
+    if (revision > dev->obj.version || revision < dev->removed_version)
+        revision = -1;
+#ifdef DEBUG
+    if (revision >= 0)
+        trace_dev(dev, "sending changes since revision %d to %s:%s\n", revision, ip, port);
+#endif
+
     /* bring new subscriber up to date */
     net = &dev->obj.graph->net;
     mpr_net_use_mesh(net, addr);
     mpr_dev_send_state((mpr_dev)dev, MSG_DEV);
     mpr_net_send(net);
 
+    /* Large inventories are sent as a single compressed bundle over TCP if the
+     * subscriber supports it, rather than as a burst of UDP packets. */
+    if (bulk_port && (flags & (MPR_SIG | MPR_MAP))
+        && (  dev->num_inputs + dev->num_outputs
+            + dev->num_maps_in + dev->num_maps_out) >= BULK_MIN_OBJS) {
+        char port_str[10];
+        snprintf(port_str, 10, "%d", bulk_port);
+        /* subscribers keep their TCP address so that later resyncs reuse the connection */
+        if (rec && rec->bulk_addr && strcmp(lo_address_get_port(rec->bulk_addr), port_str)) {
+            lo_address_free(rec->bulk_addr);
+            rec->bulk_addr = 0;
+        }
+        if (!rec || !rec->bulk_addr)
+            bulk_addr = lo_address_new_with_proto(LO_TCP, ip, port_str);
+        if (rec) {
+            if (!rec->bulk_addr)
+                rec->bulk_addr = bulk_addr;
+            bulk_addr = rec->bulk_addr;
+        }
+    }
+
     if (flags & MPR_SIG) {
         mpr_dir dir = 0;
         if (flags & MPR_SIG_IN)
             dir |= MPR_DIR_IN;
         if (flags & MPR_SIG_OUT)
             dir |= MPR_DIR_OUT;
-        mpr_net_use_mesh(net, addr);
-        mpr_dev_send_sigs(dev, dir);
-        mpr_net_send(net);
+        if (bulk_addr)
+            mpr_net_use_bulk(net, bulk_addr);
+        else
+            mpr_net_use_mesh(net, addr);
+        mpr_dev_send_sigs(dev, dir, revision);
+        if (!bulk_addr)
+            mpr_net_send(net);
     }
-    if (flags & MPR_MAP) {
+    if ((flags & MPR_MAP) && dev->maps_version > revision) {
         mpr_dir dir = 0;
         if (flags & MPR_MAP_IN)
             dir |= MPR_DIR_IN;
         if (flags & MPR_MAP_OUT)
             dir |= MPR_DIR_OUT;
-        mpr_net_use_mesh(net, addr);
+        if (bulk_addr)
+            mpr_net_use_bulk(net, bulk_addr);
+        else
+            mpr_net_use_mesh(net, addr);
         mpr_dev_send_maps(dev, dir, MSG_MAPPED);
         mpr_net_send(net);
     }
+    if (bulk_addr) {
+        mpr_net_send(net);
+        if (!rec)
+            lo_address_free(bulk_addr);
+    }
 }
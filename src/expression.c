@@ -11,6 +11,7 @@
 #define MAX_HIST_SIZE 100
 #define STACK_SIZE 64
 #define N_USER_VARS 16
+#define N_USER_TBLS 8
 #ifdef DEBUG
     #define TRACE_PARSE 0 /* Set non-zero to see trace during parse. */
     #define TRACE_EVAL 0 /* Set non-zero to see trace during evaluation. */
@@ -425,6 +426,11 @@ typedef enum {
     FN_SIG_IDX,
     FN_VEC_IDX,
     FN_UNIFORM,
+    /* table functions are evaluated separately and should remain last */
+    FN_LUT,
+    FN_LUT_CUBIC,
+    FN_CURVE,
+    FN_CURVE_CUBIC,
     N_FN
 } expr_fn_t;
 
@@ -476,6 +482,10 @@ static struct {
     { "sig_idx",  1, 0, (void*)1,     0,                0                },
     { "vec_idx",  1, 0, (void*)1,     0,                0                },
     { "uniform",  1, 0, 0,            (void*)uniformf,  (void*)uniformd  },
+    { "lut",        1, 0, 0,          (void*)1,         (void*)1         },
+    { "lutCubic",   1, 0, 0,          (void*)1,         (void*)1         },
+    { "curve",      1, 0, 0,          (void*)1,         (void*)1         },
+    { "curveCubic", 1, 0, 0,          (void*)1,         (void*)1         },
 };
 
 typedef enum {
@@ -718,6 +728,7 @@ struct function_type {
     /* end of generic_type */
     int8_t idx;
     uint8_t arity;          /* used by TOK_FN, TOK_VFN, TOK_VECTORIZE */
+    uint8_t tbl_idx;        /* only used by table functions */
 };
 
 enum reduce_type {
@@ -766,6 +777,14 @@ typedef struct _var {
     uint8_t flags;
 } mpr_var_t, *mpr_var;
 
+/* Lookup tables are stored as map properties named "lut.<name>" (values sampled uniformly over
+ * the input range [0, 1]) or "curve.<name>" (interleaved x, y breakpoints with increasing x). */
+typedef struct _tbl {
+    char *name;             /* property key */
+    double *vals;
+    int len;                /* number of samples or breakpoints */
+} mpr_tbl_data_t, *mpr_tbl_data;
+
 static int strncmp_lc(const char *a, const char *b, int len)
 {
     int i;
@@ -800,6 +819,16 @@ FN_LOOKUP(fn, FN, 0)
 FN_LOOKUP(vfn, VFN, 0)
 FN_LOOKUP(rfn, RFN, 1)
 
+static expr_fn_t tfn_lookup(const char *s, int len)
+{
+    int i;
+    for (i = FN_LUT; i < N_FN; i++) {
+        if (strlen(fn_tbl[i].name) == len && strncmp_lc(s, fn_tbl[i].name, len)==0)
+            return i;
+    }
+    return FN_UNKNOWN;
+}
+
 static int var_lookup(mpr_token_t *tok, const char *s, int len)
 {
     if ('t' == *s && '_' == *(s+1)) {
@@ -1137,7 +1166,19 @@ static int expr_lex(const char *str, int idx, mpr_token_t *tok)
         }
         while (c && (isalpha(c) || isdigit(c) || c == '_'))
             c = str[++idx];
-        if ((tok->fn.idx = fn_lookup(str+i, idx-i)) != FN_UNKNOWN)
+        if ('.' == c && (tok->fn.idx = tfn_lookup(str+i, idx-i)) != FN_UNKNOWN) {
+            /* table function: skip over the table name, which is retrieved by the parser */
+            i = ++idx;
+            c = str[idx];
+            while (c && (isalpha(c) || isdigit(c) || c == '_'))
+                c = str[++idx];
+            if (idx == i || c != '(') {
+                lex_error("Malformed table reference `%s'.\n", str+i);
+                break;
+            }
+            tok->toktype = TOK_FN;
+        }
+        else if ((tok->fn.idx = fn_lookup(str+i, idx-i)) != FN_UNKNOWN && tok->fn.idx < FN_LUT)
             tok->toktype = TOK_FN;
         else if ((tok->fn.idx = vfn_lookup(str+i, idx-i)) != VFN_UNKNOWN)
             tok->toktype = TOK_VFN;
@@ -1164,8 +1205,14 @@ struct _mpr_expr
     int8_t mute_ctl;
     int8_t n_ins;
     uint16_t max_in_hist_size;
+    mpr_tbl_data tbls;
+    uint8_t n_tbls;
 };
 
+void mpr_expr_stack_reserve(mpr_expr_stack stk, mpr_expr expr) {
+    expr_stack_realloc(stk, expr->stack_size * expr->vec_len);
+}
+
 static void free_stack_vliterals(mpr_token_t *stk, int top)
 {
     while (top >= 0) {
@@ -1186,6 +1233,13 @@ void mpr_expr_free(mpr_expr expr)
             free(expr->vars[i].name);
         free(expr->vars);
     }
+    if (expr->n_tbls && expr->tbls) {
+        for (i = 0; i < expr->n_tbls; i++) {
+            free(expr->tbls[i].name);
+            FUNC_IF(free, expr->tbls[i].vals);
+        }
+        free(expr->tbls);
+    }
     free(expr);
 }
 
@@ -2356,9 +2410,11 @@ mpr_expr mpr_expr_new_from_str(mpr_expr_stack eval_stk, const char *str, int n_i
     int vec_len_ctx = 0;
 
     mpr_var_t vars[N_USER_VARS];
+    mpr_tbl_data_t tbls[N_USER_TBLS];
     temp_var_cache temp_vars = NULL;
     /* TODO: optimise these vars */
     int n_vars = 0;
+    int n_tbls = 0;
     int inst_ctl = -1;
     int mute_ctl = -1;
     mpr_token_t tok;
@@ -2604,6 +2660,33 @@ mpr_expr mpr_expr_new_from_str(mpr_expr_stack eval_stk, const char *str, int n_i
             }
             case TOK_FN: {
                 mpr_token_t newtok;
+                if (tok.fn.idx >= FN_LUT) {
+                    /* find or add the table referenced by name */
+                    int len, key_len;
+                    char *key;
+                    const char *name = _get_var_str_and_len(str, lex_idx - 1, &len);
+                    const char *prefix = tok.fn.idx >= FN_CURVE ? "curve" : "lut";
+                    key_len = strlen(prefix) + len + 2;
+                    key = malloc(key_len);
+                    snprintf(key, key_len, "%s.%.*s", prefix, len, name);
+                    for (i = 0; i < n_tbls; i++) {
+                        if (0 == strcmp(tbls[i].name, key))
+                            break;
+                    }
+                    if (i < n_tbls)
+                        free(key);
+                    else {
+                        if (n_tbls >= N_USER_TBLS) {
+                            free(key);
+                            {FAIL("Maximum number of tables exceeded.");}
+                        }
+                        tbls[n_tbls].name = key;
+                        tbls[n_tbls].vals = NULL;
+                        tbls[n_tbls].len = 0;
+                        ++n_tbls;
+                    }
+                    tok.fn.tbl_idx = i;
+                }
                 tok.gen.datatype = fn_tbl[tok.fn.idx].fn_int ? MPR_INT32 : MPR_FLT;
                 tok.fn.arity = fn_tbl[tok.fn.idx].arity;
                 if (fn_tbl[tok.fn.idx].memory) {
@@ -3944,6 +4027,15 @@ mpr_expr mpr_expr_new_from_str(mpr_expr_stack eval_stk, const char *str, int n_i
         expr->vars = NULL;
 
     expr->n_vars = n_vars;
+
+    if (n_tbls) {
+        /* copy table references, the table data is provided by mpr_expr_set_tbl() */
+        expr->tbls = malloc(sizeof(mpr_tbl_data_t) * n_tbls);
+        memcpy(expr->tbls, tbls, sizeof(mpr_tbl_data_t) * n_tbls);
+    }
+    else
+        expr->tbls = NULL;
+    expr->n_tbls = n_tbls;
     /* TODO: is this the same as n_ins arg passed to this function? */
     expr->n_ins = n_ins;
 
@@ -3957,6 +4049,8 @@ mpr_expr mpr_expr_new_from_str(mpr_expr_stack eval_stk, const char *str, int n_i
 error:
     while (--n_vars >= 0)
         free(vars[n_vars].name);
+    while (--n_tbls >= 0)
+        free(tbls[n_tbls].name);
     while (temp_vars) {
         temp_var_cache tmp = temp_vars->next;
         free((char*)temp_vars->in_name);
@@ -4038,6 +4132,66 @@ void mpr_expr_var_updated(mpr_expr expr, int var_idx)
     return;
 }
 
+int mpr_expr_get_num_tbls(mpr_expr expr)
+{
+    return expr->n_tbls;
+}
+
+const char *mpr_expr_get_tbl_name(mpr_expr expr, int idx)
+{
+    return (idx >= 0 && idx < expr->n_tbls) ? expr->tbls[idx].name : NULL;
+}
+
+int mpr_expr_set_tbl(mpr_expr expr, const char *name, int len, mpr_type type, const void *vals)
+{
+    int i, is_curve, min_len;
+    mpr_tbl_data tbl = NULL;
+    RETURN_ARG_UNLESS(expr && name, 0);
+    for (i = 0; i < expr->n_tbls; i++) {
+        if (0 == strcmp(expr->tbls[i].name, name)) {
+            tbl = &expr->tbls[i];
+            break;
+        }
+    }
+    RETURN_ARG_UNLESS(tbl, 0);
+
+    /* tables that are missing or malformed pass their input through unchanged */
+    tbl->len = 0;
+    is_curve = ('c' == name[0]);
+    min_len = is_curve ? 4 : 2;
+    if (!vals || len < min_len || (is_curve && len % 2)) {
+        trace("table '%s' is missing or too short.\n", name);
+        return 1;
+    }
+    tbl->vals = realloc(tbl->vals, sizeof(double) * len);
+    switch (type) {
+#define TYPED_CASE(MTYPE, TYPE)                         \
+        case MTYPE:                                     \
+            for (i = 0; i < len; i++)                   \
+                tbl->vals[i] = (double)((TYPE*)vals)[i];\
+            break;
+        TYPED_CASE(MPR_INT32, int)
+        TYPED_CASE(MPR_FLT, float)
+        TYPED_CASE(MPR_DBL, double)
+#undef TYPED_CASE
+        default:
+            trace("table '%s' has unsupported type '%c'.\n", name, type);
+            return 1;
+    }
+    if (is_curve) {
+        /* breakpoints must be sorted for the binary search */
+        for (i = 2; i < len; i += 2) {
+            if (!(tbl->vals[i] > tbl->vals[i - 2])) {
+                trace("curve '%s' breakpoints are not strictly increasing.\n", name);
+                return 1;
+            }
+        }
+        len /= 2;
+    }
+    tbl->len = len;
+    return 1;
+}
+
 #if TRACE_EVAL
 static void print_stack_vec(mpr_expr_val stk, mpr_type type, int vec_len, int dp)
 {
@@ -4117,6 +4271,82 @@ MPR_INLINE static int _max(int a, int b)
     return a > b ? a : b;
 }
 
+/* Cubic Hermite interpolation between y0 and y1, with tangents scaled to the segment width. */
+MPR_INLINE static double _hermite(double y0, double y1, double m0, double m1, double t)
+{
+    double t2 = t * t, t3 = t2 * t;
+    return (2 * t3 - 3 * t2 + 1) * y0 + (t3 - 2 * t2 + t) * m0
+           + (3 * t2 - 2 * t3) * y1 + (t3 - t2) * m1;
+}
+
+/* Uniformly-sampled table over [0, 1]: the segment is found directly in O(1). */
+static double _interp_lut(mpr_tbl_data tbl, double x, int cubic)
+{
+    const double *y = tbl->vals;
+    int k, n = tbl->len;
+    double t, m0, m1;
+    if (!(x > 0.))
+        return y[0];
+    if (x >= 1.)
+        return y[n - 1];
+    t = x * (n - 1);
+    k = (int)t;
+    if (k > n - 2)
+        k = n - 2;
+    t -= k;
+    if (!cubic)
+        return y[k] + (y[k + 1] - y[k]) * t;
+    /* Catmull-Rom tangents, one-sided at the ends of the table */
+    m0 = k > 0 ? (y[k + 1] - y[k - 1]) * 0.5 : y[1] - y[0];
+    m1 = k < n - 2 ? (y[k + 2] - y[k]) * 0.5 : y[n - 1] - y[n - 2];
+    return _hermite(y[k], y[k + 1], m0, m1, t);
+}
+
+/* Piecewise curve of interleaved x, y breakpoints: the segment is found by binary search. */
+static double _interp_curve(mpr_tbl_data tbl, double x, int cubic)
+{
+    const double *p = tbl->vals;
+    int lo = 0, hi = tbl->len - 1, mid;
+    double h, t, m0, m1;
+    if (!(x > p[0]))
+        return p[1];
+    if (x >= p[2 * hi])
+        return p[2 * hi + 1];
+    while (hi - lo > 1) {
+        mid = (lo + hi) >> 1;
+        if (p[2 * mid] <= x)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    p += 2 * lo;
+    h = p[2] - p[0];
+    t = (x - p[0]) / h;
+    if (!cubic)
+        return p[1] + (p[3] - p[1]) * t;
+    /* finite-difference tangents, one-sided at the ends of the curve */
+    m0 = lo > 0 ? (p[3] - p[-1]) / (p[2] - p[-2]) : (p[3] - p[1]) / h;
+    m1 = hi < tbl->len - 1 ? (p[5] - p[1]) / (p[4] - p[0]) : (p[3] - p[1]) / h;
+    return _hermite(p[1], p[3], m0 * h, m1 * h, t);
+}
+
+/* Apply a table function to each element of a stack vector. Inputs outside the range of the
+ * table are clamped, and tables without data pass their input through unchanged. */
+static void _eval_tbl(mpr_tbl_data tbl, expr_fn_t fn, mpr_expr_val val, int len, mpr_type type)
+{
+    int i, cubic = (FN_LUT_CUBIC == fn || FN_CURVE_CUBIC == fn);
+    double x;
+    RETURN_UNLESS(tbl->len);
+    for (i = 0; i < len; i++) {
+        x = MPR_DBL == type ? val[i].d : val[i].f;
+        x = fn >= FN_CURVE ? _interp_curve(tbl, x, cubic) : _interp_lut(tbl, x, cubic);
+        if (MPR_DBL == type)
+            val[i].d = x;
+        else
+            val[i].f = (float)x;
+    }
+}
+
 int mpr_expr_eval(mpr_expr_stack expr_stk, mpr_expr expr, mpr_value *v_in, mpr_value *v_vars,
                   mpr_value v_out, mpr_time *time, mpr_type *out_types, int inst_idx)
 {
@@ -4601,6 +4831,14 @@ int mpr_expr_eval(mpr_expr_stack expr_stk, mpr_expr expr, mpr_value *v_in, mpr_v
             ldim = dims[dp];
             rdim = dims[dp + 1];
             types[dp] = tok->gen.datatype;
+            if (tok->fn.idx >= FN_LUT) {
+                _eval_tbl(expr->tbls + tok->fn.tbl_idx, tok->fn.idx, stk + sp, ldim, types[dp]);
+                can_advance = 0;
+#if TRACE_EVAL
+                print_stack_vec(stk + sp, types[dp], dims[dp], dp);
+#endif
+                break;
+            }
             switch (types[dp]) {
 #define TYPED_CASE(MTYPE, FN, T)                                                        \
             case MTYPE:                                                                 \
@@ -22,6 +22,117 @@ static unsigned __stdcall graph_thread_func(void *data);
 #define AUTOSUB_INTERVAL 60
 extern const char* net_msg_strings[NUM_MSG_STRINGS];
 
+/* Housekeeping deadlines are kept in a binary min-heap so that polling only
+ * does work when something is due. Deadlines are only ever pushed later by the
+ * protocol, so entries are not updated when a device syncs or a lease is
+ * renewed; instead they are checked and rescheduled when they reach the top. */
+#define DEADLINE_EXPIRY 1
+#define DEADLINE_RENEW  2
+
+/* Maximum number of subscriber groups watched by the event loop; any others
+ * are serviced at the next housekeeping deadline. */
+#define MAX_WATCHED_GROUPS 16
+
+MPR_INLINE static int *_heap_pos(mpr_deadline d)
+{
+    return (DEADLINE_EXPIRY == d->type) ? &((mpr_dev)d->obj)->heap_pos
+                                        : &((mpr_subscription)d->obj)->heap_pos;
+}
+
+static void _heap_swap(mpr_graph g, int i, int j)
+{
+    mpr_deadline_t *e = g->deadlines.entries, tmp = e[i];
+    e[i] = e[j];
+    e[j] = tmp;
+    *_heap_pos(&e[i]) = i + 1;
+    *_heap_pos(&e[j]) = j + 1;
+}
+
+static void _heap_fix(mpr_graph g, int i)
+{
+    mpr_deadline_t *e = g->deadlines.entries;
+    int len = g->deadlines.len;
+    while (i > 0 && e[i].sec < e[(i - 1) / 2].sec) {
+        _heap_swap(g, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+    while (1) {
+        int min = i, l = i * 2 + 1, r = l + 1;
+        if (l < len && e[l].sec < e[min].sec)
+            min = l;
+        if (r < len && e[r].sec < e[min].sec)
+            min = r;
+        if (min == i)
+            break;
+        _heap_swap(g, i, min);
+        i = min;
+    }
+}
+
+/* Add an entry for an object, or move its existing entry to a new deadline. */
+static void _heap_set(mpr_graph g, int type, void *obj, int *pos, uint32_t sec)
+{
+    if (!*pos) {
+        if (g->deadlines.len >= g->deadlines.size) {
+            int size = g->deadlines.size ? g->deadlines.size * 2 : 16;
+            mpr_deadline_t *e = realloc(g->deadlines.entries, size * sizeof(mpr_deadline_t));
+            RETURN_UNLESS(e);
+            g->deadlines.entries = e;
+            g->deadlines.size = size;
+        }
+        *pos = ++g->deadlines.len;
+        g->deadlines.entries[*pos - 1].type = type;
+        g->deadlines.entries[*pos - 1].obj = obj;
+    }
+    g->deadlines.entries[*pos - 1].sec = sec;
+    _heap_fix(g, *pos - 1);
+}
+
+static void _heap_remove(mpr_graph g, int *pos)
+{
+    int i = *pos - 1, last = --g->deadlines.len;
+    if (i != last) {
+        _heap_swap(g, i, last);
+        *pos = 0;
+        _heap_fix(g, i);
+    }
+    else
+        *pos = 0;
+}
+
+/* Find a subscription other than s whose group server listens on the same group. */
+static mpr_subscription _find_group(mpr_subscription list, mpr_subscription s, const char *url)
+{
+    while (list) {
+        if (list != s && list->group && (url ? !strcmp(list->group_url, url)
+                                             : list->group == s->group))
+            return list;
+        list = list->next;
+    }
+    return 0;
+}
+
+/* Free a subscription and its group server, unless the server is shared with another
+ * subscription to a device whose id hashes to the same group. */
+static void _free_subscription(mpr_graph g, mpr_subscription s)
+{
+    if (   s->group && !_find_group(g->subscriptions, s, 0)
+        && !_find_group(g->left_subscriptions, s, 0))
+        lo_server_free(s->group);
+    FUNC_IF(free, s->group_url);
+    free(s);
+}
+
+/* Subscriptions removed while a group server was dispatching are freed here. */
+static void _free_left_subscriptions(mpr_graph g)
+{
+    while (g->left_subscriptions) {
+        mpr_subscription s = g->left_subscriptions;
+        g->left_subscriptions = s->next;
+        _free_subscription(g, s);
+    }
+}
+
 #ifdef DEBUG
 void print_subscription_flags(int flags)
 {
@@ -68,7 +179,11 @@ static void set_net_dst(mpr_graph g, mpr_dev d)
 static void send_subscribe_msg(mpr_graph g, mpr_dev d, int flags, int timeout)
 {
     char cmd[1024];
+    int version = -1;
+    mpr_subscription s = g->subscriptions;
     NEW_LO_MSG(msg, return);
+    while (s && s->dev != d)
+        s = s->next;
     snprintf(cmd, 1024, "/%s/subscribe", d->name); /* MSG_SUBSCRIBE */
 
     set_net_dst(g, d);
@@ -97,8 +212,28 @@ static void send_subscribe_msg(mpr_graph g, mpr_dev d, int flags, int timeout)
     lo_message_add_string(msg, "@lease");
     lo_message_add_int32(msg, timeout);
 
+    /* The device record may be known from bus broadcasts without its signals or maps, so only
+     * ask for the changes since its current revision if an earlier subscribe with the same flags
+     * has already been answered. Replies arrive well before the next renewal. */
+    if (s && flags && timeout) {
+        if (s->synced_flags == flags)
+            version = d->obj.version;
+        s->synced_flags = flags;
+    }
     lo_message_add_string(msg, "@version");
-    lo_message_add_int32(msg, d->obj.version);
+    lo_message_add_int32(msg, version);
+
+    if (flags && timeout) {
+        /* let the device know we are listening on its multicast group */
+        if (s && s->group) {
+            lo_message_add_string(msg, "@group");
+            lo_message_add_int32(msg, 1);
+        }
+    }
+
+    /* advertise support for compressed metadata over TCP */
+    lo_message_add_string(msg, "@bulk");
+    lo_message_add_int32(msg, lo_server_get_port(g->net.servers[SERVER_MESH_TCP]));
 
     mpr_net_add_msg(&g->net, cmd, 0, msg);
     mpr_net_send(&g->net);
@@ -119,6 +254,7 @@ static void _autosubscribe(mpr_graph g, int flags)
                 send_subscribe_msg(g, s->dev, flags, AUTOSUB_INTERVAL);
                 /* leave 10-second buffer for subscription renewal */
                 s->lease_expiration_sec = (t.sec + AUTOSUB_INTERVAL - 10);
+                _heap_set(g, DEADLINE_RENEW, s, &s->heap_pos, s->lease_expiration_sec);
             }
             s->flags = flags;
             s = s->next;
@@ -280,6 +416,8 @@ void mpr_graph_free(mpr_graph g)
 
     mpr_net_free(&g->net);
     FUNC_IF(mpr_tbl_free, g->obj.props.synced);
+    FUNC_IF(free, g->deadlines.entries);
+    FUNC_IF(mpr_reactor_free, g->reactor);
     free(g);
 }
 
@@ -396,7 +534,7 @@ mpr_dev mpr_graph_add_dev(mpr_graph g, const char *name, mpr_msg msg)
 
     if (!dev) {
         dev = (mpr_dev)mpr_list_add_item((void**)&g->devs, sizeof(*dev));
-        dev->name = strdup(no_slash);
+        dev->name = mpr_str_intern(no_slash);
         dev->obj.id = crc32(0L, (const Bytef *)no_slash, strlen(no_slash));
         dev->obj.id <<= 32;
         dev->obj.type = MPR_DEV;
@@ -412,6 +550,8 @@ mpr_dev mpr_graph_add_dev(mpr_graph g, const char *name, mpr_msg msg)
         if (!rc)
             trace_graph("updated %d props for device '%s%s'.\n", updated, name, dev->is_local ? "*" : "");
         mpr_time_set(&dev->synced, MPR_NOW);
+        if (rc)
+            _heap_set(g, DEADLINE_EXPIRY, dev, &dev->heap_pos, dev->synced.sec + TIMEOUT_SEC + 1);
 
         if (rc || updated)
             mpr_graph_call_cbs(g, (mpr_obj)dev, MPR_DEV, rc ? MPR_OBJ_NEW : MPR_OBJ_MOD);
@@ -444,6 +584,8 @@ void mpr_graph_remove_dev(mpr_graph g, mpr_dev d, mpr_graph_evt e, int quiet)
     _remove_by_qry(g, mpr_dev_get_sigs(d, MPR_DIR_ANY), e);
 
     mpr_list_remove_item((void**)&g->devs, d);
+    if (d->heap_pos)
+        _heap_remove(g, &d->heap_pos);
 
     if (!quiet)
         mpr_graph_call_cbs(g, (mpr_obj)d, MPR_DEV, e);
@@ -451,18 +593,20 @@ void mpr_graph_remove_dev(mpr_graph g, mpr_dev d, mpr_graph_evt e, int quiet)
     FUNC_IF(mpr_tbl_free, d->obj.props.synced);
     FUNC_IF(mpr_tbl_free, d->obj.props.staged);
     FUNC_IF(free, d->linked);
-    FUNC_IF(free, d->name);
+    FUNC_IF(mpr_str_free, d->name);
     mpr_list_free_item(d);
 }
 
 mpr_dev mpr_graph_get_dev_by_name(mpr_graph g, const char *name)
 {
-    const char *no_slash = skip_slash(name);
-    mpr_list devs = mpr_list_from_data(g->devs);
+    mpr_list devs;
+    /* device names are interned, so an unknown name cannot match any device */
+    RETURN_ARG_UNLESS(name = mpr_str_find(skip_slash(name)), 0);
+    devs = mpr_list_from_data(g->devs);
     while (devs) {
         mpr_dev dev = (mpr_dev)*devs;
         devs = mpr_list_get_next(devs);
-        if (dev->name && (0 == strcmp(dev->name, no_slash)))
+        if (dev->name == name)
             return dev;
     }
     return 0;
@@ -743,6 +887,68 @@ void mpr_graph_remove_map(mpr_graph g, mpr_map m, mpr_graph_evt e)
     mpr_list_free_item(m);
 }
 
+/* Maps can be batched if they are not yet established and their destination is a remote device. */
+int mpr_graph_can_batch_map(mpr_graph g, mpr_map m)
+{
+    int i;
+    mpr_sig s = m->dst->sig;
+    RETURN_ARG_UNLESS(m->obj.graph == g && m->status < MPR_STATUS_ACTIVE, 0);
+    RETURN_ARG_UNLESS(!s->is_local && s->dev->name, 0);
+    for (i = 0; i < m->num_src; i++) {
+        s = m->src[i]->sig;
+        RETURN_ARG_UNLESS(!s->is_local || ((mpr_local_dev)s->dev)->registered, 0);
+    }
+    return 1;
+}
+
+void mpr_graph_batch_map(mpr_graph g, mpr_map m, lo_message msg)
+{
+    mpr_dev dev = m->dst->sig->dev;
+    int idx;
+    mpr_net_use_batch(&g->net, dev);
+    idx = lo_bundle_count(g->net.bundle);
+    if (msg)
+        mpr_net_add_msg(&g->net, 0, MSG_MAP, msg);
+    else
+        mpr_map_send_state(m, -1, MSG_MAP);
+    /* the batch may have been sent to make room for this map */
+    m->batch = mpr_net_use_batch(&g->net, dev);
+    m->batch_idx = lo_bundle_count(g->net.bundle) > idx ? idx : 0;
+}
+
+int mpr_graph_push_maps(mpr_graph g, int num_maps, mpr_map *maps)
+{
+    int i, j, num_batched = 0;
+    uint8_t *pushed;
+    RETURN_ARG_UNLESS(g && num_maps > 0 && maps, 0);
+    pushed = (uint8_t*)calloc(1, num_maps);
+    RETURN_ARG_UNLESS(pushed, 0);
+
+    for (i = 0; i < num_maps; i++) {
+        mpr_dev dev;
+        if (pushed[i] || !maps[i])
+            continue;
+        if (!mpr_graph_can_batch_map(g, maps[i])) {
+            mpr_obj_push((mpr_obj)maps[i]);
+            continue;
+        }
+        /* collect the remaining maps with the same destination device */
+        dev = maps[i]->dst->sig->dev;
+        for (j = i; j < num_maps; j++) {
+            mpr_map m = maps[j];
+            if (pushed[j] || !m || m->dst->sig->dev != dev || !mpr_graph_can_batch_map(g, m))
+                continue;
+            mpr_graph_batch_map(g, m, 0);
+            FUNC_IF(mpr_tbl_clear, m->obj.props.staged);
+            pushed[j] = 1;
+            ++num_batched;
+        }
+    }
+    mpr_net_send(&g->net);
+    free(pushed);
+    return num_batched;
+}
+
 void mpr_graph_print(mpr_graph g)
 {
     mpr_list devs = mpr_list_from_data(g->devs);
@@ -792,63 +998,82 @@ void mpr_graph_print(mpr_graph g)
     printf("-------------------------------\n");
 }
 
-/* TODO: consider throttling */
 void mpr_graph_housekeeping(mpr_graph g)
 {
-    mpr_list devs = mpr_list_from_data(g->devs);
-    mpr_subscription s;
     mpr_time t;
+    RETURN_UNLESS(g->deadlines.len);
     mpr_time_set(&t, MPR_NOW);
 
-    /* check if any known devices have expired */
-    t.sec -= TIMEOUT_SEC;
-    while (devs) {
-        mpr_dev dev = (mpr_dev)*devs;
-        devs = mpr_list_get_next(devs);
-        /* check if device has "checked in" recently – could be /sync ping or any sent metadata */
-        if (!dev->is_local && dev->synced.sec && (dev->synced.sec < t.sec)) {
-            /* do nothing if device is linked to local device; will be handled in network.c */
-            int i, local_link = 0;
-            for (i = 0; i < dev->num_linked; i++) {
-                if (dev->linked[i] && dev->linked[i]->is_local) {
-                    local_link = 1;
-                    break;
+    while (g->deadlines.len && g->deadlines.entries[0].sec <= t.sec) {
+        mpr_deadline d = &g->deadlines.entries[0];
+        if (DEADLINE_EXPIRY == d->type) {
+            mpr_dev dev = (mpr_dev)d->obj;
+            /* check if device has "checked in" recently – could be /sync ping or any sent metadata */
+            if (dev->synced.sec && (dev->synced.sec + TIMEOUT_SEC < t.sec)) {
+                /* do nothing if device is linked to local device; will be handled in network.c */
+                int i, local_link = 0;
+                for (i = 0; i < dev->num_linked; i++) {
+                    if (dev->linked[i] && dev->linked[i]->is_local) {
+                        local_link = 1;
+                        break;
+                    }
                 }
+                if (!local_link) {
+                    /* remove subscription */
+                    mpr_graph_subscribe(g, dev, 0, 0);
+                    mpr_graph_remove_dev(g, dev, MPR_OBJ_EXP, 0);
+                    continue;
+                }
+                _heap_set(g, DEADLINE_EXPIRY, dev, &dev->heap_pos, t.sec + TIMEOUT_SEC);
             }
-            if (!local_link) {
-                /* remove subscription */
-                mpr_graph_subscribe(g, dev, 0, 0);
-                mpr_graph_remove_dev(g, dev, MPR_OBJ_EXP, 0);
+            else
+                _heap_set(g, DEADLINE_EXPIRY, dev, &dev->heap_pos,
+                          (dev->synced.sec ? dev->synced.sec : t.sec) + TIMEOUT_SEC + 1);
+        }
+        else {
+            /* check if subscription needs to be renewed */
+            mpr_subscription s = (mpr_subscription)d->obj;
+            if (s->lease_expiration_sec <= t.sec) {
+                /* if the lease lapsed before it could be renewed changes may have been missed */
+                if (s->lease_expiration_sec + 10 <= t.sec)
+                    s->synced_flags = 0;
+                trace_graph("Automatically renewing subscription to %s for %d secs.\n",
+                            mpr_dev_get_name(s->dev), AUTOSUB_INTERVAL);
+                send_subscribe_msg(g, s->dev, s->flags, AUTOSUB_INTERVAL);
+                /* leave 10-second buffer for subscription renewal */
+                s->lease_expiration_sec = (t.sec + AUTOSUB_INTERVAL - 10);
             }
+            _heap_set(g, DEADLINE_RENEW, s, &s->heap_pos, s->lease_expiration_sec);
         }
     }
+}
 
-    /* check if any subscriptions need to be renewed */
-    s = g->subscriptions;
-    while (s) {
-        if (s->lease_expiration_sec <= t.sec) {
-            trace_graph("Automatically renewing subscription to %s for %d secs.\n",
-                        mpr_dev_get_name(s->dev), AUTOSUB_INTERVAL);
-            send_subscribe_msg(g, s->dev, s->flags, AUTOSUB_INTERVAL);
-            /* leave 10-second buffer for subscription renewal */
-            s->lease_expiration_sec = (t.sec + AUTOSUB_INTERVAL - 10);
-        }
-        s = s->next;
+/* Fill an array with the admin servers followed by any joined subscriber groups. */
+static int _get_servers(mpr_graph g, lo_server *servers)
+{
+    int num = 3;
+    mpr_subscription s;
+    memcpy(servers, g->net.servers, sizeof(lo_server) * 3);
+    for (s = g->subscriptions; s && num < 3 + MAX_WATCHED_GROUPS; s = s->next) {
+        /* list servers shared by several subscriptions only once */
+        if (s->group && _find_group(s->next, s, 0) == 0)
+            servers[num++] = s->group;
     }
+    return num;
 }
 
 int mpr_graph_poll(mpr_graph g, int block_ms)
 {
     mpr_net n = &g->net;
-    int count = 0, status[2], left_ms, elapsed, checked_admin = 0;
+    int i, count = 0, status[3 + MAX_WATCHED_GROUPS], left_ms, elapsed, checked_admin = 0;
     double then;
 
     mpr_net_poll(n);
     mpr_graph_housekeeping(g);
 
     if (!block_ms) {
-        if (lo_servers_recv_noblock(n->servers, status, 2, 0)) {
-            count = (status[0] > 0) + (status[1] > 0);
+        if (lo_servers_recv_noblock(n->servers, status, 3, 0)) {
+            count = (status[0] > 0) + (status[1] > 0) + (status[2] > 0);
             n->msgs_recvd |= count;
         }
         return count;
@@ -856,12 +1081,44 @@ int mpr_graph_poll(mpr_graph g, int block_ms)
 
     then = mpr_get_current_time();
     left_ms = block_ms;
-    while (left_ms > 0) {
+
+    if (!g->reactor)
+        g->reactor = mpr_reactor_new();
+    if (g->reactor) {
+        lo_server servers[3 + MAX_WATCHED_GROUPS];
+        while (left_ms > 0 && !(g->thread_data && !g->thread_data->is_active)) {
+            /* watch the admin servers and any joined subscriber groups */
+            int due_ms, num_servers = _get_servers(g, servers);
+            mpr_reactor_set_servers(g->reactor, servers, num_servers);
+
+            due_ms = mpr_net_get_ms_until_due(n);
+            if (mpr_reactor_wait(g->reactor, due_ms < left_ms ? due_ms : left_ms)) {
+                g->recv_groups = 1;
+                if (lo_servers_recv_noblock(servers, status, num_servers, 0)) {
+                    for (i = 0; i < 3; i++)
+                        count += status[i] > 0;
+                }
+                g->recv_groups = 0;
+                _free_left_subscriptions(g);
+                mpr_net_send(n);
+            }
+            if (due_ms <= left_ms && mpr_net_get_ms_until_due(n) <= 0) {
+                mpr_net_poll(n);
+                mpr_graph_housekeeping(g);
+            }
+            elapsed = (mpr_get_current_time() - then) * 1000;
+            left_ms = block_ms - elapsed;
+        }
+        n->msgs_recvd |= count;
+        return count;
+    }
+
+    while (left_ms > 0 && !(g->thread_data && !g->thread_data->is_active)) {
         if (left_ms > 100)
             left_ms = 100;
 
-        if (lo_servers_recv_noblock(n->servers, status, 2, left_ms))
-            count += (status[0] > 0) + (status[1] > 0);
+        if (lo_servers_recv_noblock(n->servers, status, 3, left_ms))
+            count += (status[0] > 0) + (status[1] > 0) + (status[2] > 0);
 
         elapsed = (mpr_get_current_time() - then) * 1000;
         if ((elapsed - checked_admin) > 100) {
@@ -877,12 +1134,70 @@ int mpr_graph_poll(mpr_graph g, int block_ms)
     return count;
 }
 
+int mpr_graph_get_fds(mpr_graph g, int *fds, int num)
+{
+    int i, fd, num_servers, count = 0;
+    lo_server servers[3 + MAX_WATCHED_GROUPS];
+    RETURN_ARG_UNLESS(g, 0);
+    num_servers = _get_servers(g, servers);
+    for (i = 0; i < num_servers; i++) {
+        if (!servers[i] || (fd = lo_server_get_socket_fd(servers[i])) < 0)
+            continue;
+        if (fds && count < num)
+            fds[count] = fd;
+        ++count;
+    }
+    return count;
+}
+
+int mpr_graph_get_timeout(mpr_graph g)
+{
+    int timeout;
+    RETURN_ARG_UNLESS(g, 0);
+    /* queued admin messages are sent by the next call to mpr_graph_on_readable() */
+    RETURN_ARG_UNLESS(!g->net.bundle, 0);
+    timeout = mpr_net_get_ms_until_due(&g->net);
+    /* connections accepted by the TCP server are not exposed by liblo */
+    if (g->tcp_open && timeout > TCP_POLL_MS)
+        timeout = TCP_POLL_MS;
+    return timeout;
+}
+
+int mpr_graph_on_readable(mpr_graph g)
+{
+    mpr_net n;
+    int count = 0, status[3 + MAX_WATCHED_GROUPS], num_servers;
+    lo_server servers[3 + MAX_WATCHED_GROUPS];
+    RETURN_ARG_UNLESS(g, 0);
+    n = &g->net;
+
+    num_servers = _get_servers(g, servers);
+    g->recv_groups = 1;
+    if (lo_servers_recv_noblock(servers, status, num_servers, 0)) {
+        count = (status[0] > 0) + (status[1] > 0) + (status[2] > 0);
+        if (status[2] > 0)
+            g->tcp_open = 1;
+        n->msgs_recvd |= count;
+    }
+    g->recv_groups = 0;
+    _free_left_subscriptions(g);
+
+    /* admin handlers only queue their replies */
+    mpr_net_send(n);
+
+    if (mpr_net_get_ms_until_due(n) <= 0) {
+        mpr_net_poll(n);
+        mpr_graph_housekeeping(g);
+    }
+    return count;
+}
+
 #ifdef HAVE_LIBPTHREAD
 static void *graph_thread_func(void *data)
 {
     mpr_thread_data td = (mpr_thread_data)data;
     while (td->is_active) {
-        mpr_graph_poll((mpr_graph)td->object, 10);
+        mpr_graph_poll((mpr_graph)td->object, 1000);
     }
     td->is_done = 1;
     pthread_exit(NULL);
@@ -895,7 +1210,7 @@ static unsigned __stdcall graph_thread_func(void *data)
 {
     mpr_thread_data td = (mpr_thread_data)data;
     while (td->is_active) {
-        mpr_graph_poll((mpr_graph)td->object, 10);
+        mpr_graph_poll((mpr_graph)td->object, 1000);
     }
     td->is_done = 1;
     _endthread();
@@ -944,6 +1259,7 @@ int mpr_graph_stop_polling(mpr_graph g)
     if (!td || !td->is_active)
         return 0;
     td->is_active = 0;
+    mpr_reactor_wake(g->reactor);
 
 #ifdef HAVE_LIBPTHREAD
     result = pthread_join(td->thread, NULL);
@@ -1002,7 +1318,15 @@ void mpr_graph_subscribe(mpr_graph g, mpr_dev d, int flags, int timeout)
                 (*s)->dev->subscribed = 0;
                 temp = *s;
                 *s = temp->next;
-                free(temp);
+                if (temp->heap_pos)
+                    _heap_remove(g, &temp->heap_pos);
+                if (temp->group && g->recv_groups) {
+                    /* the group server may be dispatching this call */
+                    temp->next = g->left_subscriptions;
+                    g->left_subscriptions = temp;
+                }
+                else
+                    _free_subscription(g, temp);
                 send_subscribe_msg(g, d, 0, 0);
                 return;
             }
@@ -1024,6 +1348,10 @@ void mpr_graph_subscribe(mpr_graph g, mpr_dev d, int flags, int timeout)
             /* store subscription record */
             s = malloc(sizeof(struct _mpr_subscription));
             s->flags = 0;
+            s->group = 0;
+            s->group_url = 0;
+            s->heap_pos = 0;
+            s->synced_flags = 0;
             s->dev = d;
             s->dev->obj.version = -1;
             s->next = g->subscriptions;
@@ -1039,6 +1367,7 @@ void mpr_graph_subscribe(mpr_graph g, mpr_dev d, int flags, int timeout)
         mpr_time_set(&t, MPR_NOW);
         /* leave 10-second buffer for subscription lease */
         s->lease_expiration_sec = (t.sec + AUTOSUB_INTERVAL - 10);
+        _heap_set(g, DEADLINE_RENEW, s, &s->heap_pos, s->lease_expiration_sec);
 
         timeout = AUTOSUB_INTERVAL;
     }
@@ -1053,6 +1382,49 @@ void mpr_graph_subscribe(mpr_graph g, mpr_dev d, int flags, int timeout)
     send_subscribe_msg(g, d, flags, timeout);
 }
 
+void mpr_graph_join_sub_group(mpr_graph g, mpr_dev d, const char *url)
+{
+    mpr_subscription s = _get_subscription(g, d), shared;
+    RETURN_UNLESS(s && !s->group);
+    /* devices whose ids hash alike share a group, in which case so do their subscriptions */
+    if ((shared = _find_group(g->subscriptions, s, url)))
+        s->group = shared->group;
+    else
+        s->group = mpr_net_join_sub_group(&g->net, url);
+    RETURN_UNLESS(s->group);
+    s->group_url = strdup(url);
+    trace_graph("receiving metadata from device '%s' on %s\n", mpr_dev_get_name(d), url);
+
+    /* renew now so the device stops sending to us directly */
+    send_subscribe_msg(g, d, s->flags, AUTOSUB_INTERVAL);
+}
+
+int mpr_graph_get_is_grouped(mpr_graph g, const char *name)
+{
+    mpr_subscription s;
+    if ('/' == name[0])
+        ++name;
+    for (s = g->subscriptions; s; s = s->next) {
+        const char *dev_name = mpr_dev_get_name(s->dev);
+        int len = strlen(dev_name);
+        if (s->group && !strncmp(name, dev_name, len) && ('/' == name[len] || !name[len]))
+            return 1;
+    }
+    return 0;
+}
+
+void mpr_graph_recv_sub_groups(mpr_graph g)
+{
+    mpr_subscription s;
+    g->recv_groups = 1;
+    for (s = g->subscriptions; s; s = s->next) {
+        if (s->group && !_find_group(s->next, s, 0))
+            while (lo_server_recv_noblock(s->group, 0) > 0) {}
+    }
+    g->recv_groups = 0;
+    _free_left_subscriptions(g);
+}
+
 void mpr_graph_unsubscribe(mpr_graph g, mpr_dev d)
 {
     if (!d)
@@ -1110,3 +1482,11 @@ const char *mpr_graph_get_address(mpr_graph g)
         g->net.addr.url = lo_address_get_url(g->net.addr.bus);
     return g->net.addr.url;
 }
+
+void mpr_graph_set_ping_interval(mpr_graph g, double interval)
+{
+    RETURN_UNLESS(g && interval > 0);
+    g->net.ping_interval = interval;
+    /* ping again at the next poll so the new interval takes effect */
+    g->net.next_link_ping = 0;
+}
@@ -0,0 +1,201 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#include "config.h"
+#include "mapper_internal.h"
+
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK()      pthread_mutex_lock(&lock)
+#define UNLOCK()    pthread_mutex_unlock(&lock)
+#else
+#ifdef HAVE_WIN32_THREADS
+#include <windows.h>
+static SRWLOCK lock = SRWLOCK_INIT;
+#define LOCK()      AcquireSRWLockExclusive(&lock)
+#define UNLOCK()    ReleaseSRWLockExclusive(&lock)
+#else
+#define LOCK()
+#define UNLOCK()
+#endif /* HAVE_WIN32_THREADS */
+#endif /* HAVE_LIBPTHREAD */
+
+/*   Process-wide table of interned strings. Device names, signal paths and
+ * property keys are stored here exactly once and reference-counted, so that
+ * objects sharing a name also share its storage and names can be tested for
+ * equality by comparing pointers. The returned pointer is the 'str' member of
+ * the entry; the entry header is recovered using offsetof() when releasing. */
+
+typedef struct _mpr_istr {
+    struct _mpr_istr *next;
+    unsigned int hash;
+    unsigned int refcount;
+    int len;
+    char str[1];
+} mpr_istr_t, *mpr_istr;
+
+#define MIN_BUCKETS 64
+
+static mpr_istr *buckets = 0;
+static unsigned int num_buckets = 0;
+static unsigned int count = 0;
+
+#define STR_TO_ENTRY(s) ((mpr_istr)((char*)(s) - offsetof(mpr_istr_t, str)))
+
+/* FNV-1a, optionally hashing a leading slash that is not present in 'str'. */
+MPR_INLINE static unsigned int _hash(const char *str, int len, int slash)
+{
+    unsigned int h = 2166136261u;
+    if (slash)
+        h = (h ^ '/') * 16777619u;
+    while (len--)
+        h = (h ^ (unsigned char)*str++) * 16777619u;
+    return h;
+}
+
+static mpr_istr _find(const char *str, int len, int slash, unsigned int hash)
+{
+    mpr_istr e;
+    RETURN_ARG_UNLESS(buckets, 0);
+    e = buckets[hash & (num_buckets - 1)];
+    while (e) {
+        if (e->hash == hash && e->len == len + slash) {
+            if (!slash && 0 == memcmp(e->str, str, len))
+                return e;
+            if (slash && '/' == e->str[0] && 0 == memcmp(e->str + 1, str, len))
+                return e;
+        }
+        e = e->next;
+    }
+    return 0;
+}
+
+static void _grow(void)
+{
+    unsigned int i, size = num_buckets ? num_buckets * 2 : MIN_BUCKETS;
+    mpr_istr *new_buckets = (mpr_istr*)calloc(size, sizeof(mpr_istr));
+    RETURN_UNLESS(new_buckets);
+    for (i = 0; i < num_buckets; i++) {
+        mpr_istr e = buckets[i];
+        while (e) {
+            mpr_istr next = e->next;
+            e->next = new_buckets[e->hash & (size - 1)];
+            new_buckets[e->hash & (size - 1)] = e;
+            e = next;
+        }
+    }
+    FUNC_IF(free, buckets);
+    buckets = new_buckets;
+    num_buckets = size;
+}
+
+static const char *_intern(const char *str, int len, int slash)
+{
+    unsigned int hash = _hash(str, len, slash);
+    mpr_istr e;
+
+    LOCK();
+    if ((e = _find(str, len, slash, hash))) {
+        ++e->refcount;
+        UNLOCK();
+        return e->str;
+    }
+    if (count >= num_buckets - (num_buckets >> 2))
+        _grow();
+    if (!buckets || !(e = (mpr_istr)malloc(sizeof(mpr_istr_t) + len + slash))) {
+        UNLOCK();
+        return 0;
+    }
+    e->hash = hash;
+    e->refcount = 1;
+    e->len = len + slash;
+    if (slash)
+        e->str[0] = '/';
+    memcpy(e->str + slash, str, len);
+    e->str[e->len] = 0;
+    e->next = buckets[hash & (num_buckets - 1)];
+    buckets[hash & (num_buckets - 1)] = e;
+    ++count;
+    UNLOCK();
+    return e->str;
+}
+
+static const char *_lookup(const char *str, int len, int slash)
+{
+    unsigned int hash = _hash(str, len, slash);
+    mpr_istr e;
+    LOCK();
+    e = _find(str, len, slash, hash);
+    UNLOCK();
+    return e ? e->str : 0;
+}
+
+const char *mpr_str_intern(const char *str)
+{
+    RETURN_ARG_UNLESS(str, 0);
+    return _intern(str, strlen(str), 0);
+}
+
+const char *mpr_str_intern_path(const char *name)
+{
+    RETURN_ARG_UNLESS(name, 0);
+    if ('/' == name[0])
+        return _intern(name, strlen(name), 0);
+    return _intern(name, strlen(name), 1);
+}
+
+const char *mpr_str_ref(const char *str)
+{
+    RETURN_ARG_UNLESS(str, 0);
+    LOCK();
+    ++STR_TO_ENTRY(str)->refcount;
+    UNLOCK();
+    return str;
+}
+
+const char *mpr_str_find(const char *str)
+{
+    RETURN_ARG_UNLESS(str, 0);
+    return _lookup(str, strlen(str), 0);
+}
+
+const char *mpr_str_find_len(const char *str, int len)
+{
+    RETURN_ARG_UNLESS(str && len >= 0, 0);
+    return _lookup(str, len, 0);
+}
+
+const char *mpr_str_find_path(const char *name)
+{
+    RETURN_ARG_UNLESS(name, 0);
+    if ('/' == name[0])
+        return _lookup(name, strlen(name), 0);
+    return _lookup(name, strlen(name), 1);
+}
+
+void mpr_str_free(const char *str)
+{
+    mpr_istr e, *prev;
+    RETURN_UNLESS(str);
+    e = STR_TO_ENTRY(str);
+    LOCK();
+    if (--e->refcount) {
+        UNLOCK();
+        return;
+    }
+    prev = &buckets[e->hash & (num_buckets - 1)];
+    while (*prev && *prev != e)
+        prev = &(*prev)->next;
+    if (*prev)
+        *prev = e->next;
+    free(e);
+    if (0 == --count) {
+        /* release the bucket array once the last string is gone */
+        free(buckets);
+        buckets = 0;
+        num_buckets = 0;
+    }
+    UNLOCK();
+}
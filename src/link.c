@@ -28,6 +28,8 @@ void mpr_link_init(mpr_link link)
     }
     if (!link->obj.props.staged)
         link->obj.props.staged = mpr_tbl_new();
+    if (link->devs[LOCAL_DEV]->is_local && ((mpr_local_dev)link->devs[LOCAL_DEV])->stats)
+        mpr_link_set_stats(link, 1);
 
     if (!link->obj.id && link->devs[LOCAL_DEV]->is_local)
         link->obj.id = mpr_dev_generate_unique_id(link->devs[LOCAL_DEV]);
@@ -37,7 +39,7 @@ void mpr_link_init(mpr_link link)
         return;
     }
     else {
-        link->clock.new = 1;
+        mpr_sync_clock_init(&link->clock);
         link->clock.sent.msg_id = 0;
         link->clock.rcvd.msg_id = -1;
         mpr_time_set(&t, MPR_NOW);
@@ -58,6 +60,22 @@ void mpr_link_init(mpr_link link)
     mpr_net_send(net);
 }
 
+static void _free_bundles(mpr_link link)
+{
+    int i;
+    for (i = 0; i < NUM_BUNDLES; i++) {
+        FUNC_IF(free, link->bundles[i].buf);
+        FUNC_IF(lo_bundle_free_recursive, link->bundles[i].tcp);
+    }
+    memset(link->bundles, 0, sizeof(mpr_bundle_t) * NUM_BUNDLES);
+    FUNC_IF(free, link->spare_buf);
+    FUNC_IF(free, link->argv);
+    link->spare_buf = 0;
+    link->spare_size = 0;
+    link->argv = 0;
+    link->argv_size = 0;
+}
+
 void mpr_link_connect(mpr_link link, const char *host, int admin_port, int data_port)
 {
     if (!link->is_local_only) {
@@ -69,6 +87,8 @@ void mpr_link_connect(mpr_link link, const char *host, int admin_port, int data_
         sprintf(str, "%d", data_port);
         link->addr.udp = lo_address_new(host, str);
         link->addr.tcp = lo_address_new_with_proto(LO_TCP, host, str);
+        FUNC_IF(free, link->addr.udp_sock);
+        link->addr.udp_sock = mpr_net_resolve_udp(host, data_port, &link->addr.udp_sock_len);
         sprintf(str, "%d", admin_port);
         link->addr.admin = lo_address_new(host, str);
         trace_dev(link->devs[LOCAL_DEV], "activated link to device '%s' at %s:%d\n",
@@ -78,13 +98,13 @@ void mpr_link_connect(mpr_link link, const char *host, int admin_port, int data_
         trace_dev(link->devs[LOCAL_DEV], "activating link to local device '%s'\n",
                   link->devs[REMOTE_DEV]->name);
     }
-    memset(link->bundles, 0, sizeof(mpr_bundle_t) * NUM_BUNDLES);
+    _free_bundles(link);
     mpr_dev_add_link(link->devs[LOCAL_DEV], link->devs[REMOTE_DEV]);
 }
 
 void mpr_link_free(mpr_link link)
 {
-    int i;
+    mpr_link_set_stats(link, 0);
     FUNC_IF(mpr_tbl_free, link->obj.props.synced);
     FUNC_IF(mpr_tbl_free, link->obj.props.staged);
     if (!link->devs[LOCAL_DEV]->is_local)
@@ -92,28 +112,210 @@ void mpr_link_free(mpr_link link)
     FUNC_IF(lo_address_free, link->addr.admin);
     FUNC_IF(lo_address_free, link->addr.udp);
     FUNC_IF(lo_address_free, link->addr.tcp);
-    for (i = 0; i < NUM_BUNDLES; i++) {
-        FUNC_IF(lo_bundle_free_recursive, link->bundles[i].udp);
-        FUNC_IF(lo_bundle_free_recursive, link->bundles[i].tcp);
-    }
+    FUNC_IF(free, link->addr.udp_sock);
+    _free_bundles(link);
     mpr_dev_remove_link(link->devs[LOCAL_DEV], link->devs[REMOTE_DEV]);
 }
 
+/* Make room at the end of a serialized bundle for a message of the given length,
+ * returning a pointer to it. The buffer only grows, so once it has reached the size
+ * needed by the maps of a link, queuing updates does not allocate any memory. */
+static char *_reserve(mpr_bundle b, size_t len, mpr_time t)
+{
+    size_t needed;
+    if (!b->len) {
+        /* leave room for the bundle header */
+        b->len = 16;
+        b->num_msgs = 0;
+        b->time = t;
+    }
+    needed = b->len + 4 + len;
+    if (needed > b->size) {
+        size_t size = b->size ? b->size : 256;
+        char *buf;
+        while (size < needed)
+            size *= 2;
+        RETURN_ARG_UNLESS(buf = realloc(b->buf, size), 0);
+        b->buf = buf;
+        b->size = size;
+    }
+    return b->buf + b->len + 4;
+}
+
+/* Add the size prefix of a message written after _reserve(). */
+static void _commit(mpr_bundle b, size_t len)
+{
+    osc_write32(b->buf + b->len, (uint32_t)len);
+    b->len += 4 + len;
+    ++b->num_msgs;
+}
+
+MPR_INLINE static int _uses_tcp(mpr_link link, mpr_proto proto)
+{
+    return MPR_PROTO_TCP == proto && !link->is_local_only && link->devs[0] != link->devs[1];
+}
+
 /* note on memory handling of mpr_link_add_msg():
  * message: will be owned, will be freed when done */
 void mpr_link_add_msg(mpr_link link, mpr_sig dst, lo_message msg, mpr_time t,
                       mpr_proto proto, int idx)
 {
-    lo_bundle *b;
+    mpr_bundle b;
+    char *buf;
+    size_t len;
     RETURN_UNLESS(msg);
-    if (link->devs[0] == link->devs[1])
-        proto = MPR_PROTO_UDP;
 
     /* add message to existing bundles */
-    b = (proto == MPR_PROTO_UDP) ? &link->bundles[idx].udp : &link->bundles[idx].tcp;
-    if (!(*b))
-        *b = lo_bundle_new(t);
-    lo_bundle_add_message(*b, dst->path, msg);
+    b = &link->bundles[idx];
+    if (_uses_tcp(link, proto)) {
+        if (!b->tcp)
+            b->tcp = lo_bundle_new(t);
+        lo_bundle_add_message(b->tcp, dst->path, msg);
+        return;
+    }
+    len = lo_message_length(msg, dst->path);
+    if ((buf = _reserve(b, len, t))) {
+        lo_message_serialise(msg, dst->path, buf, &len);
+        _commit(b, len);
+    }
+    lo_message_free(msg);
+}
+
+void mpr_link_add_map_msg(mpr_link link, mpr_sig dst, mpr_local_map map, mpr_local_slot slot,
+                          const void *val, mpr_type *types, mpr_id_map idmap, mpr_time t, int idx)
+{
+    mpr_bundle b;
+    char *buf;
+    size_t len, avail;
+    RETURN_UNLESS(link);
+
+    if (_uses_tcp(link, map->protocol)) {
+        lo_message msg = mpr_map_build_msg(map, slot, val, types, idmap);
+        mpr_link_add_msg(link, dst, msg, t, map->protocol, idx);
+        return;
+    }
+
+    /* try writing into the space left in the buffer first */
+    b = &link->bundles[idx];
+    buf = _reserve(b, 0, t);
+    RETURN_UNLESS(buf);
+    avail = b->size - (buf - b->buf);
+    len = mpr_map_write_msg(map, slot, val, types, idmap, dst->path, buf, avail);
+    if (len > avail) {
+        RETURN_UNLESS(buf = _reserve(b, len, t));
+        mpr_map_write_msg(map, slot, val, types, idmap, dst->path, buf, len);
+    }
+    _commit(b, len);
+}
+
+/* Convert the arguments of a serialized message to host byte order in place and
+ * collect pointers to them. Returns the number of arguments, or -1 on error. */
+static int _parse_msg(char *msg, size_t len, const char **path, const char **types,
+                      lo_arg ***argv_ptr, int *argv_size)
+{
+    char *end = msg + len, *tt, *arg;
+    int i, argc;
+    lo_arg **argv = *argv_ptr;
+    size_t n = strnlen(msg, len);
+    RETURN_ARG_UNLESS(n < len, -1);
+    *path = msg;
+    tt = msg + OSC_PAD(n + 1);
+    RETURN_ARG_UNLESS(tt < end && ',' == *tt, -1);
+    n = strnlen(tt, end - tt);
+    RETURN_ARG_UNLESS(tt + n < end, -1);
+    *types = tt + 1;
+    argc = (int)n - 1;
+    arg = tt + OSC_PAD(n + 1);
+    if (argc > *argv_size) {
+        RETURN_ARG_UNLESS(argv = realloc(argv, argc * sizeof(lo_arg*)), -1);
+        *argv_ptr = argv;
+        *argv_size = argc;
+    }
+    for (i = 0; i < argc; i++) {
+        argv[i] = (lo_arg*)arg;
+        switch (tt[i + 1]) {
+            case MPR_INT32:
+            case MPR_FLT: {
+                uint32_t u;
+                RETURN_ARG_UNLESS(arg + 4 <= end, -1);
+                u = osc_read32(arg);
+                memcpy(arg, &u, 4);
+                arg += 4;
+                break;
+            }
+            case MPR_INT64:
+            case MPR_DBL: {
+                uint64_t u;
+                RETURN_ARG_UNLESS(arg + 8 <= end, -1);
+                u = osc_read64(arg);
+                memcpy(arg, &u, 8);
+                arg += 8;
+                break;
+            }
+            case MPR_TIME: {
+                uint32_t u[2];
+                RETURN_ARG_UNLESS(arg + 8 <= end, -1);
+                u[0] = osc_read32(arg);
+                u[1] = osc_read32(arg + 4);
+                memcpy(arg, u, 8);
+                arg += 8;
+                break;
+            }
+            case MPR_STR:
+                n = strnlen(arg, end - arg);
+                RETURN_ARG_UNLESS(arg + n < end, -1);
+                arg += OSC_PAD(n + 1);
+                break;
+            case MPR_NULL:
+            case 'T':
+            case 'F':
+                break;
+            default:
+                return -1;
+        }
+    }
+    return argc;
+}
+
+/* Call the handlers of local signals directly instead of sending a bundle over the network. */
+static void _dispatch_bundle(mpr_link link, char *buf, size_t len, mpr_time t)
+{
+    size_t pos = 16;
+    /* handlers may dispatch further bundles on this link, so take the argument array */
+    lo_arg **argv = link->argv;
+    int argv_size = link->argv_size;
+    link->argv = 0;
+    link->argv_size = 0;
+
+    /* set out-of-band timestamp */
+    mpr_dev_bundle_start(*(lo_timetag*)&t, NULL);
+    while (pos + 4 <= len) {
+        size_t msg_len = osc_read32(buf + pos);
+        const char *path, *types;
+        int argc;
+        pos += 4;
+        if (msg_len > len - pos)
+            break;
+        argc = _parse_msg(buf + pos, msg_len, &path, &types, &argv, &argv_size);
+        pos += msg_len;
+        if (argc >= 0) {
+            /* need to look up signal by path; comparing strings avoids taking the intern lock */
+            mpr_rtr_sig rs = link->obj.graph->net.rtr->sigs;
+            while (rs) {
+                if (!strcmp(path, rs->sig->path)) {
+                    mpr_dev_handler(NULL, types, argv, argc, NULL, (void*)rs->sig);
+                    break;
+                }
+                rs = rs->next;
+            }
+        }
+    }
+    if (link->argv)
+        free(argv);
+    else {
+        link->argv = argv;
+        link->argv_size = argv_size;
+    }
 }
 
 /* TODO: pass in bundle index as argument */
@@ -121,7 +323,7 @@ void mpr_link_add_msg(mpr_link link, mpr_sig dst, lo_message msg, mpr_time t,
  * case where the interrupt has interrupted mpr_dev_poll() these messages will not be dispatched. */
 int mpr_link_process_bundles(mpr_link link, mpr_time t, int idx)
 {
-    int i = 0, num = 0, tmp;
+    int num = 0, tmp;
     mpr_bundle b;
     lo_bundle lb;
     RETURN_ARG_UNLESS(link, 0);
@@ -130,48 +332,93 @@ int mpr_link_process_bundles(mpr_link link, mpr_time t, int idx)
 
     if (!link->is_local_only) {
         mpr_local_dev ldev = (mpr_local_dev)link->devs[LOCAL_DEV];
-        if ((lb = b->udp)) {
-            b->udp = 0;
-            if ((num = lo_bundle_count(lb))) {
-                lo_send_bundle_from(link->addr.udp, ldev->servers[SERVER_UDP], lb);
+        if (b->len) {
+            size_t len = b->len;
+            num = b->num_msgs;
+            b->len = 0;
+            memcpy(b->buf, "#bundle", 8);
+            osc_write32(b->buf + 8, b->time.sec);
+            osc_write32(b->buf + 12, b->time.frac);
+            if (link->addr.udp_sock)
+                mpr_net_send_udp(ldev->servers[SERVER_UDP], link->addr.udp_sock,
+                                 link->addr.udp_sock_len, b->buf, len);
+            else {
+                trace_dev(ldev, "no address for link to device '%s'\n",
+                          link->devs[REMOTE_DEV]->name);
+            }
+            if (link->stats) {
+                ++link->stats[LINK_STAT_BUNDLES_SENT];
+                link->stats[LINK_STAT_BYTES_SENT] += len;
+                STAT_INC(ldev, DEV_STAT_BUNDLES_SENT);
+                STAT_ADD(ldev, DEV_STAT_BYTES_SENT, len);
             }
-            lo_bundle_free_recursive(lb);
         }
         if ((lb = b->tcp)) {
             b->tcp = 0;
             if ((tmp = lo_bundle_count(lb))) {
                 num += tmp;
                 lo_send_bundle_from(link->addr.tcp, ldev->servers[SERVER_TCP], lb);
+                if (link->stats) {
+                    size_t len = lo_bundle_length(lb);
+                    ++link->stats[LINK_STAT_BUNDLES_SENT];
+                    link->stats[LINK_STAT_BYTES_SENT] += len;
+                    STAT_INC(ldev, DEV_STAT_BUNDLES_SENT);
+                    STAT_ADD(ldev, DEV_STAT_BYTES_SENT, len);
+                }
             }
             lo_bundle_free_recursive(lb);
         }
+        if (link->stats) {
+            link->stats[LINK_STAT_MSGS_SENT] += num;
+            STAT_ADD(ldev, DEV_STAT_UPDATES_OUT, num);
+        }
     }
-    else if ((lb = b->udp)) {
-        const char *path;
-        b->udp = 0;
-        /* set out-of-band timestamp */
-        mpr_dev_bundle_start(lo_bundle_get_timestamp(lb), NULL);
-        /* call handler directly instead of sending over the network */
-        num = lo_bundle_count(lb);
-        while (i < num) {
-            lo_message m = lo_bundle_get_message(lb, i, &path);
-            /* need to look up signal by path */
-            mpr_rtr_sig rs = link->obj.graph->net.rtr->sigs;
-            while (rs) {
-                if (0 == strcmp(path, rs->sig->path)) {
-                    mpr_dev_handler(NULL, lo_message_get_types(m), lo_message_get_argv(m),
-                                    lo_message_get_argc(m), m, (void*)rs->sig);
-                    break;
-                }
-                rs = rs->next;
-            }
-            ++i;
+    else if (b->len) {
+        /* Swap in the spare buffer since handlers may queue further messages on this link. If
+         * they also process them the spare is already in use and a new buffer is allocated. */
+        char *buf = b->buf;
+        size_t len = b->len, size = b->size;
+        num = b->num_msgs;
+        b->buf = link->spare_buf;
+        b->size = link->spare_size;
+        b->len = 0;
+        link->spare_buf = 0;
+        link->spare_size = 0;
+        if (link->stats) {
+            mpr_local_dev ldev = (mpr_local_dev)link->devs[LOCAL_DEV];
+            ++link->stats[LINK_STAT_BUNDLES_SENT];
+            link->stats[LINK_STAT_MSGS_SENT] += num;
+            STAT_INC(ldev, DEV_STAT_BUNDLES_SENT);
+            STAT_ADD(ldev, DEV_STAT_UPDATES_OUT, num);
+        }
+        _dispatch_bundle(link, buf, len, b->time);
+        if (link->spare_buf)
+            free(buf);
+        else {
+            link->spare_buf = buf;
+            link->spare_size = size;
         }
-        lo_bundle_free_recursive(lb);
     }
     return num;
 }
 
+void mpr_link_set_stats(mpr_link link, int enable)
+{
+    if (enable && !link->stats) {
+        RETURN_UNLESS(link->obj.props.synced);
+        link->stats = (int64_t*)calloc(1, NUM_LINK_STATS * sizeof(int64_t));
+        RETURN_UNLESS(link->stats);
+        mpr_tbl_link_key(link->obj.props.synced, "stats", NUM_LINK_STATS, MPR_INT64,
+                         link->stats, NON_MODIFIABLE);
+    }
+    else if (!enable && link->stats) {
+        if (link->obj.props.synced)
+            mpr_tbl_unlink_key(link->obj.props.synced, "stats");
+        free(link->stats);
+        link->stats = 0;
+    }
+}
+
 static int cmp_qry_link_maps(const void *context_data, mpr_map map)
 {
     mpr_id link_id = *(mpr_id*)context_data;
@@ -444,18 +444,56 @@ static int _update_scope(mpr_map m, mpr_msg_atom a)
  * 4) when it comes to "to release" idmap, send release and decref LID
  */
 
+/* Evaluate the updated instances of a map, storing the status and output types
+ * of each for mpr_map_send() or mpr_map_receive(). Different maps may be
+ * evaluated concurrently provided each thread uses its own expression stack. */
+void mpr_map_eval(mpr_local_map m, mpr_expr_stack stk, mpr_time time)
+{
+    int i, status, len = m->dst->sig->len;
+    mpr_value src_vals[MAX_NUM_MAP_SRC];
+
+    for (i = 0; i < m->num_src; i++)
+        src_vals[i] = &m->src[i]->val;
+    mpr_expr_stack_reserve(stk, m->expr);
+    memset(m->eval_status, 0, m->num_inst);
+
+    for (i = 0; i < m->num_inst; i++) {
+        /* Check if this instance has been updated */
+        if (!get_bitflag(m->updated_inst, i))
+            continue;
+        /* TODO: Check if this instance has enough history to process the expression */
+        if (m->stats) {
+            int64_t ns = mpr_get_current_ns(), us;
+            int bin = 0;
+            status = mpr_expr_eval(stk, m->expr, src_vals, &m->vars, &m->dst->val, &time,
+                                   m->eval_types + i * len, i);
+            ns = mpr_get_current_ns() - ns;
+            for (us = ns / 1000; us && bin < NUM_EVAL_TIME_BINS - 1; us >>= 2)
+                ++bin;
+            ++m->stats[MAP_STAT_EVALS];
+            m->stats[MAP_STAT_EVAL_NS] += ns;
+            ++m->stats[MAP_STAT_EVAL_TIME_BINS + bin];
+        }
+        else
+            status = mpr_expr_eval(stk, m->expr, src_vals, &m->vars, &m->dst->val, &time,
+                                   m->eval_types + i * len, i);
+        m->eval_status[i] = status;
+        if ((status & EXPR_EVAL_DONE) && !m->use_inst)
+            break;
+    }
+    m->evaluated = 1;
+}
+
 /* only called for outgoing maps */
 void mpr_map_send(mpr_local_map m, mpr_time time)
 {
     int i, j, status, map_manages_inst = 0;
-    lo_message msg;
     mpr_local_dev dev;
     uint8_t bundle_idx;
     mpr_local_slot src_slot, dst_slot;
     mpr_local_sig src_sig;
     struct _mpr_sig_idmap *idmaps;
     mpr_id_map idmap = 0;
-    mpr_value *src_vals;
     char *types;
 
     RETURN_UNLESS(m->updated && m->expr && MPR_DIR_OUT == m->src[0]->dir && !m->muted);
@@ -473,9 +511,6 @@ void mpr_map_send(mpr_local_map m, mpr_time time)
     src_sig = (mpr_local_sig)src_slot->sig;
     idmaps = src_sig->idmaps;
 
-    src_vals = alloca(m->num_src * sizeof(mpr_value));
-    for (i = 0; i < m->num_src; i++)
-        src_vals[i] = &m->src[i]->val;
     dst_slot = m->dst;
 
     if (m->use_inst && !src_sig->use_inst) {
@@ -483,17 +518,15 @@ void mpr_map_send(mpr_local_map m, mpr_time time)
         idmap = m->idmap;
     }
 
-    types = alloca(dst_slot->sig->len * sizeof(char));
+    /* maps may already have been evaluated concurrently by the device */
+    if (!m->evaluated)
+        mpr_map_eval(m, dev->expr_stack, time);
 
     for (i = 0; i < m->num_inst; i++) {
-        /* Check if this instance has been updated */
-        if (!get_bitflag(m->updated_inst, i))
-            continue;
-        /* TODO: Check if this instance has enough history to process the expression */
-        status = mpr_expr_eval(dev->expr_stack, m->expr, src_vals, &m->vars,
-                               &dst_slot->val, &time, types, i);
+        status = m->eval_status[i];
         if (!status)
             continue;
+        types = m->eval_types + i * dst_slot->sig->len;
 
         if (src_sig->use_inst && !map_manages_inst) {
             /* finding idmaps here will be a bit inefficient for now */
@@ -512,8 +545,7 @@ void mpr_map_send(mpr_local_map m, mpr_time time)
 
         /* send instance release if dst is instanced and either src or map is also instanced. */
         if (idmap && status & EXPR_RELEASE_BEFORE_UPDATE && m->use_inst) {
-            msg = mpr_map_build_msg(m, 0, 0, 0, idmap);
-            mpr_link_add_msg(dst_slot->link, dst_slot->sig, msg, time, m->protocol, bundle_idx);
+            mpr_link_add_map_msg(dst_slot->link, dst_slot->sig, m, 0, 0, 0, idmap, time, bundle_idx);
             if (map_manages_inst) {
                 mpr_dev_LID_decref(dev, 0, idmap);
                 idmap = m->idmap = 0;
@@ -526,15 +558,13 @@ void mpr_map_send(mpr_local_map m, mpr_time time)
                 /* create an id_map and store it in the map */
                 idmap = m->idmap = mpr_dev_add_idmap(dev, 0, 0, 0);
             }
-            msg = mpr_map_build_msg(m, src_slot, result, types, idmap);
-            mpr_link_add_msg(dst_slot->link, dst_slot->sig, msg,
-                             *(mpr_time*)mpr_value_get_time(&dst_slot->val, i),
-                             m->protocol, bundle_idx);
+            mpr_link_add_map_msg(dst_slot->link, dst_slot->sig, m, src_slot, result, types, idmap,
+                                 *(mpr_time*)mpr_value_get_time(&dst_slot->val, i), bundle_idx);
+            STAT_INC(m, MAP_STAT_UPDATES_OUT);
         }
         /* send instance release if dst is instanced and either src or map is also instanced. */
         if (idmap && status & EXPR_RELEASE_AFTER_UPDATE && m->use_inst) {
-            msg = mpr_map_build_msg(m, 0, 0, 0, idmap);
-            mpr_link_add_msg(dst_slot->link, dst_slot->sig, msg, time, m->protocol, bundle_idx);
+            mpr_link_add_map_msg(dst_slot->link, dst_slot->sig, m, 0, 0, 0, idmap, time, bundle_idx);
             if (map_manages_inst) {
                 mpr_dev_LID_decref(dev, 0, idmap);
                 idmap = m->idmap = 0;
@@ -544,7 +574,8 @@ void mpr_map_send(mpr_local_map m, mpr_time time)
             break;
     }
     clear_bitflags(m->updated_inst, m->num_inst);
-    m->updated = 0;
+    m->updated = m->evaluated = 0;
+    m->trace.id = 0;
 }
 
 /* only called for incoming maps */
@@ -552,13 +583,13 @@ void mpr_map_send(mpr_local_map m, mpr_time time)
 void mpr_map_receive(mpr_local_map m, mpr_time time)
 {
     int i, j, status, val_size, map_manages_inst = 0;
+    mpr_local_dev dev;
+    mpr_trace_t prev_trace;
     mpr_local_slot src_slot, dst_slot;
     mpr_sig src_sig;
     mpr_local_sig dst_sig;
-    mpr_value src_vals[MAX_NUM_MAP_SRC];
     struct _mpr_sig_idmap *idmaps;
     mpr_id_map idmap = 0;
-    char *types;
 
     /* temporary solution: use most multitudinous source signal for idmap
      * permanent solution: move idmaps to map */
@@ -568,9 +599,6 @@ void mpr_map_receive(mpr_local_map m, mpr_time time)
             src_slot = m->src[i];
     }
     src_sig = src_slot->sig;
-
-    for (i = 0; i < m->num_src; i++)
-        src_vals[i] = &m->src[i]->val;
     dst_slot = m->dst;
     dst_sig = (mpr_local_sig)dst_slot->sig;
     idmaps = dst_sig->idmaps;
@@ -584,16 +612,19 @@ void mpr_map_receive(mpr_local_map m, mpr_time time)
         else
             idmap = 0;
     }
-    types = alloca(dst_sig->len * sizeof(char));
+    if (!m->evaluated)
+        mpr_map_eval(m, m->rtr->dev->expr_stack, time);
+
+    /* updates passed downstream continue the trace of the source update */
+    dev = (mpr_local_dev)dst_sig->dev;
+    prev_trace = dev->trace;
+    dev->trace = m->trace;
 
     for (i = 0; i < m->num_inst; i++) {
         mpr_sig_inst si;
         float diff;
 
-        if (!get_bitflag(m->updated_inst, i))
-            continue;
-        status = mpr_expr_eval(m->rtr->dev->expr_stack, m->expr, src_vals,
-                               &m->vars, &dst_slot->val, &time, types, i);
+        status = m->eval_status[i];
         if (!status)
             continue;
 
@@ -642,6 +673,7 @@ void mpr_map_receive(mpr_local_map m, mpr_time time)
             memcpy(si->val, result, val_size);
             memcpy(&si->time, &time, sizeof(mpr_time));
             si->has_val = 1;
+            STAT_INC(m, MAP_STAT_UPDATES_OUT);
 
             mpr_sig_call_handler(dst_sig, MPR_SIG_UPDATE, idmap ? idmap->LID : 0,
                                  dst_sig->len, si->val, &time, diff);
@@ -667,7 +699,24 @@ void mpr_map_receive(mpr_local_map m, mpr_time time)
             break;
     }
     clear_bitflags(m->updated_inst, m->num_inst);
-    m->updated = 0;
+    m->updated = m->evaluated = 0;
+    m->trace.id = 0;
+    dev->trace = prev_trace;
+}
+
+void mpr_map_set_stats(mpr_local_map m, int enable)
+{
+    if (enable && !m->stats) {
+        m->stats = (int64_t*)calloc(1, NUM_MAP_STATS * sizeof(int64_t));
+        RETURN_UNLESS(m->stats);
+        mpr_tbl_link_key(m->obj.props.synced, "stats", NUM_MAP_STATS, MPR_INT64,
+                         m->stats, NON_MODIFIABLE);
+    }
+    else if (!enable && m->stats) {
+        mpr_tbl_unlink_key(m->obj.props.synced, "stats");
+        free(m->stats);
+        m->stats = 0;
+    }
 }
 
 /*! Build a value update message for a given map. */
@@ -675,16 +724,19 @@ lo_message mpr_map_build_msg(mpr_local_map m, mpr_local_slot slot, const void *v
                              mpr_type *types, mpr_id_map idmap)
 {
     int i, len = 0;
+    mpr_type type = 0;
     NEW_LO_MSG(msg, return 0);
     if (MPR_LOC_SRC == m->process_loc)
         len = m->dst->sig->len;
     else if (slot)
         len = slot->sig->len;
+    if (val && !types)
+        type = slot ? slot->sig->type : m->dst->sig->type;
 
-    if (val && types) {
+    if (val) {
         /* value of vector elements can be <type> or NULL */
         for (i = 0; i < len; i++) {
-            switch (types[i]) {
+            switch (types ? types[i] : type) {
             case MPR_INT32: lo_message_add_int32(msg, ((int*)val)[i]);     break;
             case MPR_FLT:   lo_message_add_float(msg, ((float*)val)[i]);   break;
             case MPR_DBL:   lo_message_add_double(msg, ((double*)val)[i]); break;
@@ -706,9 +758,139 @@ lo_message mpr_map_build_msg(mpr_local_map m, mpr_local_slot slot, const void *v
         lo_message_add_string(msg, "@sl");
         lo_message_add_int32(msg, slot->id);
     }
+    if (val && m->trace.id) {
+        /* add trace id and origin time */
+        lo_message_add_string(msg, "@tr");
+        lo_message_add_int64(msg, m->trace.id);
+        lo_message_add_timetag(msg, *(lo_timetag*)&m->trace.origin);
+    }
     return msg;
 }
 
+size_t mpr_map_write_msg(mpr_local_map m, mpr_local_slot slot, const void *val, mpr_type *types,
+                         mpr_id_map idmap, const char *path, char *buf, size_t size)
+{
+    int i, len = 0, num_types = 0;
+    size_t path_len = strlen(path), arg_size = 0, msg_len;
+    mpr_type type = 0;
+    char *tt, *arg;
+    if (MPR_LOC_SRC == m->process_loc)
+        len = m->dst->sig->len;
+    else if (slot)
+        len = slot->sig->len;
+    if (val && !types)
+        type = slot ? slot->sig->type : m->dst->sig->type;
+
+    /* measure the message before writing anything */
+    if (val) {
+        for (i = 0; i < len; i++) {
+            switch (types ? types[i] : type) {
+                case MPR_INT32:
+                case MPR_FLT:   ++num_types; arg_size += 4; break;
+                case MPR_DBL:   ++num_types; arg_size += 8; break;
+                case MPR_NULL:  ++num_types;                break;
+                default:                                    break;
+            }
+        }
+    }
+    else if (m->use_inst)
+        num_types += len;
+    if (m->use_inst && idmap) {
+        num_types += 2;
+        arg_size += 12;
+    }
+    if (slot) {
+        num_types += 2;
+        arg_size += 8;
+    }
+    if (val && m->trace.id) {
+        num_types += 3;
+        arg_size += 20;
+    }
+    msg_len = OSC_PAD(path_len + 1) + OSC_PAD(num_types + 2) + arg_size;
+    RETURN_ARG_UNLESS(msg_len <= size, msg_len);
+
+    memset(buf, 0, msg_len);
+    memcpy(buf, path, path_len);
+    tt = buf + OSC_PAD(path_len + 1);
+    arg = tt + OSC_PAD(num_types + 2);
+    *tt++ = ',';
+    if (val) {
+        for (i = 0; i < len; i++) {
+            mpr_type t = types ? types[i] : type;
+            switch (t) {
+                case MPR_INT32:
+                    osc_write32(arg, (uint32_t)((int*)val)[i]);
+                    arg += 4;
+                    break;
+                case MPR_FLT: {
+                    uint32_t u;
+                    memcpy(&u, (float*)val + i, 4);
+                    osc_write32(arg, u);
+                    arg += 4;
+                    break;
+                }
+                case MPR_DBL: {
+                    uint64_t u;
+                    memcpy(&u, (double*)val + i, 8);
+                    osc_write64(arg, u);
+                    arg += 8;
+                    break;
+                }
+                case MPR_NULL:
+                    break;
+                default:
+                    continue;
+            }
+            *tt++ = t;
+        }
+    }
+    else if (m->use_inst) {
+        for (i = 0; i < len; i++)
+            *tt++ = MPR_NULL;
+    }
+    if (m->use_inst && idmap) {
+        *tt++ = MPR_STR;
+        *tt++ = MPR_INT64;
+        memcpy(arg, "@in", 3);
+        osc_write64(arg + 4, (uint64_t)idmap->GID);
+        arg += 12;
+    }
+    if (slot) {
+        *tt++ = MPR_STR;
+        *tt++ = MPR_INT32;
+        memcpy(arg, "@sl", 3);
+        osc_write32(arg + 4, (uint32_t)slot->id);
+        arg += 8;
+    }
+    if (val && m->trace.id) {
+        *tt++ = MPR_STR;
+        *tt++ = MPR_INT64;
+        *tt++ = MPR_TIME;
+        memcpy(arg, "@tr", 3);
+        osc_write64(arg + 4, (uint64_t)m->trace.id);
+        osc_write32(arg + 12, m->trace.origin.sec);
+        osc_write32(arg + 16, m->trace.origin.frac);
+    }
+    return msg_len;
+}
+
+/* Check whether the user variables of a new expression are the same as those already allocated,
+ * in which case they can be kept as they are when the expression is replaced. */
+static int _vars_match(mpr_local_map m, int num_vars)
+{
+    int i;
+    mpr_expr e = m->expr;
+    RETURN_ARG_UNLESS(num_vars == m->num_vars && m->vars, 0);
+    for (i = 0; i < num_vars; i++) {
+        RETURN_ARG_UNLESS(m->var_names[i] && m->vars[i].inst, 0);
+        RETURN_ARG_UNLESS(0 == strcmp(m->var_names[i], mpr_expr_get_var_name(e, i)), 0);
+        RETURN_ARG_UNLESS(m->vars[i].vlen == mpr_expr_get_var_vec_len(e, i), 0);
+        RETURN_ARG_UNLESS(m->vars[i].type == mpr_expr_get_var_type(e, i), 0);
+    }
+    return 1;
+}
+
 void mpr_map_alloc_values(mpr_local_map m)
 {
     /* TODO: check if this filters non-local processing.
@@ -742,6 +924,17 @@ void mpr_map_alloc_values(mpr_local_map m)
     mpr_slot_alloc_values(m->dst, num_inst, hist_size);
 
     num_vars = mpr_expr_get_num_vars(e);
+    if (_vars_match(m, num_vars)) {
+        /* same variables as the previous expression: keep their values in place */
+        for (i = 0; i < num_vars; i++) {
+            int var_num_inst = mpr_expr_get_var_is_instanced(e, i) ? num_inst : 1;
+            mpr_value_realloc(&m->vars[i], m->vars[i].vlen, m->vars[i].type, 1, var_num_inst);
+            for (j = 0; j < var_num_inst; j++)
+                m->vars[i].inst[j].pos = 0;
+        }
+        goto alloc_inst;
+    }
+
     vars = calloc(1, sizeof(mpr_value_t) * num_vars);
     var_names = malloc(sizeof(char*) * num_vars);
     for (i = 0; i < num_vars; i++) {
@@ -752,17 +945,18 @@ void mpr_map_alloc_values(mpr_local_map m)
         for (j = 0; j < m->num_vars; j++) {
             if (!m->var_names[j] || strcmp(m->var_names[j], var_names[i]))
                 continue;
-            if (m->vars[i].vlen != vlen)
+            if (m->vars[j].vlen != vlen || !m->vars[j].inst)
                 continue;
             /* match found */
             break;
         }
         if (j < m->num_vars) {
-            /* copy old variable memory */
+            /* move old variable memory, values are kept unless the type has changed */
             memcpy(&vars[i], &m->vars[j], sizeof(mpr_value_t));
             m->vars[j].inst = 0;
+            m->vars[j].num_inst = 0;
         }
-        mpr_value_realloc(&vars[i], vlen, mpr_expr_get_var_type(e, i), 1, var_num_inst, 0);
+        mpr_value_realloc(&vars[i], vlen, mpr_expr_get_var_type(e, i), 1, var_num_inst);
         /* set position to 0 since we are not currently allowing history on user variables */
         for (j = 0; j < var_num_inst; j++)
             vars[i].inst[j].pos = 0;
@@ -779,13 +973,31 @@ void mpr_map_alloc_values(mpr_local_map m)
     m->vars = vars;
     m->var_names = var_names;
     m->num_vars = num_vars;
+
+  alloc_inst:
+    if (!m->updated_inst || num_inst != m->num_inst) {
+        /* allocate update bitflags */
+        if (m->updated_inst)
+            m->updated_inst = realloc(m->updated_inst, num_inst / 8 + 1);
+        else
+            m->updated_inst = calloc(1, num_inst / 8 + 1);
+
+        /* allocate per-instance evaluation results */
+        m->eval_status = realloc(m->eval_status, num_inst);
+        m->eval_types = realloc(m->eval_types, num_inst * m->dst->sig->len);
+    }
     m->num_inst = num_inst;
+    m->evaluated = 0;
+}
 
-    /* allocate update bitflags */
-    if (m->updated_inst)
-        m->updated_inst = realloc(m->updated_inst, num_inst / 8 + 1);
-    else
-        m->updated_inst = calloc(1, num_inst / 8 + 1);
+/* Copy a lookup table or curve stored as a map property into an expression. */
+static int _set_expr_tbl(mpr_local_map m, mpr_expr expr, const char *key)
+{
+    int len;
+    mpr_type type;
+    const void *val;
+    mpr_tbl_get_prop_by_key(m->obj.props.synced, key, &len, &type, &val, 0);
+    return mpr_expr_set_tbl(expr, key, len, type, val);
 }
 
 /* Helper to replace a map's expression only if the given string
@@ -805,6 +1017,8 @@ static int _replace_expr_str(mpr_local_map m, const char *expr_str)
     expr = mpr_expr_new_from_str(m->rtr->dev->expr_stack, expr_str, m->num_src, src_types,
                                  src_lens, m->dst->sig->type, m->dst->sig->len);
     RETURN_ARG_UNLESS(expr, 1);
+    for (i = 0; i < mpr_expr_get_num_tbls(expr); i++)
+        _set_expr_tbl(m, expr, mpr_expr_get_tbl_name(expr, i));
 
     /* expression update may force processing location to change
      * e.g. if expression combines signals from different devices
@@ -1151,9 +1365,14 @@ static int _set_expr(mpr_local_map m, const char *expr)
         mpr_map_alloc_values(m);
         /* evaluate expression to intialise literals */
         mpr_time_set(&now, MPR_NOW);
-        for (i = 0; i < m->num_inst; i++)
-            mpr_expr_eval(m->rtr->dev->expr_stack, m->expr, 0, &m->vars,
-                          &m->dst->val, &now, types, i);
+        for (i = 0; i < m->num_inst; i++) {
+            /* Skip instances that kept their output history from a previous expression: their
+             * initialisers would not be run and evaluating would push a sample into the history. */
+            mpr_value v = &m->dst->val;
+            if (v->inst && v->inst[i % v->num_inst].pos >= 0)
+                continue;
+            mpr_expr_eval(m->rtr->dev->expr_stack, m->expr, 0, &m->vars, v, &now, types, i);
+        }
     }
     else {
         if (!m->expr && (   (MPR_LOC_DST == m->process_loc && m->dst->sig->is_local)
@@ -1414,6 +1633,17 @@ int mpr_map_set_from_msg(mpr_map m, mpr_msg msg, int override)
                         --i;
                     }
                 }
+                else if (m->is_local && strcmp(a->key, "stats")==0) {
+                    /* statistics of local maps are only counted locally */
+                    break;
+                }
+                else if (strncmp(a->key, "lut.", 4)==0 || strncmp(a->key, "curve.", 6)==0) {
+                    /* lookup tables referenced by the expression */
+                    updated += mpr_tbl_set_from_atom(tbl, a, REMOTE_MODIFY);
+                    if (m->is_local && ((mpr_local_map)m)->expr)
+                        _set_expr_tbl((mpr_local_map)m, ((mpr_local_map)m)->expr, a->key);
+                    break;
+                }
                 else if (strncmp(a->key, "var@", 4)==0) {
                     if (m->is_local && ((mpr_local_map)m)->expr) {
                         mpr_local_map lm = (mpr_local_map)m;
@@ -19,6 +19,10 @@
 #define FUNC_IF(func, arg) { if (arg) { func(arg); }}
 #define PROP(NAME) MPR_PROP_##NAME
 
+/* Runtime statistics are only counted if enabled using mpr_dev_set_stats(). */
+#define STAT_INC(obj, idx) { if ((obj)->stats) { ++(obj)->stats[idx]; }}
+#define STAT_ADD(obj, idx, n) { if ((obj)->stats) { (obj)->stats[idx] += (n); }}
+
 #if DEBUG
 #define TRACE_RETURN_UNLESS(a, ret, ...) \
 if (!(a)) { trace(__VA_ARGS__); return ret; }
@@ -79,6 +83,63 @@ if (!(a)) { trace_net(__VA_ARGS__); return ret; }
 void print_subscription_flags(int flags);
 #endif
 
+/**** Reactor ****/
+
+/* liblo does not expose the sockets of connections accepted by TCP servers, so
+ * once these may be open they are checked at least this often (ms). */
+#define TCP_POLL_MS 100
+
+/*! Create an event loop for blocking polls.
+ *  \return             The new reactor, or NULL if not supported on this platform. */
+mpr_reactor mpr_reactor_new(void);
+
+void mpr_reactor_free(mpr_reactor r);
+
+/*! Watch the sockets of a set of liblo servers, replacing the previous set if
+ *  it differs. */
+void mpr_reactor_set_servers(mpr_reactor r, lo_server *servers, int num);
+
+/*! Block until a watched server is readable, mpr_reactor_wake() is called or
+ *  the timeout elapses.
+ *  \param r            The reactor.
+ *  \param timeout_ms   Maximum time to wait in milliseconds, or -1 for no limit.
+ *  \return             1 if there is something to process, 0 on timeout. */
+int mpr_reactor_wait(mpr_reactor r, int timeout_ms);
+
+/*! Wake a reactor that is blocked in mpr_reactor_wait(). Safe to call from
+ *  any thread. */
+void mpr_reactor_wake(mpr_reactor r);
+
+/**** Poller pool ****/
+
+/*! Hand a device over to the shared polling threads.
+ *  \param dev          The device to poll.
+ *  \return             0 if the device was added, 1 if the pool is disabled,
+ *                      or a negative number on error. */
+int mpr_pool_add_dev(mpr_local_dev dev);
+
+/*! Stop polling a device from the shared polling threads. Does nothing if the
+ *  device is not part of the pool. */
+void mpr_pool_remove_dev(mpr_local_dev dev);
+
+/*! Create threads for evaluating maps concurrently.
+ *  \param num_threads  The number of threads including the caller of
+ *                      mpr_eval_pool_run().
+ *  \return             The new pool, or NULL if threads are not available. */
+mpr_eval_pool mpr_eval_pool_new(int num_threads);
+
+void mpr_eval_pool_free(mpr_eval_pool pool);
+
+/*! Queue an updated map for the next call to mpr_eval_pool_run(). */
+void mpr_eval_pool_add(mpr_eval_pool pool, mpr_local_map map);
+
+/*! Evaluate all queued maps using the pool threads and the calling thread,
+ *  returning once all of them have been evaluated.
+ *  \param pool         The pool.
+ *  \param stk          Expression stack used by the calling thread.
+ *  \param time         Timestamp for this update. */
+void mpr_eval_pool_run(mpr_eval_pool pool, mpr_expr_stack stk, mpr_time time);
+
 /**** Objects ****/
 void mpr_obj_increment_version(mpr_obj obj);
 
@@ -86,22 +147,64 @@ void mpr_obj_increment_version(mpr_obj obj);
 
 /**** Networking ****/
 
+extern const char* net_msg_strings[];
+
 void mpr_net_add_dev(mpr_net n, mpr_local_dev d);
 
 void mpr_net_remove_dev(mpr_net n, mpr_local_dev d);
 
+/*! Probe the proposed name of a device that is not yet registered. */
+void mpr_net_probe_dev_name(mpr_net n, mpr_local_dev d);
+
 void mpr_net_poll(mpr_net n);
 
+/*! Return the number of milliseconds until mpr_net_poll() or graph
+ *  housekeeping next have work to do. */
+int mpr_net_get_ms_until_due(mpr_net n);
+
 void mpr_net_init(mpr_net n, const char *iface, const char *group, int port);
 
 void mpr_net_use_bus(mpr_net n);
 
 void mpr_net_use_mesh(mpr_net n, lo_address addr);
 
+/*! Collect subsequent messages into a single compressed bundle that will be
+ *  sent to a TCP address by mpr_net_send(). */
+void mpr_net_use_bulk(mpr_net n, lo_address addr);
+
+/*! Collect subsequent /map messages into a batch for a single device that will be
+ *  acknowledged as a whole. Batches are split if they grow too large.
+ *  \param n            The network structure.
+ *  \param dev          The destination device of the maps.
+ *  \return             The id of the batch currently being collected. */
+int mpr_net_use_batch(mpr_net n, mpr_dev dev);
+
 void mpr_net_use_subscribers(mpr_net net, mpr_local_dev dev, int type);
 
+/*! Allocate the multicast address shared by subscribers of a local device.
+ *  \param n            The network structure.
+ *  \param id           The id of the device, used to choose a group and port.
+ *  \param url          Location to store a newly-allocated URL for the group.
+ *  \return             The group address, or NULL on failure. */
+lo_address mpr_net_new_sub_group(mpr_net n, mpr_id id, char **url);
+
+/*! Open a server joined to a device's subscriber group, dispatching to the
+ *  graph message handlers. */
+lo_server mpr_net_join_sub_group(mpr_net n, const char *url);
+
 void mpr_net_add_msg(mpr_net n, const char *str, net_msg_t cmd, lo_message msg);
 
+/*! Resolve the address of a remote UDP endpoint for mpr_net_send_udp().
+ *  \param host         The remote host.
+ *  \param port         The remote UDP port.
+ *  \param len          Location to store the length of the address.
+ *  \return             A newly-allocated socket address, or NULL on failure. */
+void *mpr_net_resolve_udp(const char *host, int port, int *len);
+
+/*! Send a serialized OSC packet from the socket of a server. Unlike the liblo
+ *  send functions this does not allocate any memory. */
+int mpr_net_send_udp(lo_server from, const void *addr, int addr_len, const void *data, size_t len);
+
 void mpr_net_handle_map(mpr_net net, mpr_local_map map, mpr_msg props);
 
 void mpr_net_send(mpr_net n);
@@ -122,7 +225,17 @@ if (!VARNAME) {                                     \
 int mpr_dev_set_from_msg(mpr_dev dev, mpr_msg msg);
 
 void mpr_dev_manage_subscriber(mpr_local_dev dev, lo_address address, int flags,
-                               int timeout_seconds, int revision);
+                               int timeout_seconds, int revision, int bulk_port,
+                               int in_group);
+
+/*! Record a change that subscribers resyncing from an earlier revision must receive.
+ *  \param dev          The local device.
+ *  \param maps         1 if the maps of the device changed.
+ *  \param removed      1 if a signal, map or property was removed. */
+void mpr_dev_record_change(mpr_local_dev dev, int maps, int removed);
+
+/*! Release the multicast group of a device once it has no subscribers left. */
+void mpr_dev_release_sub_group(mpr_local_dev dev);
 
 /*! Return the list of inter-device links associated with a given device.
  *  \param dev          Device record query.
@@ -160,6 +273,27 @@ MPR_INLINE static void mpr_dev_GID_incref(mpr_local_dev dev, mpr_id_map map)
 
 int mpr_dev_LID_decref(mpr_local_dev dev, int group, mpr_id_map map);
 
+/*! Fill an array with the servers polled by a device.
+ *  \param dev          The device.
+ *  \param servers      An array with room for at least 5 servers.
+ *  \return             The number of servers. */
+int mpr_dev_get_servers(mpr_local_dev dev, lo_server *servers);
+
+/*! Send the properties of a device and its maps to subscribers if runtime
+ *  statistics or tracing are enabled, so that remote graphs see updated
+ *  "@stats" and "@latency" properties. */
+void mpr_dev_send_stats(mpr_local_dev dev);
+
+/*! Wake a device blocked in mpr_dev_poll() on another thread so that updated
+ *  signals are sent without waiting for the next socket event. */
+MPR_INLINE static void mpr_dev_wake(mpr_local_dev dev)
+{
+    if (dev->reactor && !dev->polling && !dev->wake_pending) {
+        dev->wake_pending = 1;
+        mpr_reactor_wake(dev->reactor);
+    }
+}
+
 int mpr_dev_GID_decref(mpr_local_dev dev, int group, mpr_id_map map);
 
 void init_dev_prop_tbl(mpr_dev dev);
@@ -203,6 +337,14 @@ mpr_dev mpr_graph_get_dev_by_name(mpr_graph g, const char *name);
 
 mpr_map mpr_graph_get_map_by_names(mpr_graph g, int num_src, const char **srcs, const char *dst);
 
+int mpr_graph_can_batch_map(mpr_graph g, mpr_map m);
+
+/*! Add a map definition to the batch collected for its destination device.
+ *  \param g            The graph owning the map.
+ *  \param m            The map to add.
+ *  \param msg          A prepared /map message, or zero to use the staged properties of the map. */
+void mpr_graph_batch_map(mpr_graph g, mpr_map m, lo_message msg);
+
 /*! Call registered graph callbacks for a given object type.
  *  \param g            The graph to query.
  *  \param o            The object to pass to the callbacks.
@@ -214,6 +356,18 @@ void mpr_graph_cleanup(mpr_graph g);
 
 void mpr_graph_housekeeping(mpr_graph g);
 
+/*! Start receiving metadata for a subscribed device on its multicast group. */
+void mpr_graph_join_sub_group(mpr_graph g, mpr_dev d, const char *url);
+
+/*! Check whether a device or signal name belongs to a device whose subscriber group we joined.
+ *  \param g            The graph to query.
+ *  \param name         A device name or full signal name.
+ *  \return             1 if the device was joined on its group, 0 otherwise. */
+int mpr_graph_get_is_grouped(mpr_graph g, const char *name);
+
+/*! Process pending messages on any joined subscriber groups. */
+void mpr_graph_recv_sub_groups(mpr_graph g);
+
 /***** Router *****/
 
 void mpr_rtr_remove_sig(mpr_rtr r, mpr_rtr_sig rs);
@@ -267,6 +421,10 @@ void mpr_sig_free_internal(mpr_sig sig);
 
 void mpr_sig_send_state(mpr_sig sig, net_msg_t cmd);
 
+/*! Send the properties of a local signal that changed after a given device
+ *  revision. Nothing is sent if the signal is unchanged since then. */
+void mpr_sig_send_changes(mpr_sig sig, int version);
+
 void mpr_sig_send_removed(mpr_local_sig sig);
 
 /**** Instances ****/
@@ -321,10 +479,20 @@ void mpr_link_free(mpr_link link);
 int mpr_link_process_bundles(mpr_link link, mpr_time t, int idx);
 void mpr_link_add_msg(mpr_link link, mpr_sig dst, lo_message msg, mpr_time t, mpr_proto proto, int idx);
 
+/*! Queue a value update or instance release for a map. Unless the map uses TCP
+ *  the message is serialized directly into the bundle of the link, so that no
+ *  memory is allocated once the bundle buffer has grown to its working size.
+ *  Arguments are as for mpr_map_build_msg(). */
+void mpr_link_add_map_msg(mpr_link link, mpr_sig dst, mpr_local_map map, mpr_local_slot slot,
+                          const void *val, mpr_type *types, mpr_id_map idmap, mpr_time t, int idx);
+
 mpr_link mpr_graph_add_link(mpr_graph g, mpr_dev dev1, mpr_dev dev2);
 
 int mpr_link_get_is_local(mpr_link link);
 
+/*! Allocate or free the runtime statistics of a link. */
+void mpr_link_set_stats(mpr_link link, int enable);
+
 /**** Maps ****/
 
 void mpr_map_alloc_values(mpr_local_map map);
@@ -335,11 +503,35 @@ void mpr_map_alloc_values(mpr_local_map map);
  *  \param time         Timestamp for this update. */
 void mpr_map_send(mpr_local_map map, mpr_time time);
 
+/*! Evaluate the updated instances of a map ahead of mpr_map_send() or
+ *  mpr_map_receive(). Only the map itself is modified, so different maps may
+ *  be evaluated on different threads.
+ *  \param map          The map to evaluate.
+ *  \param stk          An expression stack not in use by any other thread.
+ *  \param time         Timestamp for this update. */
+void mpr_map_eval(mpr_local_map map, mpr_expr_stack stk, mpr_time time);
+
 void mpr_map_receive(mpr_local_map map, mpr_time time);
 
+/*! Build a value update message for a map. The types may be NULL if every
+ *  element of val has the type of the slot signal. */
 lo_message mpr_map_build_msg(mpr_local_map map, mpr_local_slot slot, const void *val,
                              mpr_type *types, mpr_id_map idmap);
 
+/*! Serialize the same message as mpr_map_build_msg() in OSC format without
+ *  allocating.
+ *  \param path         The OSC path of the message.
+ *  \param buf          The buffer to write to.
+ *  \param size         The size of the buffer.
+ *  \return             The length of the message. Nothing is written if this
+ *                      is larger than size. */
+size_t mpr_map_write_msg(mpr_local_map map, mpr_local_slot slot, const void *val, mpr_type *types,
+                         mpr_id_map idmap, const char *path, char *buf, size_t size);
+
+/*! Allocate or free the runtime statistics of a map and expose them as the
+ *  read-only property "@stats". */
+void mpr_map_set_stats(mpr_local_map map, int enable);
+
 /*! Set a mapping's properties based on message parameters. */
 int mpr_map_set_from_msg(mpr_map map, mpr_msg msg, int override);
 
@@ -478,6 +670,19 @@ int mpr_expr_get_manages_inst(mpr_expr expr);
 
 void mpr_expr_var_updated(mpr_expr expr, int var_idx);
 
+int mpr_expr_get_num_tbls(mpr_expr expr);
+
+const char *mpr_expr_get_tbl_name(mpr_expr expr, int idx);
+
+/*! Provide the data for a lookup table or curve referenced by an expression.
+ *  \param expr         The expression to update.
+ *  \param name         The table name, e.g. "lut.gamma" or "curve.knee".
+ *  \param len          The number of values.
+ *  \param type         The type of the values.
+ *  \param vals         The table values, or interleaved x, y breakpoints for curves.
+ *  \return             1 if the expression uses the named table, 0 otherwise. */
+int mpr_expr_set_tbl(mpr_expr expr, const char *name, int len, mpr_type type, const void *vals);
+
 #ifdef DEBUG
 void printexpr(const char*, mpr_expr);
 #endif
@@ -509,6 +714,9 @@ void mpr_expr_free(mpr_expr expr);
 mpr_expr_stack mpr_expr_stack_new();
 void mpr_expr_stack_free(mpr_expr_stack stk);
 
+/*! Make sure an expression stack is large enough to evaluate an expression. */
+void mpr_expr_stack_reserve(mpr_expr_stack stk, mpr_expr expr);
+
 /**** String tables ****/
 
 /*! Create a new string table. */
@@ -558,6 +766,15 @@ int mpr_tbl_set(mpr_tbl tab, int prop, const char *key, int len,
 void mpr_tbl_link(mpr_tbl tab, mpr_prop prop, int length, mpr_type type,
                   void *val, int flags);
 
+/*! Sync an existing value with a keyed table record, e.g. for exposing runtime
+ *  statistics. Unlike mpr_tbl_link() the table is sorted afterwards, and the
+ *  record is only modifiable if requested in the flags. */
+void mpr_tbl_link_key(mpr_tbl tab, const char *key, int length, mpr_type type,
+                      void *val, int flags);
+
+/*! Remove a record previously added using mpr_tbl_link_key(). */
+void mpr_tbl_unlink_key(mpr_tbl tab, const char *key);
+
 /*! Add a typed OSC argument from a mpr_msg to a string table.
  *  \param tab      Table to update.
  *  \param atom     Message atom containing pointers to message key and value.
@@ -573,6 +790,24 @@ void mpr_tbl_print(mpr_tbl tab);
 /*! Add arguments contained in a string table to a lo_message */
 void mpr_tbl_add_to_msg(mpr_tbl tab, mpr_tbl updates, lo_message msg);
 
+/*! Assign a device revision to records modified since the last stamp.
+ *  \param tab          Table to update.
+ *  \param version      The device revision to record. */
+void mpr_tbl_stamp(mpr_tbl tab, int version);
+
+/*! Add only the records of a string table that have changed after a given
+ *  device revision to a lo_message.
+ *  \param tab          Table to read.
+ *  \param version      The device revision already known to the recipient.
+ *  \param msg          The message to add to. */
+void mpr_tbl_add_changes_to_msg(mpr_tbl tab, int version, lo_message msg);
+
+/*! Add the records of a string table needed to recreate an object to a
+ *  lo_message, skipping read-only state such as status and statistics.
+ *  \param tab          Table to read.
+ *  \param msg          The message to add to. */
+void mpr_tbl_add_config_to_msg(mpr_tbl tab, lo_message msg);
+
 /*! Clears and frees memory for removed records. This is not performed
  *  automatically by mpr_tbl_remove() in order to allow record
  *  removal to propagate to subscribed graph instances and peer devices. */
@@ -580,6 +815,35 @@ void mpr_tbl_clear_empty(mpr_tbl tab);
 
 int match_pattern(const char* s, const char* p);
 
+/**** Interned strings ****/
+
+/*! Return the process-wide interned copy of a string, adding a reference.
+ *  Two strings interned from equal contents will have the same address, so
+ *  interned strings may be compared using '=='.
+ *  \param str          The string to intern.
+ *  \return             The interned string, to be released using mpr_str_free(). */
+const char *mpr_str_intern(const char *str);
+
+/*! Same as mpr_str_intern(), but prepends a slash to the name if missing. */
+const char *mpr_str_intern_path(const char *name);
+
+/*! Add a reference to a string that is already interned. */
+const char *mpr_str_ref(const char *str);
+
+/*! Look up the interned copy of a string without adding a reference.
+ *  \param str          The string to look up.
+ *  \return             The interned string, or zero if no object holds this string. */
+const char *mpr_str_find(const char *str);
+
+/*! Same as mpr_str_find() but only the first len characters of str are used. */
+const char *mpr_str_find_len(const char *str, int len);
+
+/*! Same as mpr_str_find() but a leading slash is implied if missing. */
+const char *mpr_str_find_path(const char *name);
+
+/*! Release a reference to an interned string. */
+void mpr_str_free(const char *str);
+
 /**** Lists ****/
 
 void *mpr_list_from_data(const void *data);
@@ -600,12 +864,33 @@ mpr_list mpr_list_start(mpr_list list);
 /*! Get the current time. */
 double mpr_get_current_time(void);
 
+/*! Get the current reading of the built-in clock in nanoseconds. */
+int64_t mpr_get_current_ns(void);
+
 /*! Return the difference in seconds between two mpr_times.
  *  \param minuend      The minuend.
  *  \param subtrahend   The subtrahend.
  *  \return             The difference a-b in seconds. */
 double mpr_time_get_diff(mpr_time minuend, mpr_time subtrahend);
 
+/*! Reset the clock synchronization state of a link. */
+void mpr_sync_clock_init(mpr_sync_clock clk);
+
+/*! Add a round-trip measurement to a clock synchronization estimate.
+ *  \param clk          The clock to update.
+ *  \param sent         Local time at which our ping was sent.
+ *  \param rcvd         Local time at which the reply was received.
+ *  \param remote       Remote time at which the reply was sent.
+ *  \param hold         Time the remote device held our ping before replying. */
+void mpr_sync_clock_add_sample(mpr_sync_clock clk, mpr_time sent, mpr_time rcvd,
+                               mpr_time remote, double hold);
+
+/*! Convert a remote timetag to local time using a clock synchronization
+ *  estimate. Timetags are left unchanged until a sample has been added.
+ *  \param clk          The clock synchronization estimate.
+ *  \param t            The timetag to convert. */
+void mpr_sync_clock_to_local(mpr_sync_clock clk, mpr_time *t);
+
 /**** Properties ****/
 
 /*! Helper for printing typed values.
@@ -645,7 +930,7 @@ MPR_INLINE static int mpr_type_get_size(mpr_type type)
 /**** Values ****/
 
 void mpr_value_realloc(mpr_value val, unsigned int vec_len, mpr_type type,
-                       unsigned int mem_len, unsigned int num_inst, int is_output);
+                       unsigned int mem_len, unsigned int num_inst);
 
 void mpr_value_reset_inst(mpr_value v, int idx);
 
@@ -777,4 +1062,32 @@ MPR_INLINE static void clear_bitflags(char *bytearray, int num_flags)
     memset(bytearray, 0, num_flags / 8 + 1);
 }
 
+/* OSC data is big-endian and padded to multiples of 4 bytes. */
+#define OSC_PAD(len) (((len) + 3) & ~3)
+
+MPR_INLINE static void osc_write32(char *p, uint32_t v)
+{
+    p[0] = (char)(v >> 24);
+    p[1] = (char)(v >> 16);
+    p[2] = (char)(v >> 8);
+    p[3] = (char)v;
+}
+
+MPR_INLINE static void osc_write64(char *p, uint64_t v)
+{
+    osc_write32(p, (uint32_t)(v >> 32));
+    osc_write32(p + 4, (uint32_t)v);
+}
+
+MPR_INLINE static uint32_t osc_read32(const char *p)
+{
+    const unsigned char *u = (const unsigned char*)p;
+    return ((uint32_t)u[0] << 24) | ((uint32_t)u[1] << 16) | ((uint32_t)u[2] << 8) | u[3];
+}
+
+MPR_INLINE static uint64_t osc_read64(const char *p)
+{
+    return ((uint64_t)osc_read32(p) << 32) | osc_read32(p + 4);
+}
+
 #endif /* __MAPPER_INTERNAL_H__ */
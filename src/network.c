@@ -8,6 +8,7 @@
 #include <zlib.h>
 #include <math.h>
 #include <ctype.h>
+#include <limits.h>
 
 
 #ifdef HAVE_GETIFADDRS
@@ -17,6 +18,8 @@
 
 #ifdef HAVE_ARPA_INET_H
  #include <arpa/inet.h>
+ #include <netdb.h>
+ #include <sys/socket.h>
 #else
  #ifdef HAVE_WINSOCK2_H
   #include <winsock2.h>
@@ -37,6 +40,10 @@ extern const char* prop_msg_strings[MPR_PROP_EXTRA+1];
 #define BUNDLE_DST_BUS          0
 
 #define MAX_BUNDLE_LEN 8192
+/* Bulk metadata holds one device's signals and maps: allow a few megabytes once uncompressed,
+ * and no more than zlib's maximum expansion of the received data. */
+#define MAX_BULK_LEN (4 * 1024 * 1024)
+#define MAX_BULK_RATIO 1032
 #define FIND 0
 #define UPDATE 1
 #define ADD 2
@@ -90,6 +97,9 @@ const char* net_msg_strings[] =
     "/unmap",                   /* MSG_UNMAP */
     "/unmapped",                /* MSG_UNMAPPED */
     "/who",                     /* MSG_WHO */
+    "/bulk",                    /* MSG_BULK */
+    "/%s/map/batch",            /* MSG_MAP_BATCH */
+    "/mapped/batch",            /* MSG_MAPPED_BATCH */
 };
 
 #define HANDLER_ARGS const char*, const char*, lo_arg**, int, lo_message, void*
@@ -112,6 +122,10 @@ static int handler_sync(HANDLER_ARGS);
 static int handler_unmap(HANDLER_ARGS);
 static int handler_unmapped(HANDLER_ARGS);
 static int handler_who(HANDLER_ARGS);
+static int handler_bulk(HANDLER_ARGS);
+static int handler_map_batch(HANDLER_ARGS);
+static int handler_mapped_batch(HANDLER_ARGS);
+static int handler_sub_group(HANDLER_ARGS);
 
 static int _handler_name(HANDLER_ARGS);
 
@@ -139,6 +153,7 @@ static struct handler_method_assoc dev_handlers_specific[] = {
     {MSG_DEV_MOD,               NULL,       handler_dev_mod},
     {MSG_SIG_MOD,               NULL,       handler_sig_mod},
     {MSG_SUBSCRIBE,             NULL,       handler_subscribe},
+    {MSG_MAP_BATCH,             "ib",       handler_map_batch},
 };
 const int NUM_DEV_HANDLERS_SPECIFIC =
     sizeof(dev_handlers_specific)/sizeof(dev_handlers_specific[0]);
@@ -148,6 +163,7 @@ static struct handler_method_assoc graph_handlers[] = {
     {MSG_DEV,                   NULL,       handler_dev},
     {MSG_LOGOUT,                NULL,       handler_logout},
     {MSG_MAPPED,                NULL,       handler_mapped},
+    {MSG_MAPPED_BATCH,          NULL,       handler_mapped_batch},
     {MSG_SIG,                   NULL,       handler_sig},
     {MSG_SIG_REM,               "s",        handler_sig_removed},
     {MSG_SYNC,                  NULL,       handler_sync},
@@ -163,6 +179,19 @@ static void handler_error(int num, const char *msg, const char *where)
     trace_net("[libmapper] liblo server error %d in path %s: %s\n", num, where, msg);
 }
 
+/* Devices using fast registration lock their ordinal once their probe has been seen on the bus
+ * for this long without collisions. */
+#define FAST_LOCK_SEC 0.1
+
+/* Admin deadlines, including those of the resource allocation scheme, all follow the current
+ * time source so that they can be compared in mpr_net_get_ms_until_due(). */
+static double _get_admin_time(void)
+{
+    mpr_time now;
+    mpr_time_set(&now, MPR_NOW);
+    return mpr_time_as_dbl(now);
+}
+
 /* Functions for handling the resource allocation scheme.  If check_collisions()
  * returns 1, the resource in question should be probed on the libmapper bus. */
 static int check_collisions(mpr_net net, mpr_allocated resource);
@@ -386,6 +415,9 @@ void mpr_net_add_graph_methods(mpr_net net)
         lo_server_add_method((net)->servers[SERVER_MESH], net_msg_strings[graph_handlers[i].str_idx],
                              graph_handlers[i].types, graph_handlers[i].h, net->graph);
     }
+    /* compressed metadata is only accepted over TCP */
+    lo_server_add_method((net)->servers[SERVER_MESH_TCP], net_msg_strings[MSG_BULK], "ib",
+                         handler_bulk, net->graph);
     return;
 }
 
@@ -409,6 +441,8 @@ void mpr_net_init(mpr_net net, const char *iface, const char *group, int port)
         net->multicast.group = strdup(group ? group : "224.0.1.3");
     if (port || !net->multicast.port)
         net->multicast.port = port ? port : 7570;
+    if (!net->ping_interval)
+        net->ping_interval = PING_INTERVAL;
     snprintf(port_str, 10, "%d", net->multicast.port);
 
     /* Initialize interface information. */
@@ -420,6 +454,7 @@ void mpr_net_init(mpr_net net, const char *iface, const char *group, int port)
     FUNC_IF(lo_address_free, net->addr.bus);
     FUNC_IF(lo_server_free, net->servers[SERVER_BUS]);
     FUNC_IF(lo_server_free, net->servers[SERVER_MESH]);
+    FUNC_IF(lo_server_free, net->servers[SERVER_MESH_TCP]);
 
     /* Open address */
     net->addr.bus = lo_address_new(net->multicast.group, s_port);
@@ -450,9 +485,13 @@ void mpr_net_init(mpr_net net, const char *iface, const char *group, int port)
     /* TODO: use TCP instead? */
     while (!(net->servers[SERVER_MESH] = lo_server_new(0, handler_error))) {}
 
+    /* Open TCP server for receiving compressed bulk metadata */
+    while (!(net->servers[SERVER_MESH_TCP] = lo_server_new_with_proto(0, LO_TCP, handler_error))) {}
+
     /* Disable liblo message queueing. */
     lo_server_enable_queue((net)->servers[SERVER_BUS], 0, 1);
     lo_server_enable_queue((net)->servers[SERVER_MESH], 0, 1);
+    lo_server_enable_queue((net)->servers[SERVER_MESH_TCP], 0, 1);
 
     mpr_net_add_graph_methods(net);
 
@@ -465,13 +504,80 @@ const char *mpr_get_version()
     return PACKAGE_VERSION;
 }
 
+/* Serialise the current bundle and send it as a single compressed message. */
+static void send_bulk(mpr_net net)
+{
+    size_t len = lo_bundle_length(net->bundle);
+    uLongf zlen = compressBound(len);
+    void *data = malloc(len), *zdata = malloc(zlen);
+    lo_message msg;
+    lo_blob blob;
+
+    DONE_UNLESS(data && zdata && lo_bundle_serialise(net->bundle, data, &len));
+    if (Z_OK != compress2((Bytef*)zdata, &zlen, (const Bytef*)data, len, Z_BEST_SPEED)) {
+        trace_net("error compressing bulk metadata.\n");
+        goto done;
+    }
+    DONE_UNLESS(blob = lo_blob_new(zlen, zdata));
+    if ((msg = lo_message_new())) {
+        trace_net("sending %d bytes of metadata compressed to %d bytes.\n", (int)len, (int)zlen);
+        lo_message_add_int32(msg, len);
+        lo_message_add_blob(msg, blob);
+        lo_send_message_from(net->addr.dst, net->servers[SERVER_MESH_TCP],
+                             net_msg_strings[MSG_BULK], msg);
+        lo_message_free(msg);
+    }
+    lo_blob_free(blob);
+  done:
+    FUNC_IF(free, data);
+    FUNC_IF(free, zdata);
+}
+
+/* Send the current bundle of map definitions to its destination device as a single message
+ * that will be acknowledged with one /mapped/batch message. */
+static void send_map_batch(mpr_net net)
+{
+    char path[256];
+    size_t len = lo_bundle_length(net->bundle);
+    void *data = malloc(len);
+    lo_message msg;
+    lo_blob blob;
+
+    DONE_UNLESS(data && lo_bundle_serialise(net->bundle, data, &len));
+    DONE_UNLESS(blob = lo_blob_new(len, data));
+    if ((msg = lo_message_new())) {
+        ++net->num_batches;
+        trace_net("sending batch %d of %d map definitions to %s.\n", net->num_batches,
+                  lo_bundle_count(net->bundle), net->addr.batch->name);
+        snprintf(path, 256, net_msg_strings[MSG_MAP_BATCH], net->addr.batch->name);
+        lo_message_add_int32(msg, net->num_batches);
+        lo_message_add_blob(msg, blob);
+        lo_send_message_from(net->addr.bus, net->servers[SERVER_MESH], path, msg);
+        lo_message_free(msg);
+    }
+    lo_blob_free(blob);
+  done:
+    FUNC_IF(free, data);
+}
+
 void mpr_net_send(mpr_net net)
 {
     RETURN_UNLESS(net->bundle);
 
-    if (BUNDLE_DST_SUBSCRIBERS == net->addr.dst) {
+    if (net->bulk) {
+        if (lo_bundle_count(net->bundle))
+            send_bulk(net);
+        net->bulk = 0;
+    }
+    else if (net->addr.batch) {
+        if (lo_bundle_count(net->bundle))
+            send_map_batch(net);
+        net->addr.batch = 0;
+    }
+    else if (BUNDLE_DST_SUBSCRIBERS == net->addr.dst) {
         mpr_subscriber *sub = &net->addr.dev->subscribers;
         mpr_time t;
+        int to_group = 0;
         if (*sub)
             mpr_time_set(&t, MPR_NOW);
         while (*sub) {
@@ -485,13 +591,22 @@ void mpr_net_send(mpr_net net)
                 mpr_subscriber temp = *sub;
                 *sub = temp->next;
                 FUNC_IF(lo_address_free, temp->addr);
+                FUNC_IF(lo_address_free, temp->bulk_addr);
                 free(temp);
                 continue;
             }
-            if ((*sub)->flags & net->msg_type)
-                lo_send_bundle_from((*sub)->addr, net->servers[SERVER_MESH], net->bundle);
+            if ((*sub)->flags & net->msg_type) {
+                if ((*sub)->in_group)
+                    to_group = 1;
+                else
+                    lo_send_bundle_from((*sub)->addr, net->servers[SERVER_MESH], net->bundle);
+            }
             sub = &(*sub)->next;
         }
+        /* subscribers listening on the group share a single send */
+        if (to_group)
+            lo_send_bundle_from(net->addr.dev->sub_group, net->servers[SERVER_MESH], net->bundle);
+        mpr_dev_release_sub_group(net->addr.dev);
     }
     else if (BUNDLE_DST_BUS == net->addr.dst)
         lo_send_bundle_from(net->addr.bus, net->servers[SERVER_MESH], net->bundle);
@@ -513,16 +628,36 @@ static int init_bundle(mpr_net net)
 
 void mpr_net_use_bus(mpr_net net)
 {
-    if (net->bundle && (net->addr.dst != BUNDLE_DST_BUS))
+    if (net->bundle && (net->addr.dst != BUNDLE_DST_BUS || net->addr.batch))
         mpr_net_send(net);
     net->addr.dst = BUNDLE_DST_BUS;
     if (!net->bundle)
         init_bundle(net);
 }
 
+void mpr_net_use_bulk(mpr_net net, lo_address addr)
+{
+    if (net->bundle && (net->addr.dst != addr || !net->bulk || net->addr.batch))
+        mpr_net_send(net);
+    net->addr.dst = addr;
+    net->bulk = 1;
+    if (!net->bundle)
+        init_bundle(net);
+}
+
+int mpr_net_use_batch(mpr_net net, mpr_dev dev)
+{
+    if (net->bundle && net->addr.batch != dev)
+        mpr_net_send(net);
+    net->addr.batch = dev;
+    if (!net->bundle)
+        init_bundle(net);
+    return net->num_batches + 1;
+}
+
 void mpr_net_use_mesh(mpr_net net, lo_address addr)
 {
-    if (net->bundle && (net->addr.dst != addr))
+    if (net->bundle && (net->addr.dst != addr || net->addr.batch))
         mpr_net_send(net);
     net->addr.dst = addr;
     if (!net->bundle)
@@ -533,7 +668,8 @@ void mpr_net_use_subscribers(mpr_net net, mpr_local_dev dev, int type)
 {
     if (net->bundle && (   net->addr.dst != BUNDLE_DST_SUBSCRIBERS
                         || net->addr.dev != dev
-                        || net->msg_type != type))
+                        || net->msg_type != type
+                        || net->addr.batch))
         mpr_net_send(net);
     net->addr.dst = BUNDLE_DST_SUBSCRIBERS;
     net->addr.dev = dev;
@@ -542,18 +678,96 @@ void mpr_net_use_subscribers(mpr_net net, mpr_local_dev dev, int type)
         init_bundle(net);
 }
 
+lo_address mpr_net_new_sub_group(mpr_net net, mpr_id id, char **url)
+{
+    char group[16], port[10];
+    lo_address addr;
+    uint32_t hash = (uint32_t)(id >> 32) ^ (uint32_t)id;
+
+    /* Choose a group in the organization-local scope and a port above the bus
+     * port. Using a distinct port keeps group traffic off the bus server,
+     * which is bound to the wildcard address. */
+    snprintf(group, 16, "239.192.%d.%d", (hash >> 8) & 0xFF, (hash & 0xFF) | 1);
+    snprintf(port, 10, "%d", net->multicast.port + 1 + ((hash >> 16) & 0x3FF));
+    addr = lo_address_new(group, port);
+    RETURN_ARG_UNLESS(addr, 0);
+    lo_address_set_ttl(addr, 1);
+    lo_address_set_iface(addr, net->iface.name, 0);
+    *url = lo_address_get_url(addr);
+    trace_net("allocated subscriber group %s:%s\n", group, port);
+    return addr;
+}
+
+lo_server mpr_net_join_sub_group(mpr_net net, const char *url)
+{
+    lo_server s;
+    char *host = lo_url_get_hostname(url), *port = lo_url_get_port(url);
+    if (host && port) {
+        s = lo_server_new_multicast_iface(host, port, net->iface.name, 0, handler_error);
+        if (s) {
+            lo_server_enable_queue(s, 0, 1);
+            lo_server_add_method(s, NULL, NULL, handler_sub_group, net->graph);
+            trace_net("joined subscriber group %s:%s\n", host, port);
+        }
+    }
+    else
+        s = 0;
+    FUNC_IF(free, host);
+    FUNC_IF(free, port);
+    return s;
+}
+
 void mpr_net_add_msg(mpr_net net, const char *s, net_msg_t c, lo_message m)
 {
     int len = lo_bundle_length(net->bundle);
     if (!s)
         s = net_msg_strings[c];
-    if (len && len + lo_message_length(m, s) >= MAX_BUNDLE_LEN) {
+    if (len && len + lo_message_length(m, s) >= (net->bulk ? MAX_BULK_LEN : MAX_BUNDLE_LEN)) {
+        /* a batch of map definitions or of bulk metadata continues in a new bundle */
+        mpr_dev batch = net->addr.batch;
+        int bulk = net->bulk;
         mpr_net_send(net);
+        net->addr.batch = batch;
+        net->bulk = bulk;
         init_bundle(net);
     }
     lo_bundle_add_message(net->bundle, s, m);
 }
 
+void *mpr_net_resolve_udp(const char *host, int port, int *len)
+{
+    struct addrinfo hints, *info = 0;
+    char str[16];
+    void *addr = 0;
+    RETURN_ARG_UNLESS(host && port, 0);
+    snprintf(str, 16, "%d", port);
+    memset(&hints, 0, sizeof(hints));
+    /* same address family as the sockets opened by liblo */
+    hints.ai_family = PF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(host, str, &hints, &info) || !info) {
+        trace_net("couldn't resolve address %s:%d\n", host, port);
+        return 0;
+    }
+    if ((addr = malloc(info->ai_addrlen))) {
+        memcpy(addr, info->ai_addr, info->ai_addrlen);
+        *len = (int)info->ai_addrlen;
+    }
+    freeaddrinfo(info);
+    return addr;
+}
+
+int mpr_net_send_udp(lo_server from, const void *addr, int addr_len, const void *data, size_t len)
+{
+    int fd = lo_server_get_socket_fd(from);
+    RETURN_ARG_UNLESS(fd >= 0, -1);
+    if (sendto(fd, (const char*)data, len, 0, (const struct sockaddr*)addr, addr_len) < 0) {
+        trace_net("error sending bundle of %d bytes\n", (int)len);
+        return -1;
+    }
+    return 0;
+}
+
 void mpr_net_free_msgs(mpr_net net)
 {
     FUNC_IF(lo_bundle_free_recursive, net->bundle);
@@ -570,20 +784,22 @@ void mpr_net_free(mpr_net net)
     FUNC_IF(free, net->multicast.group);
     FUNC_IF(lo_server_free, net->servers[SERVER_BUS]);
     FUNC_IF(lo_server_free, net->servers[SERVER_MESH]);
+    FUNC_IF(lo_server_free, net->servers[SERVER_MESH_TCP]);
     FUNC_IF(lo_address_free, net->addr.bus);
     FUNC_IF(free, net->addr.url);
     FUNC_IF(free, net->rtr);
 }
 
-/*! Probe the network to see if a device's proposed name.ordinal is available. */
-static void mpr_net_probe_dev_name(mpr_net net, mpr_local_dev dev)
+/*! Prepare to probe the network to see if a device's proposed name.ordinal is available. The
+ *  probe itself is sent by the next call to mpr_net_poll(). */
+void mpr_net_probe_dev_name(mpr_net net, mpr_local_dev dev)
 {
     int i;
     char name[256];
 
     /* reset collisions and hints */
     dev->ordinal_allocator.collision_count = 0;
-    dev->ordinal_allocator.count_time = mpr_get_current_time();
+    dev->ordinal_allocator.count_time = _get_admin_time();
     for (i = 0; i < 8; i++)
         dev->ordinal_allocator.hints[i] = 0;
 
@@ -594,9 +810,36 @@ static void mpr_net_probe_dev_name(mpr_net net, mpr_local_dev dev)
 
     /* Calculate an id from the name and store it in id.val */
     dev->obj.id = (mpr_id) crc32(0L, (const Bytef *)name, strlen(name)) << 32;
+    dev->ordinal_allocator.probe = 1;
+}
+
+/*! Send the pending name probes of all devices in a single bundle. */
+static void _send_probes(mpr_net net)
+{
+    int i;
+    char name[256];
+    lo_bundle bun = 0;
+
+    for (i = 0; i < net->num_devs; i++) {
+        mpr_local_dev dev = net->devs[i];
+        lo_message msg;
+        if (!dev->ordinal_allocator.probe || dev->ordinal_allocator.locked)
+            continue;
+        dev->ordinal_allocator.probe = 0;
+        if (!bun && !(bun = lo_bundle_new(MPR_NOW)))
+            return;
+        if (!(msg = lo_message_new()))
+            continue;
+        snprintf(name, 256, "%s.%d", dev->prefix, dev->ordinal_allocator.val);
+        lo_message_add_string(msg, name);
+        lo_message_add_int32(msg, net->random_id);
+        lo_bundle_add_message(bun, net_msg_strings[MSG_NAME_PROBE], msg);
+    }
+    RETURN_UNLESS(bun);
 
-    /* For the same reason, we can't use mpr_net_send() here. */
-    lo_send(net->addr.bus, net_msg_strings[MSG_NAME_PROBE], "si", name, net->random_id);
+    /* The device names are not yet registered, so we can't use mpr_net_send() here. */
+    lo_send_bundle_from(net->addr.bus, net->servers[SERVER_MESH], bun);
+    lo_bundle_free_recursive(bun);
 }
 
 /*! Add an uninitialized device to this network. */
@@ -652,12 +895,14 @@ static void _send_device_sync(mpr_net net, mpr_local_dev dev)
     mpr_net_add_msg(net, 0, MSG_SYNC, msg);
 }
 
+static void _check_links(mpr_net net, mpr_time now);
+static void _send_link_pings(mpr_net net, mpr_time now);
+
 /* TODO: rename to mpr_dev...? */
 static void mpr_net_maybe_send_ping(mpr_net net, int force)
 {
     int i;
     mpr_graph gph = net->graph;
-    mpr_list list;
     mpr_time now;
     mpr_time_set(&now, MPR_NOW);
     if (now.sec > net->next_sub_ping) {
@@ -673,9 +918,17 @@ static void mpr_net_maybe_send_ping(mpr_net net, int force)
                 mpr_net_use_subscribers(net, dev, MPR_DEV);
                 _send_device_sync(net, dev);
             }
+            /* publish runtime statistics, if enabled */
+            mpr_dev_send_stats(dev);
         }
     }
     RETURN_UNLESS(net->num_devs);
+    if (mpr_time_as_dbl(now) >= net->next_link_ping) {
+        /* vary the interval so that pings from both ends of a link do not stay in phase */
+        net->next_link_ping = (mpr_time_as_dbl(now)
+                               + net->ping_interval * (0.75 + 0.5 * rand() / RAND_MAX));
+        _send_link_pings(net, now);
+    }
     if (!force && (now.sec < net->next_bus_ping))
         return;
     net->next_bus_ping = now.sec + 5 + (rand() % 4);
@@ -687,7 +940,14 @@ static void mpr_net_maybe_send_ping(mpr_net net, int force)
     }
 
     /* housekeeping #2: periodically check if our links are still active */
-    list = mpr_list_from_data(gph->links);
+    _check_links(net, now);
+}
+
+/* Remove links to devices that have stopped responding to pings. */
+static void _check_links(mpr_net net, mpr_time now)
+{
+    mpr_graph gph = net->graph;
+    mpr_list list = mpr_list_from_data(gph->links);
     while (list) {
         int num_maps;
         mpr_sync_clock clk;
@@ -722,8 +982,24 @@ static void mpr_net_maybe_send_ping(mpr_net net, int force)
                 continue;
             }
         }
+    }
+}
+
+/* Send clock synchronization pings to linked devices. */
+static void _send_link_pings(mpr_net net, mpr_time now)
+{
+    mpr_list list = mpr_list_from_data(net->graph->links);
+    while (list) {
+        int num_maps;
+        mpr_sync_clock clk;
+        double elapsed;
+        mpr_link lnk = (mpr_link)*list;
+        list = mpr_list_get_next(list);
         if (lnk->is_local_only)
             continue;
+        num_maps = lnk->num_maps[0] + lnk->num_maps[1];
+        clk = &lnk->clock;
+        elapsed = (clk->rcvd.time.sec ? mpr_time_get_diff(now, clk->rcvd.time) : 0);
         if (num_maps && mpr_obj_get_prop_as_str(&lnk->devs[REMOTE_DEV]->obj, MPR_PROP_HOST, 0)) {
             /* Only send pings if this link has associated maps, ensuring empty
              * links are removed after the ping timeout. */
@@ -746,6 +1022,47 @@ static void mpr_net_maybe_send_ping(mpr_net net, int force)
 
 /*! This is the main function to be called once in a while from a program so
  *  that the libmapper bus can be automatically managed. */
+int mpr_net_get_ms_until_due(mpr_net net)
+{
+    int i;
+    double diff, min_diff;
+    uint32_t due = net->next_sub_ping + 1;
+    mpr_graph g = net->graph;
+    mpr_time now;
+
+    if (net->num_devs && net->next_bus_ping < due)
+        due = net->next_bus_ping;
+    if (g->deadlines.len && g->deadlines.entries[0].sec < due)
+        due = g->deadlines.entries[0].sec;
+    mpr_time_set(&now, MPR_NOW);
+    min_diff = (double)due - mpr_time_as_dbl(now);
+    if (net->num_devs && net->next_link_ping - mpr_time_as_dbl(now) < min_diff)
+        min_diff = net->next_link_ping - mpr_time_as_dbl(now);
+
+    /* devices negotiating their ordinal need attention at the next point at
+     * which check_collisions() could act */
+    for (i = 0; i < net->num_devs; i++) {
+        mpr_allocated a = &net->devs[i]->ordinal_allocator;
+        if (net->devs[i]->registered)
+            continue;
+        if (a->locked || a->probe) {
+            /* registration or probing is completed by the next call to mpr_net_poll() */
+            return 0;
+        }
+        diff = a->count_time - mpr_time_as_dbl(now);
+        if (!a->online)
+            diff += 5.0;
+        else
+            diff += a->collision_count > 1 ? 0.5 : (a->fast ? FAST_LOCK_SEC : 2.0);
+        if (diff < min_diff)
+            min_diff = diff;
+    }
+    /* a far-off deadline would overflow the conversion, so cap it */
+    if (min_diff > INT_MAX / 1000 - 1)
+        min_diff = INT_MAX / 1000 - 1;
+    return min_diff > 0 ? (int)(min_diff * 1000) + 1 : 0;
+}
+
 void mpr_net_poll(mpr_net net)
 {
     int i, registered = 0;
@@ -753,6 +1070,9 @@ void mpr_net_poll(mpr_net net)
     /* send out any cached messages */
     mpr_net_send(net);
 
+    /* receive metadata from devices that publish to a subscriber group */
+    mpr_graph_recv_sub_groups(net->graph);
+
     if (!net->num_devs) {
         mpr_net_maybe_send_ping(net, 0);
         return;
@@ -788,6 +1108,7 @@ void mpr_net_poll(mpr_net net)
         else
             ++registered;
     }
+    _send_probes(net);
     if (registered) {
         /* Send out clock sync messages occasionally */
         mpr_net_maybe_send_ping(net, 0);
@@ -801,7 +1122,7 @@ static int check_collisions(mpr_net net, mpr_allocated resource)
     int i;
     double current_time, timediff;
     RETURN_ARG_UNLESS(!resource->locked, 0);
-    current_time = mpr_get_current_time();
+    current_time = _get_admin_time();
     timediff = current_time - resource->count_time;
 
     if (!resource->online) {
@@ -812,7 +1133,8 @@ static int check_collisions(mpr_net net, mpr_allocated resource)
         }
         return 0;
     }
-    else if (timediff >= 2.0 && resource->collision_count < 2) {
+    else if (timediff >= (resource->fast ? FAST_LOCK_SEC : 2.0) && resource->collision_count < 2) {
+        /* Our own probe counts as one collision. */
         resource->locked = 1;
         if (resource->on_lock)
             resource->on_lock(resource);
@@ -881,6 +1203,14 @@ static int handler_dev(const char *path, const char *types, lo_arg **av, int ac,
         remote = mpr_graph_add_dev(graph, name, props);
         if (!remote->subscribed && graph->autosub)
             mpr_graph_subscribe(graph, remote, graph->autosub, -1);
+        if (remote->subscribed) {
+            /* switch to the device's multicast group if it advertises one */
+            mpr_type type;
+            const void *val;
+            if (mpr_obj_get_prop_by_key((mpr_obj)remote, "group", 0, &type, &val, 0)
+                && MPR_STR == type)
+                mpr_graph_join_sub_group(graph, remote, (const char*)val);
+        }
     }
     if (!net->devs)
         goto done;
@@ -1081,7 +1411,7 @@ static int handler_subscribe(const char *path, const char *types, lo_arg **av,
                              int ac, lo_message msg, void *user)
 {
     mpr_local_dev dev = (mpr_local_dev)user;
-    int i, version = -1, flags = 0, timeout_seconds = -1;
+    int i, version = -1, flags = 0, timeout_seconds = -1, bulk_port = 0, in_group = 0;
 
 #ifdef DEBUG
     trace_dev(dev, "received /subscribe ");
@@ -1129,10 +1459,22 @@ static int handler_subscribe(const char *path, const char *types, lo_arg **av,
                 {trace_dev(dev, "error parsing subscription lease prop.\n");}
             timeout_seconds = timeout_seconds >= 0 ? timeout_seconds : 0;
         }
+        else if (0 == strcmp(&av[i]->s, "@bulk")) {
+            /* next argument is the subscriber's TCP port for compressed metadata */
+            ++i;
+            if (i < ac && MPR_INT32 == types[i])
+                bulk_port = av[i]->i;
+        }
+        else if (0 == strcmp(&av[i]->s, "@group")) {
+            /* next argument is 1 if the subscriber has joined our group */
+            ++i;
+            if (i < ac && MPR_INT32 == types[i])
+                in_group = av[i]->i;
+        }
     }
 
     /* add or renew subscription */
-    mpr_dev_manage_subscriber(dev, addr, flags, timeout_seconds, version);
+    mpr_dev_manage_subscriber(dev, addr, flags, timeout_seconds, version, bulk_port, in_group);
     return 0;
 }
 
@@ -1168,33 +1510,25 @@ static int handler_sig(const char *path, const char *types, lo_arg **av, int ac,
     return 0;
 }
 
-/* Helper function to check if the prefix matches.  Like strcmp(), returns 0 if
- * they match (up to the first '/'), non-0 otherwise.  Also optionally returns a
- * pointer to the remainder of str1 after the prefix. */
-static int prefix_cmp(const char *str1, const char *str2, const char **rest)
+/* Helper function to find the interned device name prefixing a full signal
+ * name (up to the first '/'). Since device names are interned this returns
+ * zero if no device by that name exists, and otherwise can be compared to
+ * device names by pointer.  Also optionally returns a pointer to the remainder
+ * of the full name after the prefix. */
+static const char *find_dev_name(const char *full_name, const char **rest)
 {
-    const char *s1, *s2;
-    int n1, n2, result;
+    const char *s;
 
     /* skip first slash */
-    str1 += ('/' == str1[0]);
-    str2 += ('/' == str2[0]);
-
-    s1 = str1;
-    s2 = str2;
-
-    while (*s1 && (*s1)!='/') ++s1;
-    while (*s2 && (*s2)!='/') ++s2;
+    full_name += ('/' == full_name[0]);
 
-    n1 = s1 - str1;
-    n2 = s2 - str2;
-    if (n1!=n2) return 1;
+    s = full_name;
+    while (*s && (*s)!='/') ++s;
+    RETURN_ARG_UNLESS(*s, 0);
 
-    result = strncmp(str1, str2, n1);
-    if (!result && rest)
-        *rest = s1+1;
-
-    return result;
+    if (rest)
+        *rest = s+1;
+    return mpr_str_find_len(full_name, s - full_name);
 }
 
 /*! Handle remote requests to add, modify, or remove metadata to a signal. */
@@ -1227,7 +1561,53 @@ static int handler_sig_mod(const char *path, const char *types, lo_arg **av,
     return 0;
 }
 
+/*! Unpack compressed device metadata and dispatch the contained messages. */
+static int handler_bulk(const char *path, const char *types, lo_arg **av, int ac,
+                        lo_message msg, void *user)
+{
+    mpr_graph graph = (mpr_graph)user;
+    lo_blob blob = (lo_blob)av[1];
+    uLongf len;
+    void *data;
+    RETURN_ARG_UNLESS(av[0]->i > 0 && av[0]->i <= MAX_BULK_LEN, 0);
+    RETURN_ARG_UNLESS(av[0]->i / MAX_BULK_RATIO <= lo_blob_datasize(blob), 0);
+    len = av[0]->i;
+    TRACE_NET_RETURN_UNLESS((data = malloc(len)), 0, "couldn't allocate bulk metadata buffer.\n");
+    if (Z_OK == uncompress((Bytef*)data, &len, (const Bytef*)lo_blob_dataptr(blob),
+                           lo_blob_datasize(blob))) {
+        trace_net("received %d bytes of compressed metadata.\n", (int)len);
+        /* the contents are a bundle of ordinary metadata messages */
+        lo_server_dispatch_data(graph->net.servers[SERVER_MESH], data, len);
+    }
+    else
+        {trace_net("error decompressing bulk metadata.\n");}
+    free(data);
+    return 0;
+}
+
 /*! Unregister information about a removed signal. */
+/* Devices whose ids hash alike share a subscriber group, so messages received on a group are
+ * only dispatched if their leading names refer to a device we joined the group for. */
+static int handler_sub_group(const char *path, const char *types, lo_arg **av, int ac,
+                             lo_message msg, void *user)
+{
+    mpr_graph gph = (mpr_graph)user;
+    int i;
+    for (i = 0; i < ac && MPR_STR == types[i] && '@' != (&av[i]->s)[0]; i++) {
+        if (!mpr_graph_get_is_grouped(gph, &av[i]->s))
+            continue;
+        for (i = 0; i < NUM_GRAPH_HANDLERS; i++) {
+            struct handler_method_assoc *h = &graph_handlers[i];
+            if (   !strcmp(path, net_msg_strings[h->str_idx])
+                && (!h->types || !strcmp(types, h->types)))
+                return h->h(path, types, av, ac, msg, user);
+        }
+        return 0;
+    }
+    trace_net("ignoring %s for an unsubscribed device on subscriber group\n", path);
+    return 0;
+}
+
 static int handler_sig_removed(const char *path, const char *types, lo_arg **av,
                                int ac, lo_message msg, void *user)
 {
@@ -1307,7 +1687,7 @@ static int _handler_name(const char *path, const char *types, lo_arg **av,
                 /* if suggested id is within my block, store timestamp */
                 diff = hint - dev->ordinal_allocator.val - 1;
                 if (diff >= 0 && diff < 8)
-                    dev->ordinal_allocator.hints[diff] = mpr_get_current_time();
+                    dev->ordinal_allocator.hints[diff] = _get_admin_time();
             }
         }
     }
@@ -1317,7 +1697,7 @@ static int _handler_name(const char *path, const char *types, lo_arg **av,
             if (temp_id < net->random_id) {
                 /* Count ordinal collisions. */
                 ++dev->ordinal_allocator.collision_count;
-                dev->ordinal_allocator.count_time = mpr_get_current_time();
+                dev->ordinal_allocator.count_time = _get_admin_time();
             }
             else if (temp_id == net->random_id && hint > 0 && hint != dev->ordinal_allocator.val) {
                 dev->ordinal_allocator.val = hint;
@@ -1336,7 +1716,7 @@ static int _handler_name_probe(mpr_net net, mpr_local_dev dev, char *name, int t
         return 0;
 
     trace_dev(dev, "name probe match %s %i \n", name, temp_id);
-    current_time = mpr_get_current_time();
+    current_time = _get_admin_time();
     if (dev->ordinal_allocator.locked || temp_id > net->random_id) {
         for (i = 0; i < 8; i++) {
             if (dev->ordinal_allocator.hints[i] >= 0
@@ -1511,11 +1891,12 @@ static mpr_map find_map(mpr_net net, const char *types, int ac, lo_arg **av, mpr
 
     if (MPR_LOC_DST & loc) {
         /* check if we are the destination */
-        for (i = 0; i < net->num_devs; i++) {
+        const char *dev_name = find_dev_name(dst_name, &sig_name);
+        for (i = 0; dev_name && i < net->num_devs; i++) {
             mpr_local_dev dev = net->devs[i];
             if (!dev->registered)
                 continue;
-            if (   !prefix_cmp(&av[dst_idx]->s, mpr_dev_get_name((mpr_dev)dev), &sig_name)
+            if (   dev_name == mpr_dev_get_name((mpr_dev)dev)
                 && (sig = mpr_dev_get_sig_by_name((mpr_dev)dev, sig_name))) {
                 is_loc = 1;
                 break;
@@ -1527,11 +1908,12 @@ static mpr_map find_map(mpr_net net, const char *types, int ac, lo_arg **av, mpr
         /* check if we are a source – all sources must match! */
         for (i = 0; i < num_src; i++) {
             int j;
-            for (j = 0; j < net->num_devs; j++) {
+            const char *dev_name = find_dev_name(src_names[i], &sig_name);
+            for (j = 0; dev_name && j < net->num_devs; j++) {
                 mpr_local_dev dev = net->devs[j];
                 if (!dev->registered)
                     continue;
-                if (   !prefix_cmp(src_names[i], mpr_dev_get_name((mpr_dev)dev), &sig_name)
+                if (   dev_name == mpr_dev_get_name((mpr_dev)dev)
                     && (sig = mpr_dev_get_sig_by_name((mpr_dev)dev, sig_name))) {
                     is_loc = 1;
                     break;
@@ -1586,6 +1968,7 @@ void mpr_net_handle_map(mpr_net net, mpr_local_map map, mpr_msg props)
             mpr_sig_send_state(map->dst->sig, MSG_SIG);
 
             trace_dev(dev, "informing subscribers (MAPPED)\n")
+            mpr_dev_record_change(dev, 1, 0);
             mpr_net_use_subscribers(net, dev, MPR_MAP);
             mpr_map_send_state((mpr_map)map, -1, MSG_MAPPED);
         }
@@ -1609,6 +1992,14 @@ void mpr_net_handle_map(mpr_net net, mpr_local_map map, mpr_msg props)
 }
 
 
+/* Record the outcome of a /map message if it is part of a batch. */
+MPR_INLINE static void _ack_map(mpr_net net, mpr_id id, int status)
+{
+    RETURN_UNLESS(net->batch_ack);
+    lo_message_add_int64(net->batch_ack, id);
+    lo_message_add_int32(net->batch_ack, status);
+}
+
 /*! When the /map message is received by the destination device, send a /mapTo
  *  message to the source device.
  */
@@ -1622,7 +2013,10 @@ static int handler_map(const char *path, const char *types, lo_arg **av, int ac,
 
     RETURN_ARG_UNLESS(net->num_devs, 0);
     map = (mpr_local_map)find_map(net, types, ac, av, MPR_LOC_DST, ADD | UPDATE);
-    RETURN_ARG_UNLESS(map && MPR_MAP_ERROR != (mpr_map)map, 0);
+    if (!map || MPR_MAP_ERROR == (mpr_map)map) {
+        _ack_map(net, 0, MPR_STATUS_EXPIRED);
+        return 0;
+    }
 
 #ifdef DEBUG
     trace_dev(map->dst->sig->dev, "received /map ");
@@ -1632,11 +2026,77 @@ static int handler_map(const char *path, const char *types, lo_arg **av, int ac,
     if (map->status >= MPR_STATUS_ACTIVE) {
         /* Forward to handler_map_mod() and stop. */
         handler_map_mod(path, types, av, ac, msg, user);
-        return 0;
     }
-    props = mpr_msg_parse_props(ac, types, av);
-    mpr_net_handle_map(net, map, props);
-    mpr_msg_free(props);
+    else {
+        props = mpr_msg_parse_props(ac, types, av);
+        mpr_net_handle_map(net, map, props);
+        mpr_msg_free(props);
+    }
+    _ack_map(net, map->obj.id, map->status);
+    return 0;
+}
+
+/*! Handle a batch of /map messages addressed to one device and acknowledge them together. */
+static int handler_map_batch(const char *path, const char *types, lo_arg **av, int ac,
+                             lo_message msg, void *user)
+{
+    mpr_local_dev dev = (mpr_local_dev)user;
+    mpr_net net = &dev->obj.graph->net;
+    lo_address addr = lo_message_get_source(msg);
+    lo_blob blob = (lo_blob)av[1];
+    TRACE_DEV_RETURN_UNLESS(addr && !net->batch_ack, 0, "error handling map batch.\n");
+
+    trace_dev(dev, "received /map/batch %d\n", av[0]->i);
+
+    NEW_LO_MSG(ack, return 0);
+    lo_message_add_int32(ack, av[0]->i);
+
+    /* the batch is a bundle of ordinary /map messages */
+    net->batch_ack = ack;
+    lo_server_dispatch_data(net->servers[SERVER_MESH], lo_blob_dataptr(blob),
+                            lo_blob_datasize(blob));
+    net->batch_ack = 0;
+
+    lo_send_message_from(addr, net->servers[SERVER_MESH], net_msg_strings[MSG_MAPPED_BATCH], ack);
+    lo_message_free(ack);
+    return 0;
+}
+
+/*! Apply the acknowledgement of a batch of map definitions to the maps it contained. Each
+ *  entry holds the id assigned to a map by its destination device and its status. */
+static int handler_mapped_batch(const char *path, const char *types, lo_arg **av, int ac,
+                                lo_message msg, void *user)
+{
+    mpr_graph gph = (mpr_graph)user;
+    mpr_list maps;
+    int i, num;
+
+    RETURN_ARG_UNLESS(ac && MPR_INT32 == types[0] && av[0]->i > 0, 0);
+    num = (ac - 1) / 2;
+    trace_graph("received /mapped/batch %d with %d maps\n", av[0]->i, num);
+
+    maps = mpr_list_from_data(gph->maps);
+    while (maps) {
+        mpr_map map = (mpr_map)*maps;
+        maps = mpr_list_get_next(maps);
+        if (map->batch != av[0]->i || map->batch_idx >= num)
+            continue;
+        i = 1 + map->batch_idx * 2;
+        if (MPR_INT64 != types[i] || MPR_INT32 != types[i + 1])
+            continue;
+        map->batch = 0;
+        if (MPR_STATUS_EXPIRED == av[i + 1]->i) {
+            trace_graph("map %d in batch %d was rejected\n", map->batch_idx, av[0]->i);
+            map->status = MPR_STATUS_EXPIRED;
+        }
+        else {
+            if (!map->obj.id)
+                map->obj.id = av[i]->i64;
+            if (map->status < av[i + 1]->i)
+                map->status = av[i + 1]->i;
+        }
+        mpr_graph_call_cbs(gph, (mpr_obj)map, MPR_MAP, MPR_OBJ_MOD);
+    }
     return 0;
 }
 
@@ -1779,6 +2239,7 @@ static int handler_mapped(const char *path, const char *types, lo_arg **av,
             for (i = 0; i < map->num_src; i++) {
                 if (map->src[i]->sig->is_local) {
                     mpr_local_dev dev = (mpr_local_dev)map->src[i]->sig->dev;
+                    mpr_dev_record_change(dev, 1, 0);
                     if (dev->subscribers) {
                         trace_dev(dev, "informing subscribers (MAPPED)\n")
                         mpr_net_use_subscribers(net, dev, MPR_MAP_OUT);
@@ -1788,6 +2249,7 @@ static int handler_mapped(const char *path, const char *types, lo_arg **av,
             }
             if (map->dst->sig->is_local) {
                 mpr_local_dev dev = (mpr_local_dev)map->dst->sig->dev;
+                mpr_dev_record_change(dev, 1, 0);
                 if (dev->subscribers) {
                     trace_dev(dev, "informing subscribers (MAPPED)\n")
                     mpr_net_use_subscribers(net, dev, MPR_MAP_IN);
@@ -1944,6 +2406,7 @@ static int handler_unmap(const char *path, const char *types, lo_arg **av,
             mpr_sig_send_state(map->src[i]->sig, MSG_SIG);
 
             trace_dev(dev, "informing subscribers (UNMAPPED)\n")
+            mpr_dev_record_change(dev, 1, 1);
             mpr_net_use_subscribers(net, dev, MPR_MAP_OUT);
             mpr_map_send_state((mpr_map)map, -1, MSG_UNMAPPED);
         }
@@ -1957,6 +2420,7 @@ static int handler_unmap(const char *path, const char *types, lo_arg **av,
         mpr_sig_send_state(map->dst->sig, MSG_SIG);
 
         trace_dev(dev, "informing subscribers (UNMAPPED)\n")
+        mpr_dev_record_change(dev, 1, 1);
         mpr_net_use_subscribers(net, dev, MPR_MAP_IN);
         mpr_map_send_state((mpr_map)map, -1, MSG_UNMAPPED);
     }
@@ -2008,36 +2472,10 @@ static int handler_ping(const char *path, const char *types, lo_arg **av,
         clk = &lnk->clock;
         trace_dev(dev, "ping received from device '%s'\n", lnk->devs[REMOTE_DEV]->name);
         if (av[2]->i == clk->sent.msg_id) {
-            /* total elapsed time since ping sent */
-            double elapsed = mpr_time_get_diff(now, clk->sent.time);
-            /* assume symmetrical latency */
-            double latency = (elapsed - av[3]->d) * 0.5;
-            /* difference between remote and local clocks (latency compensated) */
-            double offset = mpr_time_get_diff(now, then) - latency;
-
-            if (latency < 0) {
-                trace_dev(dev, "error: latency %f cannot be < 0.\n", latency);
-                latency = 0;
-            }
-
-            if (1 == clk->new) {
-                clk->offset = offset;
-                clk->latency = latency;
-                clk->jitter = 0;
-                clk->new = 0;
-            }
-            else {
-                clk->jitter = (clk->jitter * 0.9 + fabs(clk->latency - latency) * 0.1);
-                if (offset > clk->offset) {
-                    /* remote time is in the future */
-                    clk->offset = offset;
-                }
-                else if (   latency < clk->latency + clk->jitter
-                         && latency > clk->latency - clk->jitter) {
-                    clk->offset = clk->offset * 0.9 + offset * 0.1;
-                    clk->latency = clk->latency * 0.9 + latency * 0.1;
-                }
-            }
+            /* reply to our last ping, av[3] is the time it was held by the remote device */
+            mpr_sync_clock_add_sample(clk, clk->sent.time, now, then, av[3]->d);
+            trace_dev(dev, "clock offset %f, latency %f, jitter %f, rate %g\n",
+                      clk->offset, clk->latency, clk->jitter, clk->rate);
         }
 
         /* update sync status */
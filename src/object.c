@@ -18,9 +18,25 @@ mpr_type mpr_obj_get_type(mpr_obj o)
 
 void mpr_obj_increment_version(mpr_obj o)
 {
-    RETURN_UNLESS(o && o->props.staged);
-    ++o->version;
-    o->props.synced->dirty = 1;
+    mpr_dev dev;
+    RETURN_UNLESS(o);
+    if (o->props.staged) {
+        ++o->version;
+        o->props.synced->dirty = 1;
+        return;
+    }
+    /* Local devices and signals share a single revision counter belonging to
+     * the device, so that a subscriber can ask for the changes made after the
+     * last revision it has recorded. */
+    if (MPR_DEV == o->type)
+        dev = (mpr_dev)o;
+    else if (MPR_SIG == o->type)
+        dev = ((mpr_sig)o)->dev;
+    else
+        return;
+    o->version = ++dev->obj.version;
+    mpr_tbl_stamp(o->props.synced, o->version);
+    dev->obj.props.synced->dirty = 1;
 }
 
 int mpr_obj_get_num_props(mpr_obj o, int staged)
@@ -183,8 +199,13 @@ int mpr_obj_remove_prop(mpr_obj o, mpr_prop p, const char *s)
         updated = mpr_tbl_set(o->props.staged, p | PROP_REMOVE, s, 0, 0, 0, REMOTE_MODIFY);
     else
         trace("Cannot remove static property [%d] '%s'\n", p, s ? s : mpr_prop_as_str(p, 1));
-    if (updated)
+    if (updated) {
         mpr_obj_increment_version(o);
+        if (local && MPR_DEV == o->type && ((mpr_dev)o)->is_local)
+            mpr_dev_record_change((mpr_local_dev)o, 0, 1);
+        else if (local && MPR_SIG == o->type && ((mpr_sig)o)->is_local)
+            mpr_dev_record_change((mpr_local_dev)((mpr_sig)o)->dev, 0, 1);
+    }
     return updated ? 1 : 0;
 }
 
@@ -0,0 +1,632 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef _MSC_VER
+#include <windows.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "config.h"
+#include "mapper_internal.h"
+
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+#define MUTEX_T             pthread_mutex_t
+#define MUTEX_INIT(m)       pthread_mutex_init(&(m), NULL)
+#define MUTEX_FREE(m)       pthread_mutex_destroy(&(m))
+#define MUTEX_LOCK(m)       pthread_mutex_lock(&(m))
+#define MUTEX_UNLOCK(m)     pthread_mutex_unlock(&(m))
+#define COND_T              pthread_cond_t
+#define COND_INIT(c)        pthread_cond_init(&(c), NULL)
+#define COND_FREE(c)        pthread_cond_destroy(&(c))
+#define COND_WAIT(c, m)     pthread_cond_wait(&(c), &(m))
+#define COND_SIGNAL(c)      pthread_cond_signal(&(c))
+#define COND_BROADCAST(c)   pthread_cond_broadcast(&(c))
+#define IS_CURRENT(w)       pthread_equal(pthread_self(), (w)->thread)
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+#else
+#ifdef HAVE_WIN32_THREADS
+#define MUTEX_T             SRWLOCK
+#define MUTEX_INIT(m)       InitializeSRWLock(&(m))
+#define MUTEX_FREE(m)
+#define MUTEX_LOCK(m)       AcquireSRWLockExclusive(&(m))
+#define MUTEX_UNLOCK(m)     ReleaseSRWLockExclusive(&(m))
+#define COND_T              CONDITION_VARIABLE
+#define COND_INIT(c)        InitializeConditionVariable(&(c))
+#define COND_FREE(c)
+#define COND_WAIT(c, m)     SleepConditionVariableSRW(&(c), &(m), INFINITE, 0)
+#define COND_SIGNAL(c)      WakeConditionVariable(&(c))
+#define COND_BROADCAST(c)   WakeAllConditionVariable(&(c))
+#define IS_CURRENT(w)       (GetCurrentThreadId() == (w)->thread_id)
+static SRWLOCK pool_lock = SRWLOCK_INIT;
+#endif /* HAVE_WIN32_THREADS */
+#endif /* HAVE_LIBPTHREAD */
+
+/*   Shared pool of polling threads. When enabled with mpr_set_poll_threads(),
+ * mpr_dev_start_polling() assigns the device to one of a fixed number of
+ * workers instead of starting a thread for it. A device stays with the same
+ * worker until it is stopped, so it is still only ever polled by one thread,
+ * and devices sharing a graph (and therefore its admin sockets) are always
+ * placed on the same worker. Each worker is pinned to a CPU where supported
+ * and sleeps in a reactor watching the sockets of all of its devices.
+ *   Devices are dispatched without holding the worker lock, so that handlers
+ * may free or stop polling devices. Removing a device from another thread
+ * waits until the worker has finished dispatching it. */
+
+#if defined(HAVE_LIBPTHREAD) || defined(HAVE_WIN32_THREADS)
+
+/* Longest sleep for workers without an event loop. */
+#define FALLBACK_SLEEP_MS 10
+
+/* Upper bound on the sleep between calls to mpr_dev_on_readable(). */
+#define MAX_WAIT_MS 1000
+
+typedef struct _mpr_pool_worker {
+    mpr_local_dev *devs;
+    int num_devs;
+    int size;
+    mpr_local_dev busy;             /*!< Device currently being dispatched. */
+    mpr_reactor reactor;
+    MUTEX_T lock;
+    COND_T idle;
+#ifdef HAVE_LIBPTHREAD
+    pthread_t thread;
+#else
+    HANDLE thread;
+    unsigned int thread_id;
+#endif
+    int cpu;
+    int idx;
+    int is_detached;                /*!< Set if the worker must free itself on exit. */
+    volatile int is_active;
+} mpr_pool_worker_t, *mpr_pool_worker;
+
+static mpr_pool_worker workers = 0;
+static int num_workers = 0;
+static int num_threads = 0;
+static int num_pooled = 0;
+static int num_removing = 0;
+
+static void _sleep_ms(int ms)
+{
+#ifdef _MSC_VER
+    Sleep(ms);
+#else
+    usleep(ms * 1000);
+#endif
+}
+
+static void _run_worker(mpr_pool_worker w)
+{
+    lo_server *servers = 0;
+    int i, j, k, timeout, num_servers, size = 0;
+
+    while (w->is_active) {
+        MUTEX_LOCK(w->lock);
+
+        /* collect the sockets of all devices, skipping servers shared through a graph */
+        if (w->reactor) {
+            if (size < w->num_devs * 5) {
+                lo_server *tmp = realloc(servers, w->num_devs * 5 * sizeof(lo_server));
+                if (tmp) {
+                    servers = tmp;
+                    size = w->num_devs * 5;
+                }
+            }
+            num_servers = 0;
+            for (i = 0; i < w->num_devs && (num_servers + 5) <= size; i++) {
+                lo_server s[5];
+                int n = mpr_dev_get_servers(w->devs[i], s);
+                for (j = 0; j < n; j++) {
+                    for (k = 0; k < num_servers; k++) {
+                        if (servers[k] == s[j])
+                            break;
+                    }
+                    if (k == num_servers)
+                        servers[num_servers++] = s[j];
+                }
+            }
+            mpr_reactor_set_servers(w->reactor, servers, num_servers);
+        }
+
+        timeout = MAX_WAIT_MS;
+        for (i = 0; i < w->num_devs; i++) {
+            int t = mpr_dev_get_timeout((mpr_dev)w->devs[i]);
+            if (t < timeout)
+                timeout = t;
+        }
+        MUTEX_UNLOCK(w->lock);
+
+        if (w->reactor)
+            mpr_reactor_wait(w->reactor, timeout);
+        else if (timeout > 0)
+            _sleep_ms(timeout < FALLBACK_SLEEP_MS ? timeout : FALLBACK_SLEEP_MS);
+
+        /* A device removed while another is dispatched may move a device into an index that
+         * has already been visited; it is then skipped until the next iteration. */
+        MUTEX_LOCK(w->lock);
+        for (i = 0; i < w->num_devs; i++) {
+            mpr_local_dev dev = w->busy = w->devs[i];
+            MUTEX_UNLOCK(w->lock);
+            mpr_dev_on_readable((mpr_dev)dev);
+            MUTEX_LOCK(w->lock);
+            w->busy = 0;
+            COND_BROADCAST(w->idle);
+        }
+        MUTEX_UNLOCK(w->lock);
+    }
+    FUNC_IF(free, servers);
+
+    if (w->is_detached) {
+        /* the pool was shut down from this thread, which could not join itself */
+        FUNC_IF(mpr_reactor_free, w->reactor);
+        FUNC_IF(free, w->devs);
+        COND_FREE(w->idle);
+        MUTEX_FREE(w->lock);
+        free(w - w->idx);
+    }
+}
+
+#ifdef HAVE_LIBPTHREAD
+static void *worker_thread_func(void *data)
+{
+    _run_worker((mpr_pool_worker)data);
+    pthread_exit(NULL);
+    return 0;
+}
+#else
+static unsigned __stdcall worker_thread_func(void *data)
+{
+    _run_worker((mpr_pool_worker)data);
+    _endthread();
+    return 0;
+}
+#endif
+
+static int _num_cpus(void)
+{
+#ifdef _MSC_VER
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+static void _set_affinity(mpr_pool_worker w)
+{
+#if defined(HAVE_LIBPTHREAD) && defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(w->cpu, &set);
+    if (pthread_setaffinity_np(w->thread, sizeof(set), &set))
+        trace("could not pin polling thread to cpu %d\n", w->cpu);
+#else
+#ifdef HAVE_WIN32_THREADS
+    if (w->cpu < (int)(sizeof(DWORD_PTR) * 8))
+        SetThreadAffinityMask(w->thread, (DWORD_PTR)1 << w->cpu);
+#endif
+#endif
+}
+
+static void _stop_workers(void)
+{
+    int i;
+    mpr_pool_worker self = 0;
+    for (i = 0; i < num_workers; i++) {
+        workers[i].is_active = 0;
+        mpr_reactor_wake(workers[i].reactor);
+    }
+    for (i = 0; i < num_workers; i++) {
+        mpr_pool_worker w = &workers[i];
+        if (IS_CURRENT(w)) {
+            /* called from a device handler: this worker will clean up when it returns */
+            self = w;
+            continue;
+        }
+#ifdef HAVE_LIBPTHREAD
+        pthread_join(w->thread, NULL);
+#else
+        WaitForSingleObject(w->thread, INFINITE);
+        CloseHandle(w->thread);
+#endif
+        FUNC_IF(mpr_reactor_free, w->reactor);
+        FUNC_IF(free, w->devs);
+        COND_FREE(w->idle);
+        MUTEX_FREE(w->lock);
+    }
+    if (self) {
+#ifdef HAVE_LIBPTHREAD
+        pthread_detach(self->thread);
+#else
+        CloseHandle(self->thread);
+#endif
+        self->is_detached = 1;
+    }
+    else
+        free(workers);
+    workers = 0;
+    num_workers = 0;
+}
+
+static int _start_workers(void)
+{
+    int i, num_cpus = _num_cpus();
+    workers = (mpr_pool_worker)calloc(num_threads, sizeof(mpr_pool_worker_t));
+    RETURN_ARG_UNLESS(workers, -1);
+    for (i = 0; i < num_threads; i++) {
+        mpr_pool_worker w = &workers[i];
+        int result = 0;
+        MUTEX_INIT(w->lock);
+        COND_INIT(w->idle);
+        w->reactor = mpr_reactor_new();
+        w->cpu = i % num_cpus;
+        w->idx = i;
+        w->is_active = 1;
+#ifdef HAVE_LIBPTHREAD
+        result = pthread_create(&w->thread, 0, worker_thread_func, w);
+#else
+        if (!(w->thread = (HANDLE)_beginthreadex(NULL, 0, &worker_thread_func, w, 0,
+                                                 &w->thread_id)))
+            result = -1;
+#endif
+        if (result) {
+            printf("Device error: couldn't create polling thread.\n");
+            FUNC_IF(mpr_reactor_free, w->reactor);
+            COND_FREE(w->idle);
+            MUTEX_FREE(w->lock);
+            break;
+        }
+        _set_affinity(w);
+        ++num_workers;
+    }
+    if (!num_workers) {
+        free(workers);
+        workers = 0;
+        return -1;
+    }
+    return 0;
+}
+
+int mpr_set_poll_threads(int num)
+{
+    int result = 0;
+    RETURN_ARG_UNLESS(num >= 0, -1);
+    MUTEX_LOCK(pool_lock);
+    if (num_pooled)
+        result = -1;
+    else
+        num_threads = num;
+    MUTEX_UNLOCK(pool_lock);
+    return result;
+}
+
+int mpr_pool_add_dev(mpr_local_dev dev)
+{
+    int i, j;
+    mpr_pool_worker w = 0;
+    MUTEX_LOCK(pool_lock);
+    if (!num_threads || (!workers && _start_workers())) {
+        MUTEX_UNLOCK(pool_lock);
+        return 1;
+    }
+
+    /* prefer a worker already polling this device's graph, otherwise the least loaded */
+    for (i = 0; i < num_workers && !w; i++) {
+        for (j = 0; j < workers[i].num_devs; j++) {
+            if (workers[i].devs[j]->obj.graph == dev->obj.graph) {
+                w = &workers[i];
+                break;
+            }
+        }
+    }
+    if (!w) {
+        w = &workers[0];
+        for (i = 1; i < num_workers; i++) {
+            if (workers[i].num_devs < w->num_devs)
+                w = &workers[i];
+        }
+    }
+
+    MUTEX_LOCK(w->lock);
+    if (w->num_devs >= w->size) {
+        int size = w->size ? w->size * 2 : 8;
+        mpr_local_dev *tmp = realloc(w->devs, size * sizeof(mpr_local_dev));
+        if (!tmp) {
+            MUTEX_UNLOCK(w->lock);
+            MUTEX_UNLOCK(pool_lock);
+            return -1;
+        }
+        w->devs = tmp;
+        w->size = size;
+    }
+    w->devs[w->num_devs++] = dev;
+    dev->pool_worker = w;
+
+    /* share the worker's reactor so that signal updates wake the worker */
+    FUNC_IF(mpr_reactor_free, dev->reactor);
+    dev->reactor = w->reactor;
+    MUTEX_UNLOCK(w->lock);
+    mpr_reactor_wake(w->reactor);
+    ++num_pooled;
+    MUTEX_UNLOCK(pool_lock);
+    trace_dev(dev, "polled by shared thread on cpu %d\n", w->cpu);
+    return 0;
+}
+
+void mpr_pool_remove_dev(mpr_local_dev dev)
+{
+    int i;
+    mpr_pool_worker w;
+    MUTEX_LOCK(pool_lock);
+    w = (mpr_pool_worker)dev->pool_worker;
+    if (!w) {
+        MUTEX_UNLOCK(pool_lock);
+        return;
+    }
+    MUTEX_LOCK(w->lock);
+    for (i = 0; i < w->num_devs; i++) {
+        if (w->devs[i] == dev) {
+            w->devs[i] = w->devs[--w->num_devs];
+            break;
+        }
+    }
+    dev->pool_worker = 0;
+    dev->reactor = 0;
+    --num_pooled;
+    mpr_reactor_wake(w->reactor);
+
+    if (w->busy == dev && !IS_CURRENT(w)) {
+        /* Wait for the worker to finish dispatching the device. The pool lock is released since
+         * handlers may add or remove devices, and num_removing keeps the worker alive. */
+        ++num_removing;
+        MUTEX_UNLOCK(pool_lock);
+        while (w->busy == dev)
+            COND_WAIT(w->idle, w->lock);
+        MUTEX_UNLOCK(w->lock);
+        MUTEX_LOCK(pool_lock);
+        --num_removing;
+    }
+    else
+        MUTEX_UNLOCK(w->lock);
+
+    /* shut the pool down with its last device */
+    if (!num_pooled && !num_removing && workers)
+        _stop_workers();
+    MUTEX_UNLOCK(pool_lock);
+}
+
+/*   Threads for evaluating map expressions concurrently. Maps are queued by
+ * the polling thread, evaluated by the pool threads and the polling thread
+ * together, and then sent or received by the polling thread in the usual
+ * order so the output does not depend on which thread evaluated a map. */
+
+/* Number of maps claimed by a thread at a time. */
+#define EVAL_CHUNK 8
+
+/* Fewer queued maps than this are evaluated by the calling thread only. */
+#define MIN_PARALLEL_MAPS 16
+
+typedef struct _mpr_eval_worker {
+    struct _mpr_eval_pool *pool;
+    mpr_expr_stack stk;
+#ifdef HAVE_LIBPTHREAD
+    pthread_t thread;
+#else
+    HANDLE thread;
+#endif
+} mpr_eval_worker_t, *mpr_eval_worker;
+
+struct _mpr_eval_pool {
+    mpr_local_map *maps;
+    int num_maps;
+    int size;
+    int next;                       /*!< Index of the next map to be claimed. */
+    int num_busy;                   /*!< Number of workers still evaluating. */
+    unsigned int generation;        /*!< Incremented for each batch of maps. */
+    mpr_time time;
+    mpr_eval_worker workers;
+    int num_workers;
+    int is_active;
+    MUTEX_T lock;
+    COND_T start;
+    COND_T done;
+};
+
+static void _eval_chunks(mpr_eval_pool p, mpr_expr_stack stk)
+{
+    int i, end;
+    while (1) {
+        MUTEX_LOCK(p->lock);
+        i = p->next;
+        p->next += EVAL_CHUNK;
+        MUTEX_UNLOCK(p->lock);
+        if (i >= p->num_maps)
+            break;
+        end = i + EVAL_CHUNK < p->num_maps ? i + EVAL_CHUNK : p->num_maps;
+        for (; i < end; i++)
+            mpr_map_eval(p->maps[i], stk, p->time);
+    }
+}
+
+static void _run_eval_worker(mpr_eval_worker w)
+{
+    mpr_eval_pool p = w->pool;
+    unsigned int generation = 0;
+    MUTEX_LOCK(p->lock);
+    while (1) {
+        while (p->is_active && generation == p->generation)
+            COND_WAIT(p->start, p->lock);
+        if (!p->is_active)
+            break;
+        generation = p->generation;
+        MUTEX_UNLOCK(p->lock);
+
+        _eval_chunks(p, w->stk);
+
+        MUTEX_LOCK(p->lock);
+        if (0 == --p->num_busy)
+            COND_SIGNAL(p->done);
+    }
+    MUTEX_UNLOCK(p->lock);
+}
+
+#ifdef HAVE_LIBPTHREAD
+static void *eval_thread_func(void *data)
+{
+    _run_eval_worker((mpr_eval_worker)data);
+    pthread_exit(NULL);
+    return 0;
+}
+#else
+static unsigned __stdcall eval_thread_func(void *data)
+{
+    _run_eval_worker((mpr_eval_worker)data);
+    _endthread();
+    return 0;
+}
+#endif
+
+mpr_eval_pool mpr_eval_pool_new(int num_threads)
+{
+    int i;
+    mpr_eval_pool p;
+    RETURN_ARG_UNLESS(num_threads > 1, 0);
+    p = (mpr_eval_pool)calloc(1, sizeof(struct _mpr_eval_pool));
+    RETURN_ARG_UNLESS(p, 0);
+    p->workers = (mpr_eval_worker)calloc(num_threads - 1, sizeof(mpr_eval_worker_t));
+    if (!p->workers) {
+        free(p);
+        return 0;
+    }
+    MUTEX_INIT(p->lock);
+    COND_INIT(p->start);
+    COND_INIT(p->done);
+    p->is_active = 1;
+    for (i = 0; i < num_threads - 1; i++) {
+        mpr_eval_worker w = &p->workers[i];
+        int result = 0;
+        w->pool = p;
+        w->stk = mpr_expr_stack_new();
+#ifdef HAVE_LIBPTHREAD
+        result = pthread_create(&w->thread, 0, eval_thread_func, w);
+#else
+        if (!(w->thread = (HANDLE)_beginthreadex(NULL, 0, &eval_thread_func, w, 0, NULL)))
+            result = -1;
+#endif
+        if (result) {
+            printf("Device error: couldn't create evaluation thread.\n");
+            mpr_expr_stack_free(w->stk);
+            break;
+        }
+        ++p->num_workers;
+    }
+    if (!p->num_workers) {
+        mpr_eval_pool_free(p);
+        return 0;
+    }
+    return p;
+}
+
+void mpr_eval_pool_free(mpr_eval_pool p)
+{
+    int i;
+    RETURN_UNLESS(p);
+    MUTEX_LOCK(p->lock);
+    p->is_active = 0;
+    COND_BROADCAST(p->start);
+    MUTEX_UNLOCK(p->lock);
+    for (i = 0; i < p->num_workers; i++) {
+        mpr_eval_worker w = &p->workers[i];
+#ifdef HAVE_LIBPTHREAD
+        pthread_join(w->thread, NULL);
+#else
+        WaitForSingleObject(w->thread, INFINITE);
+        CloseHandle(w->thread);
+#endif
+        mpr_expr_stack_free(w->stk);
+    }
+    COND_FREE(p->start);
+    COND_FREE(p->done);
+    MUTEX_FREE(p->lock);
+    FUNC_IF(free, p->maps);
+    free(p->workers);
+    free(p);
+}
+
+void mpr_eval_pool_add(mpr_eval_pool p, mpr_local_map m)
+{
+    if (p->num_maps >= p->size) {
+        int size = p->size ? p->size * 2 : 64;
+        mpr_local_map *tmp = realloc(p->maps, size * sizeof(mpr_local_map));
+        RETURN_UNLESS(tmp);
+        p->maps = tmp;
+        p->size = size;
+    }
+    p->maps[p->num_maps++] = m;
+}
+
+void mpr_eval_pool_run(mpr_eval_pool p, mpr_expr_stack stk, mpr_time time)
+{
+    int i;
+    RETURN_UNLESS(p->num_maps);
+    if (p->num_maps < MIN_PARALLEL_MAPS) {
+        for (i = 0; i < p->num_maps; i++)
+            mpr_map_eval(p->maps[i], stk, time);
+        p->num_maps = 0;
+        return;
+    }
+
+    MUTEX_LOCK(p->lock);
+    p->next = 0;
+    p->time = time;
+    p->num_busy = p->num_workers;
+    ++p->generation;
+    COND_BROADCAST(p->start);
+    MUTEX_UNLOCK(p->lock);
+
+    _eval_chunks(p, stk);
+
+    MUTEX_LOCK(p->lock);
+    while (p->num_busy)
+        COND_WAIT(p->done, p->lock);
+    MUTEX_UNLOCK(p->lock);
+    p->num_maps = 0;
+}
+
+#else /* no threads */
+
+int mpr_set_poll_threads(int num)
+{
+    return -1;
+}
+
+int mpr_pool_add_dev(mpr_local_dev dev)
+{
+    return 1;
+}
+
+void mpr_pool_remove_dev(mpr_local_dev dev) {}
+
+mpr_eval_pool mpr_eval_pool_new(int num_threads)
+{
+    return 0;
+}
+
+void mpr_eval_pool_free(mpr_eval_pool pool) {}
+
+void mpr_eval_pool_add(mpr_eval_pool pool, mpr_local_map map) {}
+
+void mpr_eval_pool_run(mpr_eval_pool pool, mpr_expr_stack stk, mpr_time time) {}
+
+#endif
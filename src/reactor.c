@@ -0,0 +1,186 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "mapper_internal.h"
+
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_SYS_TIMERFD_H) && defined(HAVE_SYS_EVENTFD_H)
+
+#include <errno.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+
+/*   Event loop used by blocking calls to mpr_dev_poll() and mpr_graph_poll().
+ * Instead of waking every 100ms to check each liblo server, the listening
+ * sockets of all servers are watched with epoll, a timerfd is armed for the
+ * next housekeeping deadline and an eventfd allows other threads to request
+ * that updated signals be sent immediately.
+ *
+ *   liblo does not expose the sockets of connections accepted by a TCP server,
+ * so once a TCP listening socket has fired the wait is capped at
+ * TCP_POLL_MS to make sure that data on accepted connections is read. */
+
+/* Arbitrary tags for the reactor's own descriptors. */
+#define TAG_TIMER   -1
+#define TAG_WAKE    -2
+
+struct _mpr_reactor {
+    int epoll_fd;
+    int timer_fd;
+    int wake_fd;
+    int num_servers;
+    int size;
+    lo_server *servers;
+    int *fds;                       /*!< Socket of each server when it was added. */
+    uint8_t tcp_open;               /*!< 1 if a TCP server has accepted a connection. */
+};
+
+static int _add_fd(int epoll_fd, int fd, int tag)
+{
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = (uint32_t)tag;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+mpr_reactor mpr_reactor_new(void)
+{
+    mpr_reactor r = (mpr_reactor)calloc(1, sizeof(struct _mpr_reactor));
+    RETURN_ARG_UNLESS(r, 0);
+    r->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    r->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    r->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (r->epoll_fd < 0 || r->timer_fd < 0 || r->wake_fd < 0
+        || _add_fd(r->epoll_fd, r->timer_fd, TAG_TIMER)
+        || _add_fd(r->epoll_fd, r->wake_fd, TAG_WAKE)) {
+        trace("could not initialize event loop, falling back to polling.\n");
+        mpr_reactor_free(r);
+        return 0;
+    }
+    return r;
+}
+
+void mpr_reactor_free(mpr_reactor r)
+{
+    RETURN_UNLESS(r);
+    if (r->epoll_fd >= 0)
+        close(r->epoll_fd);
+    if (r->timer_fd >= 0)
+        close(r->timer_fd);
+    if (r->wake_fd >= 0)
+        close(r->wake_fd);
+    FUNC_IF(free, r->servers);
+    FUNC_IF(free, r->fds);
+    free(r);
+}
+
+void mpr_reactor_set_servers(mpr_reactor r, lo_server *servers, int num)
+{
+    int i;
+    RETURN_UNLESS(r);
+    if (num == r->num_servers && !memcmp(servers, r->servers, num * sizeof(lo_server)))
+        return;
+
+    /* The set of servers has changed, e.g. after mpr_graph_set_interface().
+     * Previous servers may already have been freed, so use the stored fds. */
+    for (i = 0; i < r->num_servers; i++) {
+        if (r->fds[i] >= 0)
+            epoll_ctl(r->epoll_fd, EPOLL_CTL_DEL, r->fds[i], NULL);
+    }
+    r->num_servers = 0;
+    if (num > r->size) {
+        lo_server *servers_tmp = realloc(r->servers, num * sizeof(lo_server));
+        int *fds_tmp;
+        RETURN_UNLESS(servers_tmp);
+        r->servers = servers_tmp;
+        fds_tmp = realloc(r->fds, num * sizeof(int));
+        RETURN_UNLESS(fds_tmp);
+        r->fds = fds_tmp;
+        r->size = num;
+    }
+    memcpy(r->servers, servers, num * sizeof(lo_server));
+    r->num_servers = num;
+    for (i = 0; i < num; i++) {
+        r->fds[i] = servers[i] ? lo_server_get_socket_fd(servers[i]) : -1;
+        if (r->fds[i] >= 0)
+            _add_fd(r->epoll_fd, r->fds[i], i);
+    }
+}
+
+/* Both descriptors are non-blocking, so EAGAIN only means there is nothing left to read. */
+static void drain_fd(int fd)
+{
+    uint64_t count;
+    while (read(fd, &count, sizeof(count)) < 0 && EINTR == errno)
+        continue;
+}
+
+int mpr_reactor_wait(mpr_reactor r, int timeout_ms)
+{
+    struct epoll_event events[8];
+    struct itimerspec its;
+    int i, n, ready = 0;
+    RETURN_ARG_UNLESS(r, 0);
+
+    if (r->tcp_open && (timeout_ms < 0 || timeout_ms > TCP_POLL_MS))
+        timeout_ms = TCP_POLL_MS;
+    RETURN_ARG_UNLESS(timeout_ms, 0);
+
+    /* arm a one-shot timer for the deadline, or disarm it if there is none */
+    memset(&its, 0, sizeof(its));
+    if (timeout_ms > 0) {
+        its.it_value.tv_sec = timeout_ms / 1000;
+        its.it_value.tv_nsec = (timeout_ms % 1000) * 1000000;
+    }
+    timerfd_settime(r->timer_fd, 0, &its, NULL);
+
+    n = epoll_wait(r->epoll_fd, events, 8, -1);
+    for (i = 0; i < n; i++) {
+        int tag = (int)events[i].data.u32;
+        if (TAG_TIMER == tag)
+            drain_fd(r->timer_fd);
+        else if (TAG_WAKE == tag) {
+            drain_fd(r->wake_fd);
+            ready = 1;
+        }
+        else {
+            if (tag < r->num_servers && LO_TCP == lo_server_get_protocol(r->servers[tag]))
+                r->tcp_open = 1;
+            ready = 1;
+        }
+    }
+    return ready;
+}
+
+void mpr_reactor_wake(mpr_reactor r)
+{
+    uint64_t one = 1;
+    RETURN_UNLESS(r);
+    /* EAGAIN means the counter is saturated, in which case a wake is already pending */
+    while (write(r->wake_fd, &one, sizeof(one)) < 0 && EINTR == errno)
+        continue;
+}
+
+#else /* no epoll: callers fall back to polling liblo servers in time slices */
+
+mpr_reactor mpr_reactor_new(void)
+{
+    return 0;
+}
+
+void mpr_reactor_free(mpr_reactor r) {}
+
+void mpr_reactor_set_servers(mpr_reactor r, lo_server *servers, int num) {}
+
+int mpr_reactor_wait(mpr_reactor r, int timeout_ms)
+{
+    return 0;
+}
+
+void mpr_reactor_wake(mpr_reactor r) {}
+
+#endif
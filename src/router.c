@@ -90,8 +90,11 @@ static void _update_map_count(mpr_rtr rtr)
             else if (MPR_DIR_OUT == rs->slots[i]->dir)
                 ++sig_maps_out;
         }
-        rs->sig->num_maps_in = sig_maps_in;
-        rs->sig->num_maps_out = sig_maps_out;
+        if (sig_maps_in != rs->sig->num_maps_in || sig_maps_out != rs->sig->num_maps_out) {
+            rs->sig->num_maps_in = sig_maps_in;
+            rs->sig->num_maps_out = sig_maps_out;
+            mpr_obj_increment_version((mpr_obj)rs->sig);
+        }
         dev_maps_in += sig_maps_in;
         dev_maps_out += sig_maps_out;
         rs = rs->next;
@@ -104,7 +107,6 @@ static void _update_map_count(mpr_rtr rtr)
 void mpr_rtr_process_sig(mpr_rtr rtr, mpr_local_sig sig, int idmap_idx, const void *val, mpr_time t)
 {
     mpr_id_map idmap;
-    lo_message msg;
     mpr_rtr_sig rs;
     mpr_local_map map;
     int i, j, inst_idx;
@@ -161,8 +163,8 @@ void mpr_rtr_process_sig(mpr_rtr rtr, mpr_local_sig sig, int idmap_idx, const vo
                     continue;
 
                 if (slot->dir == MPR_DIR_IN) {
-                    msg = mpr_map_build_msg(map, slot, 0, 0, idmap);
-                    mpr_link_add_msg(slot->link, slot->sig, msg, t, map->protocol, bundle_idx);
+                    mpr_link_add_map_msg(slot->link, slot->sig, map, slot, 0, 0, idmap, t,
+                                         bundle_idx);
                 }
             }
 
@@ -174,12 +176,9 @@ void mpr_rtr_process_sig(mpr_rtr rtr, mpr_local_sig sig, int idmap_idx, const vo
 
             /* send release to downstream */
             if (slot->dir == MPR_DIR_OUT) {
-                msg = 0;
-                if (in_scope) {
-                    msg = mpr_map_build_msg(map, slot, 0, 0, idmap);
-                    mpr_link_add_msg(dst_slot->link, dst_slot->sig, msg, t, map->protocol,
-                                     bundle_idx);
-                }
+                if (in_scope)
+                    mpr_link_add_map_msg(dst_slot->link, dst_slot->sig, map, slot, 0, 0, idmap, t,
+                                         bundle_idx);
             }
         }
         *lock = 0;
@@ -211,10 +210,11 @@ void mpr_rtr_process_sig(mpr_rtr rtr, mpr_local_sig sig, int idmap_idx, const vo
 
         if (MPR_LOC_DST == map->process_loc) {
             /* bypass map processing and bundle value without type coercion */
-            char *types = alloca(sig->len * sizeof(char));
-            memset(types, sig->type, sig->len);
-            msg = mpr_map_build_msg(map, slot, val, types, sig->use_inst ? idmap : 0);
-            mpr_link_add_msg(map->dst->link, map->dst->sig, msg, t, map->protocol, bundle_idx);
+            map->trace = ((mpr_local_dev)sig->dev)->trace;
+            mpr_link_add_map_msg(map->dst->link, map->dst->sig, map, slot, val, 0,
+                                 sig->use_inst ? idmap : 0, t, bundle_idx);
+            STAT_INC(map, MAP_STAT_UPDATES_IN);
+            STAT_INC(map, MAP_STAT_UPDATES_OUT);
             continue;
         }
 
@@ -225,6 +225,9 @@ void mpr_rtr_process_sig(mpr_rtr rtr, mpr_local_sig sig, int idmap_idx, const vo
 
         /* copy input value */
         mpr_value_set_samp(&slot->val, inst_idx, (void*)val, t);
+        STAT_INC(map, MAP_STAT_UPDATES_IN);
+        if (((mpr_local_dev)sig->dev)->trace.id)
+            map->trace = ((mpr_local_dev)sig->dev)->trace;
 
         if (!slot->causes_update)
             continue;
@@ -414,6 +417,7 @@ void mpr_rtr_add_map(mpr_rtr rtr, mpr_local_map map)
         map->dst->link = map->src[0]->link;
     }
 
+    mpr_map_set_stats(map, rtr->dev->stats != 0);
     _update_map_count(rtr);
 }
 
@@ -564,6 +568,9 @@ int mpr_rtr_remove_map(mpr_rtr rtr, mpr_local_map map)
     }
 
     FUNC_IF(free, map->updated_inst);
+    FUNC_IF(free, map->eval_status);
+    FUNC_IF(free, map->eval_types);
+    mpr_map_set_stats(map, 0);
     FUNC_IF(mpr_expr_free, map->expr);
     _update_map_count(rtr);
     return 0;
@@ -0,0 +1,285 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <zlib.h>
+
+#include "config.h"
+#include "mapper_internal.h"
+
+/* Session files store the maps of a graph as a compressed OSC bundle of /map messages, preceded
+ * by a short header holding a magic string, the format version, and the uncompressed length. */
+#define SESSION_MAGIC       "MPRS"
+#define SESSION_VERSION     1
+#define SESSION_HEADER_LEN  12
+#define SESSION_MAX_LEN     (64 * 1024 * 1024)
+#define SESSION_MAX_RATIO   1032    /* deflate cannot compress better than this */
+
+/*! Build the /map message that would recreate a map, or return zero if the map cannot be named. */
+static lo_message _map_msg(mpr_map m)
+{
+    int i;
+    char name[256];
+    lo_message msg;
+    RETURN_ARG_UNLESS(m->dst->sig->dev->name, 0);
+    for (i = 0; i < m->num_src; i++)
+        RETURN_ARG_UNLESS(m->src[i]->sig->dev->name, 0);
+    RETURN_ARG_UNLESS(msg = lo_message_new(), 0);
+
+    for (i = 0; i < m->num_src; i++) {
+        snprintf(name, 256, "%s%s", m->src[i]->sig->dev->name, m->src[i]->sig->path);
+        lo_message_add_string(msg, name);
+    }
+    lo_message_add_string(msg, "->");
+    snprintf(name, 256, "%s%s", m->dst->sig->dev->name, m->dst->sig->path);
+    lo_message_add_string(msg, name);
+
+    /* map ids are assigned again when the session is loaded */
+    mpr_tbl_add_config_to_msg(m->obj.props.synced, msg);
+    for (i = 0; i < m->num_src; i++)
+        mpr_slot_add_props_to_msg(msg, m->src[i], 0);
+    mpr_slot_add_props_to_msg(msg, m->dst, 1);
+    return msg;
+}
+
+static void _json_str(FILE *file, const char *str)
+{
+    fputc('"', file);
+    for (; *str; str++) {
+        if ('"' == *str || '\\' == *str)
+            fprintf(file, "\\%c", *str);
+        else if ((unsigned char)*str < 0x20)
+            fprintf(file, "\\u%04x", (unsigned char)*str);
+        else
+            fputc(*str, file);
+    }
+    fputc('"', file);
+}
+
+static void _json_arg(FILE *file, char type, lo_arg *arg)
+{
+    char c[2] = {0, 0};
+    switch (type) {
+        case 's':
+        case 'S':   _json_str(file, &arg->s);                       break;
+        case 'c':   c[0] = arg->c; _json_str(file, c);              break;
+        case 'i':   fprintf(file, "%d", arg->i);                    break;
+        case 'h':   fprintf(file, "%lld", (long long)arg->h);       break;
+        case 'f':   fprintf(file, "%g", arg->f);                    break;
+        case 'd':   fprintf(file, "%g", arg->d);                    break;
+        case 't':   fprintf(file, "%g", mpr_time_as_dbl(arg->t));   break;
+        case 'T':   fprintf(file, "true");                          break;
+        case 'F':   fprintf(file, "false");                         break;
+        default:    fprintf(file, "null");                          break;
+    }
+}
+
+/*! Write a /map message as a JSON object. Property keys lose their leading '@' and properties
+ *  with more than one value are written as arrays. */
+static void _json_map(FILE *file, lo_message msg, int first)
+{
+    int i, j, argc = lo_message_get_argc(msg);
+    const char *types = lo_message_get_types(msg);
+    lo_arg **av = lo_message_get_argv(msg);
+
+    fprintf(file, "%s\n    {\n      \"sources\": [", first ? "" : ",");
+    for (i = 0; i < argc && strcmp(&av[i]->s, "->"); i++) {
+        fputs(i ? ", " : "", file);
+        _json_str(file, &av[i]->s);
+    }
+    fprintf(file, "],\n      \"destination\": ");
+    _json_str(file, &av[i + 1]->s);
+
+    for (i += 2; i < argc; i = j) {
+        int num_vals;
+        fprintf(file, ",\n      ");
+        _json_str(file, &av[i]->s + 1);
+        fprintf(file, ": ");
+        for (j = i + 1; j < argc && ('s' != types[j] || '@' != (&av[j]->s)[0]); j++) {}
+        num_vals = j - i - 1;
+        if (1 == num_vals)
+            _json_arg(file, types[i + 1], av[i + 1]);
+        else {
+            int k;
+            fprintf(file, "[");
+            for (k = i + 1; k < j; k++) {
+                fputs(k > i + 1 ? ", " : "", file);
+                _json_arg(file, types[k], av[k]);
+            }
+            fprintf(file, "]");
+        }
+    }
+    fprintf(file, "\n    }");
+}
+
+static int _save_json(lo_bundle b, const char *path)
+{
+    int i, num_maps = lo_bundle_count(b);
+    FILE *file = fopen(path, "w");
+    RETURN_ARG_UNLESS(file, -1);
+    fprintf(file, "{\n  \"fileversion\": ");
+    _json_str(file, PACKAGE_VERSION);
+    fprintf(file, ",\n  \"maps\": [");
+    for (i = 0; i < num_maps; i++)
+        _json_map(file, lo_bundle_get_message(b, i, NULL), 0 == i);
+    fprintf(file, "\n  ]\n}\n");
+    fclose(file);
+    return num_maps;
+}
+
+static int _save_binary(lo_bundle b, const char *path)
+{
+    size_t len = lo_bundle_length(b);
+    uLongf zlen = compressBound(len);
+    char *data = 0, *zdata = 0;
+    int ret = -1;
+    FILE *file = 0;
+
+    if (len > SESSION_MAX_LEN) {
+        trace_graph("session is too large to save.\n");
+        return -1;
+    }
+    data = malloc(len);
+    zdata = malloc(SESSION_HEADER_LEN + zlen);
+    DONE_UNLESS(data && zdata && lo_bundle_serialise(b, data, &len));
+    if (Z_OK != compress2((Bytef*)zdata + SESSION_HEADER_LEN, &zlen, (const Bytef*)data, len,
+                          Z_BEST_COMPRESSION)) {
+        trace_graph("error compressing session.\n");
+        goto done;
+    }
+    memcpy(zdata, SESSION_MAGIC, 4);
+    osc_write32(zdata + 4, SESSION_VERSION);
+    osc_write32(zdata + 8, len);
+    DONE_UNLESS(file = fopen(path, "wb"));
+    if (fwrite(zdata, 1, SESSION_HEADER_LEN + zlen, file) == SESSION_HEADER_LEN + zlen)
+        ret = lo_bundle_count(b);
+  done:
+    FUNC_IF(fclose, file);
+    FUNC_IF(free, data);
+    FUNC_IF(free, zdata);
+    return ret;
+}
+
+int mpr_graph_save_session(mpr_graph g, const char *path, int json)
+{
+    mpr_list devs;
+    lo_bundle b;
+    int ret;
+    RETURN_ARG_UNLESS(g && path, -1);
+    RETURN_ARG_UNLESS(b = lo_bundle_new(LO_TT_IMMEDIATE), -1);
+
+    /* group maps by destination device so they can be loaded in few batches */
+    devs = mpr_list_from_data(g->devs);
+    while (devs) {
+        mpr_list maps = mpr_list_from_data(g->maps);
+        while (maps) {
+            mpr_map m = (mpr_map)*maps;
+            maps = mpr_list_get_next(maps);
+            if (m->dst->sig->dev == (mpr_dev)*devs && MPR_STATUS_EXPIRED != m->status) {
+                lo_message msg = _map_msg(m);
+                if (msg)
+                    lo_bundle_add_message(b, net_msg_strings[MSG_MAP], msg);
+            }
+        }
+        devs = mpr_list_get_next(devs);
+    }
+    ret = json ? _save_json(b, path) : _save_binary(b, path);
+    lo_bundle_free_recursive(b);
+    return ret;
+}
+
+/*! Stage the map described by a saved /map message. Takes ownership of the message. */
+static int _load_map(mpr_graph g, lo_message msg)
+{
+    int i, num_src = 0, argc = lo_message_get_argc(msg);
+    const char *types = lo_message_get_types(msg), *src_names[MAX_NUM_MAP_SRC], *dst_name = 0;
+    lo_arg **av = lo_message_get_argv(msg);
+    mpr_map m;
+
+    for (i = 0; i < argc && 's' == types[i]; i++) {
+        if (0 == strcmp(&av[i]->s, "->")) {
+            if (i + 1 < argc && 's' == types[i + 1])
+                dst_name = &av[i + 1]->s;
+            break;
+        }
+        if (num_src >= MAX_NUM_MAP_SRC)
+            break;
+        src_names[num_src++] = &av[i]->s;
+    }
+    m = (num_src && dst_name) ? mpr_graph_get_map_by_names(g, num_src, src_names, dst_name) : 0;
+    if (m && m->status >= MPR_STATUS_ACTIVE) {
+        trace_graph("skipping established map to '%s'\n", dst_name);
+        m = 0;
+    }
+    else if (!m && num_src && dst_name)
+        m = mpr_graph_add_map(g, 0, num_src, src_names, dst_name);
+    if (!m) {
+        lo_message_free(msg);
+        return 0;
+    }
+    if (mpr_graph_can_batch_map(g, m))
+        mpr_graph_batch_map(g, m, msg);
+    else {
+        mpr_net_use_bus(&g->net);
+        mpr_net_add_msg(&g->net, 0, MSG_MAP, msg);
+    }
+    return 1;
+}
+
+int mpr_graph_load_session(mpr_graph g, const char *path)
+{
+    char header[SESSION_HEADER_LEN], *zdata = 0, *data = 0;
+    uLongf len;
+    long zlen;
+    size_t pos;
+    int num_maps = -1;
+    FILE *file;
+    RETURN_ARG_UNLESS(g && path && (file = fopen(path, "rb")), -1);
+
+    if (   fread(header, 1, SESSION_HEADER_LEN, file) != SESSION_HEADER_LEN
+        || memcmp(header, SESSION_MAGIC, 4) || osc_read32(header + 4) != SESSION_VERSION) {
+        trace_graph("'%s' is not a session file.\n", path);
+        goto done;
+    }
+    len = osc_read32(header + 8);
+    fseek(file, 0, SEEK_END);
+    zlen = ftell(file) - SESSION_HEADER_LEN;
+    fseek(file, SESSION_HEADER_LEN, SEEK_SET);
+    /* the stored length comes from the file, so check it against the data before trusting it */
+    if (   zlen <= 0 || len < 16 || len > SESSION_MAX_LEN
+        || (uLong)zlen > compressBound(len) || len > (uLong)zlen * SESSION_MAX_RATIO) {
+        trace_graph("session '%s' has an invalid length.\n", path);
+        goto done;
+    }
+    DONE_UNLESS((zdata = malloc(zlen)) && (data = malloc(len)));
+    DONE_UNLESS(fread(zdata, 1, zlen, file) == (size_t)zlen);
+    if (   Z_OK != uncompress((Bytef*)data, &len, (const Bytef*)zdata, zlen)
+        || len < 16 || strcmp(data, "#bundle")) {
+        trace_graph("error decompressing session '%s'.\n", path);
+        goto done;
+    }
+
+    /* skip the bundle header and timetag, then stage each /map message in turn */
+    num_maps = 0;
+    for (pos = 16; pos + 4 <= len;) {
+        size_t size = osc_read32(data + pos);
+        pos += 4;
+        if (pos + size > len)
+            break;
+        if ('#' != data[pos] && 0 == strcmp(data + pos, net_msg_strings[MSG_MAP])) {
+            int err = 0;
+            lo_message msg = lo_message_deserialise(data + pos, size, &err);
+            if (msg && !err)
+                num_maps += _load_map(g, msg);
+            else
+                FUNC_IF(lo_message_free, msg);
+        }
+        pos += size;
+    }
+    mpr_net_send(&g->net);
+    trace_graph("loaded %d maps from session '%s'.\n", num_maps, path);
+  done:
+    fclose(file);
+    FUNC_IF(free, zdata);
+    FUNC_IF(free, data);
+    return num_maps;
+}
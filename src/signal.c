@@ -70,7 +70,7 @@ mpr_sig mpr_sig_new(mpr_dev dev, mpr_dir dir, const char *name, int len,
     else
         ++dev->num_outputs;
 
-    mpr_obj_increment_version((mpr_obj)dev);
+    mpr_obj_increment_version((mpr_obj)lsig);
 
     mpr_dev_add_sig_methods((mpr_local_dev)dev, lsig);
     if (((mpr_local_dev)dev)->registered) {
@@ -85,15 +85,12 @@ mpr_sig mpr_sig_new(mpr_dev dev, mpr_dir dir, const char *name, int len,
 void mpr_sig_init(mpr_sig sig, mpr_dir dir, const char *name, int len, mpr_type type,
                   const char *unit, const void *min, const void *max, int *num_inst)
 {
-    int i, str_len, loc_mod, rem_mod;
+    int i, loc_mod, rem_mod;
     mpr_tbl tbl;
     RETURN_UNLESS(name);
 
-    name = skip_slash(name);
-    str_len = strlen(name)+2;
-    sig->path = malloc(str_len);
-    snprintf(sig->path, str_len, "/%s", name);
-    sig->name = (char*)sig->path+1;
+    sig->path = mpr_str_intern_path(name);
+    sig->name = sig->path+1;
     sig->len = len;
     sig->type = type;
     sig->dir = dir ? dir : MPR_DIR_OUT;
@@ -208,7 +205,7 @@ void mpr_sig_free(mpr_sig sig)
         mpr_sig_send_removed(lsig);
     }
     mpr_graph_remove_sig(sig->obj.graph, sig, MPR_OBJ_REM);
-    mpr_obj_increment_version((mpr_obj)ldev);
+    mpr_dev_record_change(ldev, 0, 1);
 }
 
 void mpr_sig_free_internal(mpr_sig sig)
@@ -235,7 +232,7 @@ void mpr_sig_free_internal(mpr_sig sig)
 
     FUNC_IF(mpr_tbl_free, sig->obj.props.synced);
     FUNC_IF(mpr_tbl_free, sig->obj.props.staged);
-    FUNC_IF(free, sig->path);
+    FUNC_IF(mpr_str_free, sig->path);
     FUNC_IF(free, sig->unit);
 }
 
@@ -415,6 +412,7 @@ int mpr_sig_get_idmap_with_LID(mpr_local_sig lsig, mpr_id LID, int flags, mpr_ti
             return -1;
         h((mpr_sig)lsig, MPR_SIG_REL_UPSTRM & lsig->event_flags ? MPR_SIG_REL_UPSTRM : MPR_SIG_UPDATE,
           lsig->idmaps[i].map->LID, 0, lsig->type, 0, t);
+        STAT_INC((mpr_local_dev)lsig->dev, DEV_STAT_INST_STOLEN);
     }
     else if (lsig->steal_mode == MPR_STEAL_NEWEST) {
         i = _newest_inst(lsig);
@@ -422,6 +420,7 @@ int mpr_sig_get_idmap_with_LID(mpr_local_sig lsig, mpr_id LID, int flags, mpr_ti
             return -1;
         h((mpr_sig)lsig, MPR_SIG_REL_UPSTRM & lsig->event_flags ? MPR_SIG_REL_UPSTRM : MPR_SIG_UPDATE,
           lsig->idmaps[i].map->LID, 0, lsig->type, 0, t);
+        STAT_INC((mpr_local_dev)lsig->dev, DEV_STAT_INST_STOLEN);
     }
     else
         return -1;
@@ -505,6 +504,7 @@ int mpr_sig_get_idmap_with_GID(mpr_local_sig lsig, mpr_id GID, int flags, mpr_ti
             return -1;
         h((mpr_sig)lsig, MPR_SIG_REL_UPSTRM & lsig->event_flags ? MPR_SIG_REL_UPSTRM : MPR_SIG_UPDATE,
           lsig->idmaps[i].map->LID, 0, lsig->type, 0, t);
+        STAT_INC((mpr_local_dev)lsig->dev, DEV_STAT_INST_STOLEN);
     }
     else if (lsig->steal_mode == MPR_STEAL_NEWEST) {
         i = _newest_inst(lsig);
@@ -512,6 +512,7 @@ int mpr_sig_get_idmap_with_GID(mpr_local_sig lsig, mpr_id GID, int flags, mpr_ti
             return -1;
         h((mpr_sig)lsig, MPR_SIG_REL_UPSTRM & lsig->event_flags ? MPR_SIG_REL_UPSTRM : MPR_SIG_UPDATE,
           lsig->idmaps[i].map->LID, 0, lsig->type, 0, t);
+        STAT_INC((mpr_local_dev)lsig->dev, DEV_STAT_INST_STOLEN);
     }
     else
         return -1;
@@ -701,49 +702,41 @@ done:
     FUNC_IF(lo_address_free, addr);
 }
 
-void mpr_sig_set_value(mpr_sig sig, mpr_id id, int len, mpr_type type, const void *val)
+/* Check that a value can be used to update a local signal. */
+static int _check_value(mpr_local_sig lsig, int len, mpr_type type, const void *val)
 {
-    mpr_time time;
-    int idmap_idx;
-    mpr_local_sig lsig = (mpr_local_sig)sig;
-    mpr_sig_inst si;
-    RETURN_UNLESS(sig);
-    if (!sig->is_local) {
-        _mpr_remote_sig_set_value(sig, len, type, val);
-        return;
-    }
-    if (!len || !val) {
-        mpr_sig_release_inst(sig, id);
-        return;
-    }
+    int i;
     if (!mpr_type_get_is_num(type)) {
 #ifdef DEBUG
         trace("called update on signal '%s' with non-number type '%c'\n", lsig->name, type);
 #endif
-        return;
+        return 0;
     }
     if (len && (len != lsig->len)) {
 #ifdef DEBUG
         trace("called update on signal '%s' with value length %d (should be %d)\n",
               lsig->name, len, lsig->len);
 #endif
-        return;
+        return 0;
     }
-    if (type != MPR_INT32) {
-        /* check for NaN */
-        int i;
-        if (type == MPR_FLT) {
-            for (i = 0; i < len; i++)
-                RETURN_UNLESS(((float*)val)[i] == ((float*)val)[i]);
-        }
-        else if (type == MPR_DBL) {
-            for (i = 0; i < len; i++)
-                RETURN_UNLESS(((double*)val)[i] == ((double*)val)[i]);
-        }
+    /* check for NaN */
+    if (type == MPR_FLT) {
+        for (i = 0; i < len; i++)
+            RETURN_ARG_UNLESS(((float*)val)[i] == ((float*)val)[i], 0);
     }
-    time = mpr_dev_get_time(sig->dev);
-    idmap_idx = mpr_sig_get_idmap_with_LID(lsig, id, 0, time, 1);
-    RETURN_UNLESS(idmap_idx >= 0);
+    else if (type == MPR_DBL) {
+        for (i = 0; i < len; i++)
+            RETURN_ARG_UNLESS(((double*)val)[i] == ((double*)val)[i], 0);
+    }
+    return 1;
+}
+
+/* Store a checked value for an instance of a local signal and route it to the signal's maps. */
+static int _set_value(mpr_local_sig lsig, mpr_id id, mpr_type type, const void *val, mpr_time time)
+{
+    mpr_sig_inst si;
+    int idmap_idx = mpr_sig_get_idmap_with_LID(lsig, id, 0, time, 1);
+    RETURN_ARG_UNLESS(idmap_idx >= 0, 0);
     si = lsig->idmaps[idmap_idx].inst;
 
     /* update time */
@@ -754,14 +747,81 @@ void mpr_sig_set_value(mpr_sig sig, mpr_id id, int len, mpr_type type, const voi
     if (type != lsig->type)
         set_coerced_val(lsig->len, type, val, lsig->len, lsig->type, si->val);
     else
-        memcpy(si->val, (void*)val, mpr_sig_get_vector_bytes(sig));
+        memcpy(si->val, (void*)val, mpr_sig_get_vector_bytes((mpr_sig)lsig));
     si->has_val = 1;
 
     /* mark instance as updated */
     set_bitflag(lsig->updated_inst, si->idx);
     ((mpr_local_dev)lsig->dev)->sending = lsig->updated = 1;
 
-    mpr_rtr_process_sig(lsig->obj.graph->net.rtr, lsig, idmap_idx, si->has_val ? si->val : 0, si->time);
+    mpr_rtr_process_sig(lsig->obj.graph->net.rtr, lsig, idmap_idx, si->val, si->time);
+    return 1;
+}
+
+/* Start a new trace unless this update continues one, e.g. from a signal handler. */
+MPR_INLINE static int _start_trace(mpr_local_dev dev)
+{
+    RETURN_ARG_UNLESS(dev->latency && !dev->trace.id, 0);
+    dev->trace.id = dev->obj.id | ++dev->trace_count;
+    mpr_time_set(&dev->trace.origin, MPR_NOW);
+    return 1;
+}
+
+void mpr_sig_set_value(mpr_sig sig, mpr_id id, int len, mpr_type type, const void *val)
+{
+    int is_origin;
+    mpr_local_sig lsig = (mpr_local_sig)sig;
+    mpr_local_dev dev;
+    RETURN_UNLESS(sig);
+    if (!sig->is_local) {
+        _mpr_remote_sig_set_value(sig, len, type, val);
+        return;
+    }
+    if (!len || !val) {
+        mpr_sig_release_inst(sig, id);
+        return;
+    }
+    RETURN_UNLESS(_check_value(lsig, len, type, val));
+
+    dev = (mpr_local_dev)lsig->dev;
+    is_origin = _start_trace(dev);
+    _set_value(lsig, id, type, val, mpr_dev_get_time(sig->dev));
+    if (is_origin)
+        dev->trace.id = 0;
+    mpr_dev_wake(dev);
+}
+
+int mpr_dev_set_values(mpr_dev dev, int num_sigs, mpr_sig *sigs, mpr_id *ids, int len,
+                       mpr_type type, const void *vals)
+{
+    mpr_local_dev ldev = (mpr_local_dev)dev;
+    mpr_time time;
+    int i, num_set = 0, is_origin, size = mpr_type_get_size(type);
+    const char *val = (const char*)vals;
+    RETURN_ARG_UNLESS(dev && dev->is_local && num_sigs > 0 && sigs && vals, 0);
+    RETURN_ARG_UNLESS(mpr_type_get_is_num(type), 0);
+
+    /* all updates share the same timestamp and trace */
+    time = mpr_dev_get_time(dev);
+    is_origin = _start_trace(ldev);
+    for (i = 0; i < num_sigs && sigs[i]; i++) {
+        mpr_local_sig lsig = (mpr_local_sig)sigs[i];
+        if (len < lsig->len) {
+            trace_dev(ldev, "mpr_dev_set_values(): ran out of values at signal %d\n", i);
+            break;
+        }
+        if ((mpr_dev)lsig->dev == dev && lsig->is_local && _check_value(lsig, lsig->len, type, val))
+            num_set += _set_value(lsig, ids ? ids[i] : 0, type, val, time);
+        val += lsig->len * size;
+        len -= lsig->len;
+    }
+    if (is_origin)
+        ldev->trace.id = 0;
+
+    /* send all updates together */
+    mpr_dev_update_maps(dev);
+    mpr_dev_wake(ldev);
+    return num_set;
 }
 
 void mpr_sig_release_inst(mpr_sig sig, mpr_id id)
@@ -783,6 +843,7 @@ void mpr_sig_release_inst_internal(mpr_local_sig lsig, int idmap_idx)
     ((mpr_local_dev)lsig->dev)->sending = lsig->updated = 1;
 
     mpr_rtr_process_sig(lsig->obj.graph->net.rtr, lsig, idmap_idx, 0, smap->inst->time);
+    mpr_dev_wake((mpr_local_dev)lsig->dev);
 
     if (smap->map && mpr_dev_LID_decref((mpr_local_dev)lsig->dev, lsig->group, smap->map)) {
         smap->map = 0;
@@ -1052,6 +1113,21 @@ void mpr_sig_send_state(mpr_sig sig, net_msg_t cmd)
     }
 }
 
+void mpr_sig_send_changes(mpr_sig sig, int version)
+{
+    char str[BUFFSIZE];
+    lo_message msg;
+    RETURN_UNLESS(sig && sig->is_local && sig->obj.version > version);
+    RETURN_UNLESS(mpr_sig_full_name(sig, str, BUFFSIZE));
+    msg = lo_message_new();
+    RETURN_UNLESS(msg);
+    lo_message_add_string(msg, str);
+
+    /* only the properties modified since the given device revision */
+    mpr_tbl_add_changes_to_msg(sig->obj.props.synced, version, msg);
+    mpr_net_add_msg(&sig->obj.graph->net, 0, MSG_SIG, msg);
+}
+
 void mpr_sig_send_removed(mpr_local_sig lsig)
 {
     char sig_name[BUFFSIZE];
@@ -148,16 +148,14 @@ void mpr_slot_print(mpr_slot slot, int is_dst)
 
 int mpr_slot_match_full_name(mpr_slot slot, const char *full_name)
 {
-    int len;
-    const char *sig_name, *dev_name;
+    const char *sig_name;
     RETURN_ARG_UNLESS(full_name, 1);
     full_name += (full_name[0]=='/');
     sig_name = strchr(full_name+1, '/');
     RETURN_ARG_UNLESS(sig_name, 1);
-    len = sig_name - full_name;
-    dev_name = slot->sig->dev->name;
-    return (strlen(dev_name) != len || strncmp(full_name, dev_name, len)
-            || strcmp(sig_name+1, slot->sig->name)) ? 1 : 0;
+    /* device names and signal paths are interned so we can compare pointers */
+    return (   slot->sig->dev->name != mpr_str_find_len(full_name, sig_name - full_name)
+            || slot->sig->path != mpr_str_find(sig_name)) ? 1 : 0;
 }
 
 void mpr_slot_alloc_values(mpr_local_slot slot, int num_inst, int hist_size)
@@ -167,8 +165,7 @@ void mpr_slot_alloc_values(mpr_local_slot slot, int num_inst, int hist_size)
         num_inst = slot->sig->num_inst;
 
     /* reallocate memory */
-    mpr_value_realloc(&slot->val, slot->sig->len, slot->sig->type,
-                      hist_size, num_inst, slot == slot->map->dst);
+    mpr_value_realloc(&slot->val, slot->sig->len, slot->sig->type, hist_size, num_inst);
 
     slot->num_inst = num_inst;
 }
@@ -14,6 +14,8 @@ static int compare_rec(const void *l, const void *r)
     int idx_r = MASK_PROP_BITFLAGS(rec_r->prop);
     if ((idx_l == MPR_PROP_EXTRA) && (idx_r == MPR_PROP_EXTRA)) {
         const char *str_l = rec_l->key, *str_r = rec_r->key;
+        if (str_l == str_r)
+            return 0;
         if (str_l[0] == '@')
             ++str_l;
         if (str_r[0] == '@')
@@ -44,8 +46,7 @@ void mpr_tbl_clear(mpr_tbl t)
         mpr_tbl_record rec = &t->rec[i];
         if (!(rec->flags & PROP_OWNED))
             continue;
-        if (rec->key)
-            free((char*)rec->key);
+        FUNC_IF(mpr_str_free, rec->key);
         if (free_vals && rec->val) {
             void *val = (rec->flags & INDIRECT) ? *rec->val : rec->val;
             if (val) {
@@ -87,14 +88,15 @@ static mpr_tbl_record mpr_tbl_add(mpr_tbl t, mpr_prop prop, const char *key,
         t->rec = realloc(t->rec, t->alloced * sizeof(mpr_tbl_record_t));
     }
     rec = &t->rec[t->count-1];
-    if (MPR_PROP_EXTRA == prop)
+    if (MPR_PROP_EXTRA == prop && (flags & PROP_OWNED))
         flags |= MODIFIABLE;
-    rec->key = key ? strdup(key) : 0;
+    rec->key = mpr_str_intern(key);
     rec->prop = prop;
     rec->len = len;
     rec->type = type;
     rec->val = val;
     rec->flags = flags;
+    rec->version = -1;
     return rec;
 }
 
@@ -211,6 +213,7 @@ int mpr_tbl_remove(mpr_tbl t, mpr_prop prop, const char *key, int flags)
                     *rec->val = 0;
                 }
                 rec->prop |= PROP_REMOVE;
+                rec->version = -1;
                 return 1;
             }
             else {
@@ -231,6 +234,7 @@ int mpr_tbl_remove(mpr_tbl t, mpr_prop prop, const char *key, int flags)
             rec->val = 0;
         }
         rec->prop |= PROP_REMOVE;
+        rec->version = -1;
         ret = 1;
     } while (prop == MPR_PROP_EXTRA && strchr(key, '*'));
     return ret;
@@ -247,7 +251,7 @@ void mpr_tbl_clear_empty(mpr_tbl t)
         rec->prop &= ~PROP_REMOVE;
         if (MASK_PROP_BITFLAGS(rec->prop) != MPR_PROP_EXTRA)
             continue;
-        free((char*)rec->key);
+        mpr_str_free(rec->key);
         for (j = rec - t->rec + 1; j < t->count; j++)
             t->rec[j-1] = t->rec[j];
         --t->count;
@@ -349,6 +353,8 @@ int set_internal(mpr_tbl t, mpr_prop prop, const char *key, int len,
         }
         else
             updated = t->dirty = update_elements(rec, len, type, val);
+        if (updated)
+            rec->version = -1;
     }
     else {
         /* Need to add a new entry. */
@@ -378,6 +384,24 @@ void mpr_tbl_link(mpr_tbl t, mpr_prop prop, int len, mpr_type type, void *val, i
     mpr_tbl_add(t, prop, NULL, len, type, val, flags);
 }
 
+void mpr_tbl_link_key(mpr_tbl t, const char *key, int len, mpr_type type, void *val, int flags)
+{
+    RETURN_UNLESS(!mpr_tbl_get(t, MPR_PROP_EXTRA, key));
+    mpr_tbl_add(t, MPR_PROP_EXTRA, key, len, type, val, flags);
+    qsort(t->rec, t->count, sizeof(mpr_tbl_record_t), compare_rec);
+}
+
+void mpr_tbl_unlink_key(mpr_tbl t, const char *key)
+{
+    int i;
+    mpr_tbl_record rec = mpr_tbl_get(t, MPR_PROP_EXTRA, key);
+    RETURN_UNLESS(rec && !(rec->flags & PROP_OWNED));
+    mpr_str_free(rec->key);
+    for (i = rec - t->rec + 1; i < t->count; i++)
+        t->rec[i-1] = t->rec[i];
+    --t->count;
+}
+
 static int update_elements_osc(mpr_tbl_record rec, unsigned int len,
                                const mpr_type *types, lo_arg **args)
 {
@@ -452,6 +476,8 @@ int mpr_tbl_set_from_atom(mpr_tbl t, mpr_msg_atom atom, int flags)
         if (atom->prop & PROP_REMOVE)
             return mpr_tbl_remove(t, atom->prop, atom->key, flags);
         updated = t->dirty = update_elements_osc(rec, atom->len, atom->types, atom->vals);
+        if (updated)
+            rec->version = -1;
     }
     else {
         /* Need to add a new entry. */
@@ -567,6 +593,42 @@ static void mpr_record_add_to_msg(mpr_tbl_record rec, lo_message msg)
         mpr_list_free(list);
 }
 
+void mpr_tbl_stamp(mpr_tbl tbl, int version)
+{
+    int i;
+    for (i = 0; i < tbl->count; i++) {
+        if (tbl->rec[i].version < 0)
+            tbl->rec[i].version = version;
+    }
+}
+
+void mpr_tbl_add_changes_to_msg(mpr_tbl tbl, int version, lo_message msg)
+{
+    int i;
+    for (i = 0; i < tbl->count; i++) {
+        mpr_tbl_record rec = &tbl->rec[i];
+        /* Non-modifiable records (counts, timing statistics) are updated in
+         * place rather than through the table so they are always included. */
+        if (rec->version < 0 || rec->version > version || !(rec->flags & MODIFIABLE))
+            mpr_record_add_to_msg(rec, msg);
+    }
+}
+
+void mpr_tbl_add_config_to_msg(mpr_tbl tbl, lo_message msg)
+{
+    int i;
+    for (i = 0; i < tbl->count; i++) {
+        mpr_tbl_record rec = &tbl->rec[i];
+        /* Read-only records other than lists (status, counts, statistics) and the version
+         * describe the running object rather than how to recreate it. Lists such as the map
+         * scope are read-only here but are set when the object is created. */
+        if (   (!(rec->flags & MODIFIABLE) && MPR_LIST != rec->type)
+            || MPR_PROP_VERSION == MASK_PROP_BITFLAGS(rec->prop))
+            continue;
+        mpr_record_add_to_msg(rec, msg);
+    }
+}
+
 void mpr_tbl_add_to_msg(mpr_tbl tbl, mpr_tbl new, lo_message msg)
 {
     int i;
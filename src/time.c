@@ -40,6 +40,8 @@ int gettimeofday(struct timeval * tp, struct timezone * tzp)
 
 #else
 #include <sys/time.h>
+#include <stdint.h>
+#include <time.h>
 #endif
 
 #include "mapper_internal.h"
@@ -48,16 +50,111 @@ int gettimeofday(struct timeval * tp, struct timezone * tzp)
 
 static double multiplier = 0.00000000023283064365;
 
-/*! Internal function to get the current time. */
-double mpr_get_current_time()
+/* Seconds between the NTP epoch (1900) and the Unix epoch (1970). */
+#define NTP_UNIX_OFFSET 2208988800UL
+
+/*   By default the current time is read from a monotonic clock that is mapped
+ * to NTP time once, when it is first read, so that later adjustments to the
+ * system clock do not make timetags jump. The mapping is fixed for the
+ * lifetime of the process. */
+
+static mpr_time_source *time_source = 0;
+static void *time_source_data = 0;
+
+static int64_t mono_base = -1;          /* monotonic nanoseconds at the mapping */
+static mpr_time ntp_base;               /* NTP time at the mapping */
+
+static int _get_monotonic_ns(int64_t *ns);
+
+/* The mapping may first be needed by several polling threads at once. */
+static void _init_base(void)
+{
+    int64_t ns;
+    RETURN_UNLESS(_get_monotonic_ns(&ns));
+    lo_timetag_now((lo_timetag*)&ntp_base);
+    mono_base = ns;
+}
+
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+static pthread_once_t base_once = PTHREAD_ONCE_INIT;
+#define INIT_BASE()     pthread_once(&base_once, _init_base)
+#else
+#ifdef HAVE_WIN32_THREADS
+#include <windows.h>
+static INIT_ONCE base_once = INIT_ONCE_STATIC_INIT;
+static BOOL CALLBACK _init_base_once(PINIT_ONCE once, PVOID param, PVOID *ctx)
+{
+    _init_base();
+    return TRUE;
+}
+#define INIT_BASE()     InitOnceExecuteOnce(&base_once, _init_base_once, NULL, NULL)
+#else
+#define INIT_BASE()     { if (mono_base < 0) _init_base(); }
+#endif /* HAVE_WIN32_THREADS */
+#endif /* HAVE_LIBPTHREAD */
+
+static int _get_monotonic_ns(int64_t *ns)
 {
-#ifdef HAVE_GETTIMEOFDAY
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return (double)tv.tv_sec + ((double)tv.tv_usec) * 0.000001;
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC_RAW)
+    struct timespec ts;
+    RETURN_ARG_UNLESS(!clock_gettime(CLOCK_MONOTONIC_RAW, &ts), 0);
+    *ns = (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    return 1;
+#else
+#ifdef _MSC_VER
+    static LARGE_INTEGER freq = {0};
+    LARGE_INTEGER count;
+    if (!freq.QuadPart && !QueryPerformanceFrequency(&freq))
+        return 0;
+    QueryPerformanceCounter(&count);
+    *ns = (int64_t)(count.QuadPart / freq.QuadPart) * 1000000000
+          + (int64_t)(count.QuadPart % freq.QuadPart) * 1000000000 / freq.QuadPart;
+    return 1;
 #else
-#error No timing method known on this platform.
+    return 0;
 #endif
+#endif
+}
+
+/* Read the built-in clock, ignoring any time source set by the user. */
+static void _get_monotonic_time(mpr_time *t)
+{
+    int64_t ns;
+    INIT_BASE();
+    if (mono_base < 0 || !_get_monotonic_ns(&ns)) {
+        lo_timetag_now((lo_timetag*)t);
+        return;
+    }
+    ns -= mono_base;
+    ns += ((int64_t)ntp_base.frac * 1000000000) >> 32;
+    t->sec = ntp_base.sec + (uint32_t)(ns / 1000000000);
+    t->frac = (uint32_t)(((ns % 1000000000) << 32) / 1000000000);
+}
+
+void mpr_set_time_source(mpr_time_source *source, void *data)
+{
+    time_source_data = data;
+    time_source = source;
+}
+
+/*! Internal function to get the current time. This always uses the built-in
+ *  clock since it is used for timeouts. */
+double mpr_get_current_time()
+{
+    mpr_time t;
+    _get_monotonic_time(&t);
+    return mpr_time_as_dbl(t) - NTP_UNIX_OFFSET;
+}
+
+/*! Internal function to read the built-in clock in nanoseconds, used for
+ *  timing statistics. Only differences between readings are meaningful. */
+int64_t mpr_get_current_ns()
+{
+    int64_t ns;
+    if (!_get_monotonic_ns(&ns))
+        ns = (int64_t)(mpr_get_current_time() * 1000000000.0);
+    return ns;
 }
 
 double mpr_time_get_diff(const mpr_time l, const mpr_time r)
@@ -135,8 +232,12 @@ void mpr_time_set_dbl(mpr_time *t, double value)
 
 void mpr_time_set(mpr_time *l, mpr_time r)
 {
-    if (r.sec == 0 && r.frac == 1) /* MPR_NOW */
-        lo_timetag_now((lo_timetag*)l);
+    if (r.sec == 0 && r.frac == 1) { /* MPR_NOW */
+        if (time_source)
+            time_source(l, time_source_data);
+        else
+            _get_monotonic_time(l);
+    }
     else
         memcpy(l, &r, sizeof(mpr_time));
 }
@@ -145,3 +246,119 @@ int mpr_time_cmp(mpr_time l, mpr_time r)
 {
     return l.sec == r.sec ? l.frac - r.frac : l.sec - r.sec;
 }
+
+/*   Clock synchronization between linked devices. Each ping exchange gives a
+ * sample of the offset between the local and remote clocks and of the round-
+ * trip delay. As in NTP, the sample with the smallest delay among the recent
+ * ones is the least affected by queuing and is used as the current offset.
+ * Successive filtered offsets are fitted with a line to estimate the drift
+ * between the two clocks, which is used to extrapolate between pings. */
+
+/* Fit drift over at least this many seconds of filtered offsets. */
+#define CLOCK_MIN_SPAN 4.0
+
+/* Largest plausible drift between two clocks (500 ppm, as in NTP). */
+#define CLOCK_MAX_RATE 0.0005
+
+void mpr_sync_clock_init(mpr_sync_clock clk)
+{
+    clk->rate = clk->offset = clk->latency = clk->jitter = clk->offset_time = 0;
+    clk->num_samples = clk->num_points = 0;
+    clk->new = 1;
+}
+
+static void _estimate_rate(mpr_sync_clock clk)
+{
+    int i, n = clk->num_points < CLOCK_NUM_POINTS ? clk->num_points : CLOCK_NUM_POINTS;
+    double min_t, max_t, mean_t = 0, mean_o = 0, var_t = 0, cov = 0;
+    mpr_sync_sample_t *p = clk->points;
+
+    if (n < 3) {
+        clk->rate = 0;
+        return;
+    }
+    min_t = max_t = p[0].time;
+    for (i = 0; i < n; i++) {
+        mean_t += p[i].time;
+        mean_o += p[i].offset;
+        if (p[i].time < min_t)
+            min_t = p[i].time;
+        else if (p[i].time > max_t)
+            max_t = p[i].time;
+    }
+    if (max_t - min_t < CLOCK_MIN_SPAN) {
+        clk->rate = 0;
+        return;
+    }
+    mean_t /= n;
+    mean_o /= n;
+    for (i = 0; i < n; i++) {
+        double dt = p[i].time - mean_t;
+        var_t += dt * dt;
+        cov += dt * (p[i].offset - mean_o);
+    }
+    clk->rate = cov / var_t;
+    if (clk->rate > CLOCK_MAX_RATE)
+        clk->rate = CLOCK_MAX_RATE;
+    else if (clk->rate < -CLOCK_MAX_RATE)
+        clk->rate = -CLOCK_MAX_RATE;
+}
+
+void mpr_sync_clock_add_sample(mpr_sync_clock clk, mpr_time sent, mpr_time rcvd,
+                               mpr_time remote, double hold)
+{
+    int i, n;
+    double jitter = 0;
+    mpr_sync_sample_t *smp, *best, *last;
+    double delay = mpr_time_get_diff(rcvd, sent) - hold;
+
+    if (delay < 0) {
+        trace("error: round-trip delay %f cannot be < 0.\n", delay);
+        delay = 0;
+    }
+    if (clk->new)
+        mpr_time_set(&clk->ref, rcvd);
+
+    smp = &clk->samples[clk->num_samples % CLOCK_NUM_SAMPLES];
+    ++clk->num_samples;
+    smp->time = mpr_time_get_diff(rcvd, clk->ref);
+    smp->delay = delay;
+    /* assume symmetrical latency */
+    smp->offset = mpr_time_get_diff(rcvd, remote) - delay * 0.5;
+
+    /* choose the recent sample with the smallest round-trip delay */
+    n = clk->num_samples < CLOCK_NUM_SAMPLES ? clk->num_samples : CLOCK_NUM_SAMPLES;
+    best = &clk->samples[0];
+    for (i = 1; i < n; i++) {
+        if (clk->samples[i].delay < best->delay)
+            best = &clk->samples[i];
+    }
+    for (i = 0; i < n; i++) {
+        double diff = clk->samples[i].offset - best->offset;
+        jitter += diff * diff;
+    }
+    clk->jitter = sqrt(jitter / n);
+
+    /* only fit each filtered sample once */
+    last = clk->num_points ? &clk->points[(clk->num_points - 1) % CLOCK_NUM_POINTS] : 0;
+    if (!last || last->time != best->time) {
+        memcpy(&clk->points[clk->num_points % CLOCK_NUM_POINTS], best, sizeof(mpr_sync_sample_t));
+        ++clk->num_points;
+        _estimate_rate(clk);
+    }
+
+    clk->offset = best->offset;
+    clk->offset_time = best->time;
+    clk->latency = best->delay * 0.5;
+    clk->new = 0;
+}
+
+void mpr_sync_clock_to_local(mpr_sync_clock clk, mpr_time *t)
+{
+    double offset;
+    RETURN_UNLESS(!clk->new);
+    /* extrapolate the offset to the local time corresponding to t */
+    offset = clk->offset;
+    offset += clk->rate * (mpr_time_get_diff(*t, clk->ref) + offset - clk->offset_time);
+    mpr_time_add_dbl(t, offset);
+}
@@ -70,6 +70,7 @@ typedef struct {
     mpr_prop prop;
     mpr_type type;
     char flags;
+    int version;    /*!< Device revision of the last change, or -1 if not yet stamped. */
 } mpr_tbl_record_t, *mpr_tbl_record;
 
 /*! Used to hold look-up tables. */
@@ -100,10 +101,22 @@ typedef struct _mpr_subscription {
     mpr_dev dev;
     int flags;
     uint32_t lease_expiration_sec;
+    lo_server group;        /*!< Server joined to the device's subscriber group, or NULL. */
+    char *group_url;        /*!< URL of the subscriber group, or NULL. */
+    int synced_flags;       /*!< Flags of the last subscribe sent, 0 if none. */
+    int heap_pos;           /*!< 1-based position in the graph's deadline heap, 0 if none. */
 } *mpr_subscription;
 
+/*! An entry in the graph's housekeeping heap, ordered by deadline. */
+typedef struct _mpr_deadline {
+    uint32_t sec;           /*!< Time at which the entry should be checked. */
+    int type;               /*!< Device expiry or subscription renewal. */
+    void *obj;              /*!< The device or subscription concerned. */
+} mpr_deadline_t, *mpr_deadline;
+
 #define SERVER_BUS      0   /* Multicast comms. */
 #define SERVER_MESH     1   /* Mesh comms. */
+#define SERVER_MESH_TCP 2   /* Mesh comms over TCP, used for bulk metadata. */
 
 #define SERVER_UDP      0
 #define SERVER_TCP      1
@@ -112,12 +125,13 @@ typedef struct _mpr_subscription {
 typedef struct _mpr_net {
     struct _mpr_graph *graph;
 
-    lo_server servers[2];
+    lo_server servers[3];
 
     struct {
         lo_address bus;             /*!< LibLo address for the multicast bus. */
         lo_address dst;
         struct _mpr_local_dev *dev;
+        struct _mpr_dev *batch;     /*!< Destination device of a batch of map definitions. */
         char *url;
     } addr;
 
@@ -143,7 +157,12 @@ typedef struct _mpr_net {
     int num_devs;
     uint32_t next_bus_ping;
     uint32_t next_sub_ping;
+    double next_link_ping;          /*!< Time of the next clock sync ping to linked devices. */
+    double ping_interval;           /*!< Seconds between clock sync pings. */
     uint8_t generic_dev_methods_added;
+    uint8_t bulk;                   /*!< 1 if the bundle is a compressed bulk transfer. */
+    int num_batches;                /*!< Number of map batches sent. */
+    lo_message batch_ack;           /*!< Acknowledgement of the map batch being handled. */
 } mpr_net_t, *mpr_net;
 
 /**** Messages ****/
@@ -168,6 +187,9 @@ typedef enum {
     MSG_UNMAP,
     MSG_UNMAPPED,
     MSG_WHO,
+    MSG_BULK,
+    MSG_MAP_BATCH,
+    MSG_MAPPED_BATCH,
     NUM_MSG_STRINGS
 } net_msg_t;
 
@@ -193,6 +215,8 @@ typedef struct _mpr_allocated_t {
     uint8_t locked;             /*!< Whether or not the value has been locked (allocated). */
     uint8_t online;             /*!< Whether or not we are connected to the
                                  *   distributed allocation network. */
+    uint8_t probe;              /*!< Whether a probe for val is waiting to be sent. */
+    uint8_t fast;               /*!< Whether to lock early if there are no collisions. */
 } mpr_allocated_t, *mpr_allocated;
 
 /*! Clock and timing information. */
@@ -201,13 +225,28 @@ typedef struct _mpr_sync_time_t {
     int msg_id;
 } mpr_sync_time_t;
 
+#define CLOCK_NUM_SAMPLES   8       /* ping samples considered by the delay filter */
+#define CLOCK_NUM_POINTS    16      /* filtered offsets used to estimate drift */
+
+typedef struct _mpr_sync_sample_t {
+    double time;                    /*!< Local time of the sample relative to the clock reference. */
+    double offset;                  /*!< Local minus remote time, latency compensated. */
+    double delay;                   /*!< Round-trip network delay. */
+} mpr_sync_sample_t;
+
 typedef struct _mpr_sync_clock_t {
-    double rate;
-    double offset;
-    double latency;
-    double jitter;
+    double rate;                    /*!< Change in offset per second of local time. */
+    double offset;                  /*!< Local minus remote time at offset_time. */
+    double latency;                 /*!< One-way latency of the best recent sample. */
+    double jitter;                  /*!< RMS difference between recent and best offsets. */
+    double offset_time;             /*!< Local time of the offset relative to ref. */
+    mpr_time ref;                   /*!< Local time of the first sample. */
     mpr_sync_time_t sent;
     mpr_sync_time_t rcvd;
+    mpr_sync_sample_t samples[CLOCK_NUM_SAMPLES];
+    mpr_sync_sample_t points[CLOCK_NUM_POINTS];
+    int num_samples;
+    int num_points;
     int new;
 } mpr_sync_clock_t, *mpr_sync_clock;
 
@@ -216,9 +255,12 @@ typedef struct _mpr_subscriber {
     lo_address addr;
     uint32_t lease_exp;
     int flags;
+    int in_group;           /*!< 1 if the subscriber listens on the device's group. */
+    lo_address bulk_addr;   /*!< TCP address for compressed metadata, or NULL. */
 } *mpr_subscriber;
 
 #define TIMEOUT_SEC 10              /* timeout after 10 seconds without ping */
+#define PING_INTERVAL 2.0           /* default seconds between clock sync pings */
 
 /**** Thread handling ****/
 
@@ -235,6 +277,12 @@ typedef struct _mpr_thread_data {
     volatile int is_done;
 } mpr_thread_data_t, *mpr_thread_data;
 
+/*! Event loop for blocking polls, opaque outside of reactor.c. */
+typedef struct _mpr_reactor *mpr_reactor;
+
+/*! Threads for evaluating maps concurrently, opaque outside of pool.c. */
+typedef struct _mpr_eval_pool *mpr_eval_pool;
+
 /**** Object ****/
 
 typedef struct _mpr_obj
@@ -259,7 +307,18 @@ typedef struct _mpr_graph {
     /*! Linked-list of autorenewing device subscriptions. */
     mpr_subscription subscriptions;
 
+    /*! Subscriptions removed while receiving on their group, freed afterwards. */
+    mpr_subscription left_subscriptions;
+
+    /*! Min-heap of device expiry and subscription renewal deadlines. */
+    struct {
+        mpr_deadline_t *entries;
+        int len;
+        int size;
+    } deadlines;
+
     mpr_thread_data thread_data;
+    mpr_reactor reactor;
 
     /*! Flags indicating whether information on signals and mappings should
      *  be automatically subscribed to when a new device is seen.*/
@@ -267,6 +326,8 @@ typedef struct _mpr_graph {
 
     int own;
     int staged_maps;
+    uint8_t recv_groups;            /*!< 1 while receiving on subscriber groups. */
+    uint8_t tcp_open;               /*!< 1 once messages have arrived over TCP. */
 
     uint32_t resource_counter;
 } mpr_graph_t, *mpr_graph;
@@ -334,8 +395,8 @@ typedef struct _mpr_sig_idmap
 
 #define MPR_SIG_STRUCT_ITEMS                                                            \
     mpr_obj_t obj;              /* always first */                                      \
-    char *path;                 /*! OSC path.  Must start with '/'. */                  \
-    char *name;                 /*! The name of this signal (path+1). */                \
+    const char *path;           /*! Interned OSC path.  Must start with '/'. */         \
+    const char *name;           /*! The name of this signal (path+1). */                \
     char *unit;                 /*!< The unit of this signal, or NULL for N/A. */       \
     float period;               /*!< Estimate of the update rate of this signal. */     \
     float jitter;               /*!< Estimate of the timing jitter of this signal. */   \
@@ -379,10 +440,73 @@ typedef struct _mpr_local_sig
     uint8_t updated;                /* TODO: fold into updated_inst bitflags. */
 } mpr_local_sig_t, *mpr_local_sig;
 
+/**** Statistics ****/
+
+/* Indices of the counters exposed as the read-only int64 vector property
+ * "@stats" when statistics are enabled using mpr_dev_set_stats(). */
+enum {
+    DEV_STAT_UPDATES_IN,            /*!< Signal update messages received. */
+    DEV_STAT_UPDATES_OUT,           /*!< Signal update messages sent. */
+    DEV_STAT_DROPPED,               /*!< Received messages that were discarded. */
+    DEV_STAT_OUT_OF_ORDER,          /*!< Updates older than the current instance value. */
+    DEV_STAT_INST_STOLEN,           /*!< Instances released to make room for others. */
+    DEV_STAT_BUNDLES_SENT,          /*!< Bundles sent over all links. */
+    DEV_STAT_BYTES_SENT,            /*!< Serialized size of the bundles sent. */
+    NUM_DEV_STATS
+};
+
+/* Expression evaluation times are counted in bins of increasing width: bin 0
+ * holds evaluations under 1us, bin n those under 4^n us, and the last bin all
+ * slower evaluations. */
+#define NUM_EVAL_TIME_BINS 8
+
+enum {
+    MAP_STAT_UPDATES_IN,            /*!< Source values received. */
+    MAP_STAT_UPDATES_OUT,           /*!< Destination updates sent or applied. */
+    MAP_STAT_EVALS,                 /*!< Expression evaluations. */
+    MAP_STAT_EVAL_NS,               /*!< Total evaluation time in nanoseconds. */
+    MAP_STAT_EVAL_TIME_BINS,        /*!< First bin of the evaluation time histogram. */
+    NUM_MAP_STATS = MAP_STAT_EVAL_TIME_BINS + NUM_EVAL_TIME_BINS
+};
+
+enum {
+    LINK_STAT_MSGS_SENT,            /*!< Messages sent over the link. */
+    LINK_STAT_BUNDLES_SENT,         /*!< Bundles sent over the link. */
+    LINK_STAT_BYTES_SENT,           /*!< Serialized size of the bundles sent. */
+    NUM_LINK_STATS
+};
+
+/* Latencies of traced updates are counted in bins of increasing width: bin n
+ * holds latencies under 10us * 4^n, and the last bin all longer latencies. */
+#define NUM_LATENCY_BINS 10
+
+/* Indices of the counters exposed as the read-only int64 vector property
+ * "@latency" when tracing is enabled using mpr_dev_set_tracing(). */
+enum {
+    LATENCY_NUM_TRACED,             /*!< Traced updates received. */
+    LATENCY_ORIGIN_US,              /*!< Total latency since the originating update. */
+    LATENCY_HOP_US,                 /*!< Total latency since the update was sent. */
+    LATENCY_ORIGIN_BINS,            /*!< First bin of the latency since the origin. */
+    LATENCY_HOP_BINS = LATENCY_ORIGIN_BINS + NUM_LATENCY_BINS,
+    NUM_LATENCY_STATS = LATENCY_HOP_BINS + NUM_LATENCY_BINS
+};
+
+/*! Trace metadata appended to signal updates as the "@tr" property. */
+typedef struct _mpr_trace {
+    mpr_id id;                      /*!< Trace id, or zero if the update is not traced. */
+    mpr_time origin;                /*!< Time of the originating update, in local time. */
+} mpr_trace_t, *mpr_trace;
+
 /**** Router ****/
 
+/*! Messages queued for a link. UDP messages are serialized into a buffer that
+ *  is reused from one bundle to the next, TCP messages are bundled by liblo. */
 typedef struct _mpr_bundle {
-    lo_bundle udp;
+    char *buf;                      /*!< Serialized UDP bundle. */
+    size_t len;                     /*!< Length of the serialized bundle, zero if empty. */
+    size_t size;                    /*!< Allocated size of buf. */
+    int num_msgs;                   /*!< Number of messages in buf. */
+    mpr_time time;                  /*!< Timestamp of the serialized bundle. */
     lo_bundle tcp;
 } mpr_bundle_t, *mpr_bundle;
 
@@ -399,13 +523,22 @@ typedef struct _mpr_link {
         lo_address admin;               /*!< Network address of remote endpoint */
         lo_address udp;                 /*!< Network address of remote endpoint */
         lo_address tcp;                 /*!< Network address of remote endpoint */
+        void *udp_sock;                 /*!< Resolved socket address of the UDP endpoint */
+        int udp_sock_len;
     } addr;
 
     int is_local_only;
 
     mpr_bundle_t bundles[NUM_BUNDLES];  /*!< Circular buffer to handle interrupts during poll() */
 
+    /* buffers swapped with a bundle while it is dispatched to local devices */
+    char *spare_buf;
+    size_t spare_size;
+    lo_arg **argv;
+    int argv_size;
+
     mpr_sync_clock_t clock;
+    int64_t *stats;                     /*!< Runtime statistics, if enabled. */
 } mpr_link_t, *mpr_link;
 
 /**** Maps and Slots ****/
@@ -450,7 +583,9 @@ typedef struct _mpr_local_slot {
     int protocol;                   /*!< Data transport protocol. */            \
     int use_inst;                   /*!< 1 if using instances, 0 otherwise. */  \
     int is_local;                                                               \
-    int bundle;
+    int bundle;                                                                 \
+    int batch;                      /*!< Batch awaiting acknowledgement. */     \
+    int batch_idx;                  /*!< Position in the batch. */
 
 /*! A record that describes the properties of a mapping.
  *  @ingroup map */
@@ -473,10 +608,15 @@ typedef struct _mpr_local_map {
     const char **var_names;         /*!< User variables names. */
     int num_vars;                   /*!< Number of user variables. */
     int num_inst;                   /*!< Number of local instances. */
+    uint8_t *eval_status;           /*!< Evaluation status of each instance. */
+    mpr_type *eval_types;           /*!< Output types of each evaluated instance. */
+    int64_t *stats;                 /*!< Runtime statistics, if enabled. */
+    mpr_trace_t trace;              /*!< Trace of the latest source update. */
 
     uint8_t is_local_only;
     uint8_t one_src;
     uint8_t updated;
+    uint8_t evaluated;              /*!< 1 if evaluated but not yet sent or received. */
 } mpr_local_map_t, *mpr_local_map;
 
 /*! The rtr_sig is a linked list containing a signal and a list of mapping
@@ -519,7 +659,7 @@ typedef struct _mpr_id_map {
     mpr_obj_t obj;      /* always first */                              \
     mpr_dev *linked;                                                    \
     char *prefix;       /*!< The identifier (prefix) for this device. */\
-    char *name;         /*!< The full name for this device, or zero. */ \
+    const char *name;   /*!< The interned full name, or zero. */        \
     mpr_time synced;    /*!< Timestamp of last sync. */                 \
     int ordinal;                                                        \
     int num_inputs;     /*!< Number of associated input signals. */     \
@@ -529,6 +669,7 @@ typedef struct _mpr_id_map {
     int num_linked;     /*!< Number of linked devices. */               \
     int status;                                                         \
     uint8_t subscribed;                                                 \
+    int heap_pos;       /*!< 1-based position in the deadline heap. */  \
     int is_local;
 
 /*! A record that keeps information about a device. */
@@ -543,10 +684,15 @@ struct _mpr_local_dev {
 
     mpr_allocated_t ordinal_allocator;  /*!< A unique ordinal for this device instance. */
     int registered;                     /*!< Non-zero if this device has been registered. */
+    char *reg_cache;                    /*!< File storing ordinals for fast registration. */
 
     int n_output_callbacks;
 
     mpr_subscriber subscribers;         /*!< Linked-list of subscribed peers. */
+    int maps_version;                   /*!< Device revision of the last map change. */
+    int removed_version;                /*!< Device revision of the last removed object or property. */
+    lo_address sub_group;               /*!< Multicast group shared by subscribers. */
+    char *sub_group_url;                /*!< URL of the subscriber group, advertised as @group. */
 
     struct {
         struct _mpr_id_map **active;    /*!< The list of active instance id maps. */
@@ -555,6 +701,13 @@ struct _mpr_local_dev {
 
     mpr_expr_stack expr_stack;
     mpr_thread_data thread_data;
+    mpr_reactor reactor;                /*!< Event loop used for blocking polls. */
+    void *pool_worker;                  /*!< Shared polling thread, if any. */
+    mpr_eval_pool eval_pool;            /*!< Threads for evaluating maps, if enabled. */
+    int64_t *stats;                     /*!< Runtime statistics, if enabled. */
+    int64_t *latency;                   /*!< Latency of traced updates, if enabled. */
+    mpr_trace_t trace;                  /*!< Trace of the update being processed. */
+    uint32_t trace_count;
 
     mpr_time time;
     int num_sig_groups;
@@ -563,6 +716,8 @@ struct _mpr_local_dev {
     uint8_t bundle_idx;
     uint8_t sending;
     uint8_t receiving;
+    volatile uint8_t wake_pending;      /*!< 1 if the reactor has been woken for sending. */
+    uint8_t tcp_open;                   /*!< 1 once messages have arrived over TCP. */
 };
 
 /**** Messages ****/
@@ -12,8 +12,10 @@
 
 MPR_INLINE static int _min(int a, int b) { return a < b ? a : b; }
 
+/* Existing samples are kept unless the vector length or type changes, so that history and
+ * variable state survive changes to the expression or the number of instances. */
 void mpr_value_realloc(mpr_value v, unsigned int vlen, mpr_type type, unsigned int mlen,
-                       unsigned int num_inst, int is_input)
+                       unsigned int num_inst)
 {
     int i, samp_size;
     mpr_value_buffer_t *b, tmp;
@@ -37,7 +39,7 @@ void mpr_value_realloc(mpr_value v, unsigned int vlen, mpr_type type, unsigned i
         }
     }
 
-    if (!is_input || vlen != v->vlen || type != v->type) {
+    if (vlen != v->vlen || type != v->type) {
         /* reallocate old instances (v->num_inst has not yet been updated) */
         for (i = 0; i < v->num_inst; i++) {
             b = &v->inst[i];
@@ -55,40 +57,25 @@ void mpr_value_realloc(mpr_value v, unsigned int vlen, mpr_type type, unsigned i
     if (mlen == v->mlen)
         goto done;
 
-    /* only the memory size is different */
-
+    /* only the memory size is different: keep the newest samples in chronological order */
     for (i = 0; i < v->num_inst; i++) {
+        int j, num_samps, start;
         b = &v->inst[i];
-        tmp.samps = malloc(samp_size * mlen);
-        tmp.times = malloc(sizeof(mpr_time) * mlen);
-
-        /* TODO: don't bother copying memory if pos is -1 */
-        if (mlen > v->mlen) {
-            int opos = b->pos < 0 ? 0 : b->pos;
-            int npos = v->mlen - opos;
-            /* copy from [v->pos, v->mlen] to [0, v->mlen - v->pos] */
-            memcpy(tmp.samps, (char*)b->samps + opos * samp_size, npos * samp_size);
-            memcpy(tmp.times, &b->times[opos], npos * sizeof(mpr_time));
-            /* copy from [0, v->pos] to [v->mlen - v->pos, v->mlen] */
-            memcpy((char*)tmp.samps + npos * samp_size, b->samps, opos * samp_size);
-            memcpy(&tmp.times[npos], b->times, opos * sizeof(mpr_time));
-            /* zero remainder */
-            memset((char*)tmp.samps + v->mlen * samp_size, 0, (mlen - v->mlen) * samp_size);
-            memset(&tmp.times[v->mlen], 0, (mlen - v->mlen) * sizeof(mpr_time));
-            b->pos = b->pos < 0 ? -1 : v->mlen;
-            b->full = 0;
-        }
-        else {
-            int opos = b->pos < 0 ? 0 : b->pos;
-            int len = _min(v->mlen - opos, mlen);
-            memcpy(tmp.samps, (char*)b->samps + opos * samp_size, len * samp_size);
-            memcpy(tmp.times, &b->times[opos], len * sizeof(mpr_time));
-            if (mlen > len) {
-                memcpy((char*)tmp.samps + len * samp_size, b->samps, (mlen - len) * samp_size);
-                memcpy(&tmp.times[len], b->times, (mlen - len) * sizeof(mpr_time));
+        tmp.samps = calloc(1, samp_size * mlen);
+        tmp.times = calloc(1, sizeof(mpr_time) * mlen);
+
+        if (b->pos >= 0) {
+            num_samps = _min(b->full ? v->mlen : b->pos + 1, mlen);
+            /* index of the oldest sample to keep */
+            start = (b->pos - num_samps + 1 + v->mlen) % v->mlen;
+            for (j = 0; j < num_samps; j++) {
+                int k = (start + j) % v->mlen;
+                memcpy((char*)tmp.samps + j * samp_size, (char*)b->samps + k * samp_size,
+                       samp_size);
+                tmp.times[j] = b->times[k];
             }
-            b->pos = b->pos < 0 ? -1 : len;
-            b->full = (b->pos > mlen);
+            b->pos = num_samps - 1;
+            b->full = (num_samps == mlen);
         }
 
         free(b->samps);
@@ -0,0 +1,257 @@
+#include <mapper/mapper.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <string.h>
+
+/* Check that updating signals with established maps does not allocate memory,
+ * by counting calls to the allocator while updates are sent. */
+
+#define NUM_INST 4
+#define VEC_LEN 4
+
+#if defined(__GLIBC__) && !defined(WIN32)
+#define COUNT_ALLOCS
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t num, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static volatile long num_allocs = 0;
+
+void *malloc(size_t size)
+{
+    ++num_allocs;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t num, size_t size)
+{
+    ++num_allocs;
+    return __libc_calloc(num, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    ++num_allocs;
+    return __libc_realloc(ptr, size);
+}
+#endif
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+int iterations = 1000;
+
+mpr_graph graph = 0;
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig sendsig = 0;
+mpr_sig recvsig = 0;
+mpr_sig sendsig_inst = 0;
+mpr_sig recvsig_inst = 0;
+
+int received = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    if (value)
+        ++received;
+}
+
+int setup(const char *iface, int shared)
+{
+    float mn = 0, mx = 1;
+    int num_inst = NUM_INST;
+
+    /* devices sharing a graph update each other in-process */
+    graph = shared ? mpr_graph_new(0) : 0;
+    if (graph && iface)
+        mpr_graph_set_interface(graph, iface);
+
+    src = mpr_dev_new("testalloc-send", graph);
+    dst = mpr_dev_new("testalloc-recv", graph);
+    if (!src || !dst)
+        return 1;
+    if (iface && !graph) {
+        mpr_graph_set_interface(mpr_obj_get_graph(src), iface);
+        mpr_graph_set_interface(mpr_obj_get_graph(dst), iface);
+    }
+    eprintf("devices created using interface %s.\n",
+            mpr_graph_get_interface(mpr_obj_get_graph(src)));
+
+    sendsig = mpr_sig_new(src, MPR_DIR_OUT, "outsig", VEC_LEN, MPR_FLT, NULL,
+                          &mn, &mx, NULL, NULL, 0);
+    recvsig = mpr_sig_new(dst, MPR_DIR_IN, "insig", VEC_LEN, MPR_FLT, NULL,
+                          &mn, &mx, NULL, handler, MPR_SIG_UPDATE);
+    sendsig_inst = mpr_sig_new(src, MPR_DIR_OUT, "outsig_inst", 1, MPR_FLT, NULL,
+                               &mn, &mx, &num_inst, NULL, 0);
+    recvsig_inst = mpr_sig_new(dst, MPR_DIR_IN, "insig_inst", 1, MPR_FLT, NULL,
+                               &mn, &mx, &num_inst, handler, MPR_SIG_UPDATE);
+    return 0;
+}
+
+void cleanup()
+{
+    if (src) {
+        eprintf("Freeing source.. ");
+        fflush(stdout);
+        mpr_dev_free(src);
+        eprintf("ok\n");
+    }
+    if (dst) {
+        eprintf("Freeing destination.. ");
+        fflush(stdout);
+        mpr_dev_free(dst);
+        eprintf("ok\n");
+    }
+    if (graph)
+        mpr_graph_free(graph);
+    graph = 0;
+    src = dst = 0;
+}
+
+int setup_maps()
+{
+    mpr_map maps[2];
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst))) {
+        mpr_dev_poll(src, 25);
+        mpr_dev_poll(dst, 25);
+    }
+
+    maps[0] = mpr_map_new(1, &sendsig, 1, &recvsig);
+    mpr_obj_set_prop(maps[0], MPR_PROP_EXPR, NULL, 1, MPR_STR, "y=x*0.5+y{-1}*0.5", 1);
+    mpr_obj_push(maps[0]);
+    maps[1] = mpr_map_new(1, &sendsig_inst, 1, &recvsig_inst);
+    mpr_obj_push(maps[1]);
+    while (!done && !(mpr_map_get_is_ready(maps[0]) && mpr_map_get_is_ready(maps[1]))) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+    }
+    eprintf("maps initialized\n");
+    return done;
+}
+
+void update(int i)
+{
+    int j;
+    float v[VEC_LEN];
+    for (j = 0; j < VEC_LEN; j++)
+        v[j] = (i + j) % 10 * 0.1f;
+    mpr_sig_set_value(sendsig, 0, VEC_LEN, MPR_FLT, v);
+    for (j = 0; j < NUM_INST; j++)
+        mpr_sig_set_value(sendsig_inst, j, 1, MPR_FLT, &v[j]);
+    mpr_dev_update_maps(src);
+}
+
+int run(int shared)
+{
+    int i;
+    long allocs = 0;
+
+    /* the first updates activate instances and size the buffers */
+    received = 0;
+    for (i = 0; i < 20 && !done; i++) {
+        update(i);
+        mpr_dev_poll(dst, 10);
+    }
+    if (!received) {
+        eprintf("Error: no updates received.\n");
+        return 1;
+    }
+
+#ifdef COUNT_ALLOCS
+    allocs = num_allocs;
+#endif
+    /* messages received from the network are not counted, only the updates */
+    for (i = 0; i < iterations && !done; i++)
+        update(i);
+#ifdef COUNT_ALLOCS
+    allocs = num_allocs - allocs;
+#endif
+
+    mpr_dev_poll(dst, 100);
+    eprintf("%s: %ld allocations during %d updates\n", shared ? "in-process" : "udp",
+            allocs, iterations * (NUM_INST + 1));
+    return allocs != 0;
+}
+
+void ctrlc(int signal)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, shared, result = 0;
+    char *iface = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testalloc.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'f':
+                        iterations = 100;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface")==0 && argc>i+1) {
+                            i++;
+                            iface = argv[i];
+                            j = 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+#ifndef COUNT_ALLOCS
+    eprintf("Counting allocations is not supported on this platform.\n");
+#endif
+
+    for (shared = 0; shared < 2 && !result && !done; shared++) {
+        if (setup(iface, shared) || setup_maps()) {
+            eprintf("Error initializing test.\n");
+            result = 1;
+        }
+        else
+            result = run(shared);
+        cleanup();
+    }
+
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -82,6 +82,17 @@ void simple_handler(Signal&& sig, int length, Type type, const void *value, Time
     std::cout << std::endl;
 }
 
+void span_handler(Signal&& sig, Span<const int> value, Time&& t)
+{
+    ++received;
+    if (!verbose)
+        return;
+    std::cout << "\t\t\t\t\t   | --> signal update:" << sig[Property::NAME];
+    for (int v : value)
+        std::cout << " " << v;
+    std::cout << std::endl;
+}
+
 void standard_handler(Signal&& sig, Signal::Event event, Id instance, int length,
                       Type type, const void *value, Time&& t)
 {
@@ -237,7 +248,7 @@ int main(int argc, char ** argv)
                     .set_callback(standard_handler);
     dev.remove_signal(sig);
     dev.add_signal(Direction::INCOMING, "in2", 2, Type::INT32).set_callback(standard_handler);
-    dev.add_signal(Direction::INCOMING, "in3", 2, Type::INT32).set_callback(standard_handler);
+    dev.add_signal(Direction::INCOMING, "in3", 2, Type::INT32).set_callback(span_handler);
     dev.add_signal(Direction::INCOMING, "in4", 2, Type::INT32).set_callback(simple_handler);
 
     sig = dev.add_signal(Direction::OUTGOING, "out1", 1, Type::FLOAT, "na");
@@ -369,7 +380,10 @@ int main(int argc, char ** argv)
             Signal s = *dev.signals().filter(Property::NAME, "in4", Operator::EQUAL);
             s.set_callback(standard_handler);
         }
-        sig.set_value(v);
+        if (i % 2)
+            sig.set_value(v);
+        else
+            sig.set_value(Span<const double>(&v[0], v.size()));
         graph.poll(period);
     }
     dev.stop();
@@ -0,0 +1,241 @@
+#include <mapper/mapper.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+
+/* Drive a device from an external poll() loop using mpr_dev_get_fds(),
+ * mpr_dev_get_timeout() and mpr_dev_on_readable() instead of mpr_dev_poll(). */
+
+#define MAX_FDS 8
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+int period = 100;
+
+mpr_dev dev = 0;
+mpr_sig sendsig = 0;
+mpr_sig recvsig = 0;
+
+int sent = 0;
+int received = 0;
+int expected;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    if (!value)
+        return;
+    eprintf("handler: signal %s got value %d, time %f\n",
+            mpr_obj_get_prop_as_str(sig, MPR_PROP_NAME, 0),
+            (*(int*)value), mpr_time_as_dbl(t));
+    if (*(int*)value == expected)
+        received++;
+    else
+        eprintf(" expected %d\n", expected);
+}
+
+static double current_time()
+{
+    mpr_time t;
+    mpr_time_set(&t, MPR_NOW);
+    return mpr_time_as_dbl(t);
+}
+
+/* Wait for at most block_ms in poll() on the device sockets, then let the
+ * device process whatever is ready. */
+int run_loop(int block_ms)
+{
+    struct pollfd pfds[MAX_FDS];
+    int fds[MAX_FDS], i, num_fds, timeout, count = 0;
+    double then = current_time(), elapsed = 0;
+
+    while (!done && elapsed < block_ms) {
+        /* the set of sockets may change, e.g. once the device is registered */
+        num_fds = mpr_dev_get_fds(dev, fds, MAX_FDS);
+        if (num_fds > MAX_FDS) {
+            eprintf("Error: device uses %d sockets, expected at most %d.\n", num_fds, MAX_FDS);
+            done = 1;
+            return -1;
+        }
+        for (i = 0; i < num_fds; i++) {
+            pfds[i].fd = fds[i];
+            pfds[i].events = POLLIN;
+            pfds[i].revents = 0;
+        }
+        timeout = mpr_dev_get_timeout(dev);
+        if (timeout > block_ms - elapsed)
+            timeout = block_ms - elapsed;
+        poll(pfds, num_fds, timeout);
+        count += mpr_dev_on_readable(dev);
+        elapsed = (current_time() - then) * 1000;
+    }
+    return count;
+}
+
+int setup(const char *iface)
+{
+    int mni = 0, mxi = 100;
+
+    dev = mpr_dev_new("testeventloop", 0);
+    if (!dev)
+        goto error;
+    if (iface)
+        mpr_graph_set_interface(mpr_obj_get_graph(dev), iface);
+    eprintf("device created using interface %s.\n",
+            mpr_graph_get_interface(mpr_obj_get_graph(dev)));
+
+    sendsig = mpr_sig_new(dev, MPR_DIR_OUT, "outsig", 1, MPR_INT32, NULL,
+                          &mni, &mxi, NULL, NULL, 0);
+    recvsig = mpr_sig_new(dev, MPR_DIR_IN, "insig", 1, MPR_INT32, NULL,
+                          &mni, &mxi, NULL, handler, MPR_SIG_UPDATE);
+    return 0;
+
+  error:
+    return 1;
+}
+
+void cleanup()
+{
+    if (dev) {
+        eprintf("Freeing device.. ");
+        fflush(stdout);
+        mpr_dev_free(dev);
+        eprintf("ok\n");
+    }
+}
+
+int wait_ready()
+{
+    while (!done && !mpr_dev_get_is_ready(dev)) {
+        if (run_loop(25) < 0)
+            return 1;
+    }
+    eprintf("device registered using %d sockets.\n", mpr_dev_get_fds(dev, 0, 0));
+    return done;
+}
+
+int setup_maps()
+{
+    mpr_map map = mpr_map_new(1, &sendsig, 1, &recvsig);
+    mpr_obj_push(map);
+
+    /* Wait until mapping has been established */
+    while (!done && !mpr_map_get_is_ready(map)) {
+        if (run_loop(10) < 0)
+            return 1;
+    }
+    return done;
+}
+
+void loop()
+{
+    int i = 0;
+
+    eprintf("Polling device..\n");
+    while ((!terminate || i < 50) && !done) {
+        expected = i;
+        mpr_sig_set_value(sendsig, 0, 1, MPR_INT32, &i);
+        sent++;
+        run_loop(period);
+        i++;
+
+        if (!verbose) {
+            printf("\r  Sent: %4i, Received: %4i   ", sent, received);
+            fflush(stdout);
+        }
+    }
+}
+
+void ctrlc(int signal)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testeventloop.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'f':
+                        period = 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface")==0 && argc>i+1) {
+                            i++;
+                            iface = argv[i];
+                            j = 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup(iface)) {
+        eprintf("Error initializing device.\n");
+        result = 1;
+        goto done;
+    }
+
+    if (wait_ready() || setup_maps()) {
+        eprintf("Error initializing maps.\n");
+        result = 1;
+        goto done;
+    }
+
+    loop();
+
+    if (!received || sent != received) {
+        eprintf("Not all sent messages were received.\n");
+        eprintf("Updated value %d time%s and received %d of them.\n",
+                sent, sent == 1 ? "" : "s", received);
+        result = 1;
+    }
+
+  done:
+    cleanup();
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
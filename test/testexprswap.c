@@ -0,0 +1,207 @@
+#include <mapper/mapper.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <string.h>
+
+/* Replace the expression of an active map and check that output history and user variables
+ * are kept, i.e. that an accumulating output continues from its value before the change. The
+ * last two cases also change the size of the input and output histories. */
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig sendsig = 0;
+mpr_sig recvsig = 0;
+
+int received = 0;
+float last_val = 0;
+int num_drops = 0;
+
+const char *exprs[][2] = {
+    {"y=y{-1}+x",               "y=y{-1}+x*2"},
+    {"acc=acc{-1}+x; y=acc",    "acc=acc{-1}+x*2; y=acc"},
+    {"y=y{-1}+x",               "y=y{-1}+x+x{-1}"},
+    {"y=y{-1}+x+(y{-3}<0)",     "y=y{-1}+x*2"},
+};
+
+#define NUM_EXPRS (sizeof(exprs) / sizeof(exprs[0]))
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    float v;
+    if (!value)
+        return;
+    v = *(float*)value;
+    if (received && v < last_val) {
+        eprintf("value dropped from %g to %g\n", last_val, v);
+        ++num_drops;
+    }
+    last_val = v;
+    ++received;
+}
+
+int setup(const char *iface)
+{
+    float mn = 0, mx = 1000;
+
+    src = mpr_dev_new("testexprswap-send", 0);
+    dst = mpr_dev_new("testexprswap-recv", 0);
+    if (!src || !dst)
+        return 1;
+    if (iface) {
+        mpr_graph_set_interface(mpr_obj_get_graph(src), iface);
+        mpr_graph_set_interface(mpr_obj_get_graph(dst), iface);
+    }
+    eprintf("devices created using interface %s.\n",
+            mpr_graph_get_interface(mpr_obj_get_graph(src)));
+
+    sendsig = mpr_sig_new(src, MPR_DIR_OUT, "outsig", 1, MPR_FLT, NULL, &mn, &mx, NULL, NULL, 0);
+    recvsig = mpr_sig_new(dst, MPR_DIR_IN, "insig", 1, MPR_FLT, NULL,
+                          &mn, &mx, NULL, handler, MPR_SIG_UPDATE);
+    return 0;
+}
+
+void cleanup()
+{
+    if (src) {
+        eprintf("Freeing source.. ");
+        fflush(stdout);
+        mpr_dev_free(src);
+        eprintf("ok\n");
+    }
+    if (dst) {
+        eprintf("Freeing destination.. ");
+        fflush(stdout);
+        mpr_dev_free(dst);
+        eprintf("ok\n");
+    }
+}
+
+void update()
+{
+    float one = 1;
+    mpr_sig_set_value(sendsig, 0, 1, MPR_FLT, &one);
+    mpr_dev_poll(src, 0);
+    mpr_dev_poll(dst, 10);
+}
+
+int run(int idx)
+{
+    int i;
+    float before;
+    mpr_map map = mpr_map_new(1, &sendsig, 1, &recvsig);
+    mpr_obj_set_prop((mpr_obj)map, MPR_PROP_EXPR, NULL, 1, MPR_STR, exprs[idx][0], 1);
+    mpr_obj_push((mpr_obj)map);
+    while (!done && !mpr_map_get_is_ready(map)) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+    }
+
+    received = num_drops = 0;
+    for (i = 0; i < 10 && !done; i++)
+        update();
+    before = last_val;
+    eprintf("'%s' accumulated %g\n", exprs[idx][0], before);
+
+    mpr_obj_set_prop((mpr_obj)map, MPR_PROP_EXPR, NULL, 1, MPR_STR, exprs[idx][1], 1);
+    mpr_obj_push((mpr_obj)map);
+
+    /* keep updating until the new expression is in use */
+    for (i = 0; i < 100 && !done; i++) {
+        float prev = last_val;
+        update();
+        if (last_val - prev > 1.5)
+            break;
+    }
+    eprintf("'%s' continued to %g\n", exprs[idx][1], last_val);
+
+    mpr_map_release(map);
+    mpr_dev_poll(src, 100);
+    mpr_dev_poll(dst, 100);
+    return done || !received || i == 100 || num_drops || last_val <= before;
+}
+
+void ctrlc(int signal)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testexprswap.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'f':
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface")==0 && argc>i+1) {
+                            i++;
+                            iface = argv[i];
+                            j = 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup(iface)) {
+        eprintf("Error initializing test.\n");
+        result = 1;
+        goto done;
+    }
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst))) {
+        mpr_dev_poll(src, 25);
+        mpr_dev_poll(dst, 25);
+    }
+
+    for (i = 0; i < NUM_EXPRS && !result; i++)
+        result = run(i);
+
+  done:
+    cleanup();
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
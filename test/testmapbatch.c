@@ -0,0 +1,229 @@
+#include <mapper/mapper.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <string.h>
+
+/* Create many maps from a separate graph using mpr_graph_push_maps() and check
+ * that they are acknowledged and established. */
+
+#define NUM_SIGS 100
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+
+mpr_graph graph = 0;
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig sendsigs[NUM_SIGS];
+mpr_sig recvsigs[NUM_SIGS];
+mpr_map maps[NUM_SIGS];
+
+int num_mod = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void on_map(mpr_graph g, mpr_obj o, mpr_graph_evt e, const void *user)
+{
+    if (MPR_OBJ_MOD == e)
+        ++num_mod;
+}
+
+int setup(const char *iface)
+{
+    float mn = 0, mx = 1;
+    char name[32];
+    int i;
+
+    graph = mpr_graph_new(MPR_OBJ);
+    src = mpr_dev_new("testmapbatch-send", 0);
+    dst = mpr_dev_new("testmapbatch-recv", 0);
+    if (!graph || !src || !dst)
+        return 1;
+    if (iface) {
+        mpr_graph_set_interface(graph, iface);
+        mpr_graph_set_interface(mpr_obj_get_graph(src), iface);
+        mpr_graph_set_interface(mpr_obj_get_graph(dst), iface);
+    }
+    eprintf("devices created using interface %s.\n", mpr_graph_get_interface(graph));
+    mpr_graph_add_cb(graph, on_map, MPR_MAP, NULL);
+
+    for (i = 0; i < NUM_SIGS; i++) {
+        snprintf(name, 32, "outsig%d", i);
+        sendsigs[i] = mpr_sig_new(src, MPR_DIR_OUT, name, 1, MPR_FLT, NULL,
+                                  &mn, &mx, NULL, NULL, 0);
+        snprintf(name, 32, "insig%d", i);
+        recvsigs[i] = mpr_sig_new(dst, MPR_DIR_IN, name, 1, MPR_FLT, NULL,
+                                  &mn, &mx, NULL, NULL, 0);
+    }
+    return 0;
+}
+
+void cleanup()
+{
+    if (graph) {
+        eprintf("Freeing graph.. ");
+        fflush(stdout);
+        mpr_graph_free(graph);
+        eprintf("ok\n");
+    }
+    if (src) {
+        eprintf("Freeing source.. ");
+        fflush(stdout);
+        mpr_dev_free(src);
+        eprintf("ok\n");
+    }
+    if (dst) {
+        eprintf("Freeing destination.. ");
+        fflush(stdout);
+        mpr_dev_free(dst);
+        eprintf("ok\n");
+    }
+}
+
+void poll_all(int block_ms)
+{
+    mpr_dev_poll(src, 0);
+    mpr_dev_poll(dst, 0);
+    mpr_graph_poll(graph, block_ms);
+}
+
+/* find the graph's record of a local signal */
+mpr_sig find_sig(mpr_sig sig)
+{
+    mpr_sig found = 0;
+    mpr_id id = mpr_obj_get_prop_as_int64((mpr_obj)sig, MPR_PROP_ID, NULL);
+    mpr_list sigs = mpr_graph_get_list(graph, MPR_SIG);
+    sigs = mpr_list_filter(sigs, MPR_PROP_ID, NULL, 1, MPR_INT64, &id, MPR_OP_EQ);
+    if (sigs) {
+        found = (mpr_sig)*sigs;
+        mpr_list_free(sigs);
+    }
+    return found;
+}
+
+int create_maps()
+{
+    int i, num_found = 0;
+    mpr_sig srcsig, dstsig;
+
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst)))
+        poll_all(25);
+
+    /* wait for the graph to learn about all signals */
+    while (!done && num_found < NUM_SIGS) {
+        poll_all(25);
+        for (i = 0, num_found = 0; i < NUM_SIGS; i++)
+            num_found += find_sig(sendsigs[i]) && find_sig(recvsigs[i]);
+    }
+
+    for (i = 0; i < NUM_SIGS && !done; i++) {
+        srcsig = find_sig(sendsigs[i]);
+        dstsig = find_sig(recvsigs[i]);
+        maps[i] = mpr_map_new(1, &srcsig, 1, &dstsig);
+        if (!maps[i]) {
+            eprintf("Error creating map %d.\n", i);
+            return 1;
+        }
+    }
+    i = mpr_graph_push_maps(graph, NUM_SIGS, maps);
+    eprintf("pushed %d maps in batches\n", i);
+    return done || i != NUM_SIGS;
+}
+
+int wait_maps()
+{
+    int i, num_ready = 0, num_acked = 0, iterations = 0;
+    mpr_list list;
+
+    while (!done && iterations++ < 200 && (num_ready < NUM_SIGS || num_acked < NUM_SIGS)) {
+        poll_all(25);
+        num_ready = 0;
+        list = mpr_dev_get_maps(dst, MPR_DIR_IN);
+        while (list) {
+            num_ready += mpr_map_get_is_ready((mpr_map)*list);
+            list = mpr_list_get_next(list);
+        }
+        /* acknowledged maps carry the id assigned by their destination */
+        for (i = 0, num_acked = 0; i < NUM_SIGS; i++) {
+            int status = mpr_obj_get_prop_as_int32((mpr_obj)maps[i], MPR_PROP_STATUS, NULL);
+            num_acked += (   mpr_obj_get_prop_as_int64((mpr_obj)maps[i], MPR_PROP_ID, NULL)
+                          && MPR_STATUS_EXPIRED != status);
+        }
+    }
+    eprintf("%d of %d maps acknowledged, %d established after %d iterations, "
+            "%d map callbacks\n", num_acked, NUM_SIGS, num_ready, iterations, num_mod);
+    return num_ready != NUM_SIGS || num_acked != NUM_SIGS;
+}
+
+void ctrlc(int signal)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testmapbatch.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'f':
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface")==0 && argc>i+1) {
+                            i++;
+                            iface = argv[i];
+                            j = 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup(iface) || create_maps()) {
+        eprintf("Error initializing test.\n");
+        result = 1;
+    }
+    else
+        result = wait_maps();
+
+    cleanup();
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
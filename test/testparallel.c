@@ -0,0 +1,273 @@
+#include <mapper/mapper.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+#include <signal.h>
+#include <string.h>
+
+/* Evaluate many maps on several threads using mpr_dev_set_eval_threads() and
+ * check that the results and the order in which they arrive are unchanged. */
+
+#define NUM_MAPS 64
+#define NUM_THREADS 4
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+int period = 100;
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig sendsig = 0;
+mpr_sig recvsigs[NUM_MAPS];
+
+int sent = 0;
+int received = 0;
+int errors = 0;
+
+float expected;
+
+/* order in which the destination signals were updated */
+int order[NUM_MAPS];
+int first_order[NUM_MAPS];
+int num_ordered = 0;
+int has_first_order = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    int i;
+    if (!value)
+        return;
+    for (i = 0; i < NUM_MAPS; i++) {
+        if (recvsigs[i] == sig)
+            break;
+    }
+    if (i == NUM_MAPS)
+        return;
+    if (fabs(*(float*)value - (expected + i)) < 0.0001)
+        received++;
+    else {
+        eprintf("handler: signal %d got %f, expected %f\n", i, *(float*)value, expected + i);
+        ++errors;
+    }
+    if (num_ordered < NUM_MAPS)
+        order[num_ordered++] = i;
+}
+
+int setup_devs(const char *iface)
+{
+    int i;
+    float mn = 0, mx = 1;
+    char name[32];
+
+    src = mpr_dev_new("testparallel-send", 0);
+    dst = mpr_dev_new("testparallel-recv", 0);
+    if (!src || !dst)
+        return 1;
+    if (iface) {
+        mpr_graph_set_interface(mpr_obj_get_graph(src), iface);
+        mpr_graph_set_interface(mpr_obj_get_graph(dst), iface);
+    }
+    eprintf("devices created using interface %s.\n",
+            mpr_graph_get_interface(mpr_obj_get_graph(src)));
+
+    sendsig = mpr_sig_new(src, MPR_DIR_OUT, "outsig", 1, MPR_FLT, NULL,
+                          &mn, &mx, NULL, NULL, 0);
+    for (i = 0; i < NUM_MAPS; i++) {
+        snprintf(name, 32, "insig%d", i);
+        recvsigs[i] = mpr_sig_new(dst, MPR_DIR_IN, name, 1, MPR_FLT, NULL,
+                                  &mn, &mx, NULL, handler, MPR_SIG_UPDATE);
+    }
+
+    if (mpr_dev_set_eval_threads(src, NUM_THREADS)) {
+        eprintf("Error creating evaluation threads.\n");
+        return 1;
+    }
+    return 0;
+}
+
+void cleanup_devs()
+{
+    if (src) {
+        eprintf("Freeing source.. ");
+        fflush(stdout);
+        mpr_dev_free(src);
+        eprintf("ok\n");
+    }
+    if (dst) {
+        eprintf("Freeing destination.. ");
+        fflush(stdout);
+        mpr_dev_free(dst);
+        eprintf("ok\n");
+    }
+}
+
+void wait_ready()
+{
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst))) {
+        mpr_dev_poll(src, 25);
+        mpr_dev_poll(dst, 25);
+    }
+}
+
+int setup_maps()
+{
+    int i, ready = 0, loc = MPR_LOC_SRC;
+    char expr[64];
+    mpr_map maps[NUM_MAPS];
+
+    for (i = 0; i < NUM_MAPS; i++) {
+        maps[i] = mpr_map_new(1, &sendsig, 1, &recvsigs[i]);
+        /* process at the source so that evaluation happens on the source device */
+        snprintf(expr, 64, "y=x+%d", i);
+        mpr_obj_set_prop(maps[i], MPR_PROP_EXPR, NULL, 1, MPR_STR, expr, 1);
+        mpr_obj_set_prop(maps[i], MPR_PROP_PROCESS_LOC, NULL, 1, MPR_INT32, &loc, 1);
+        mpr_obj_push(maps[i]);
+    }
+
+    /* Wait until all maps have been established */
+    while (!done && ready < NUM_MAPS) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+        for (i = 0, ready = 0; i < NUM_MAPS; i++)
+            ready += mpr_map_get_is_ready(maps[i]);
+    }
+    eprintf("%d maps initialized\n", NUM_MAPS);
+    return done;
+}
+
+void loop()
+{
+    int i = 0, j, tries;
+    eprintf("Polling device..\n");
+    while ((!terminate || i < 50) && !done) {
+        float v = i;
+        expected = v;
+        num_ordered = 0;
+        mpr_sig_set_value(sendsig, 0, 1, MPR_FLT, &v);
+        sent += NUM_MAPS;
+        mpr_dev_poll(src, 0);
+        mpr_dev_poll(dst, period);
+        for (tries = 0; tries < 10 && num_ordered < NUM_MAPS; tries++)
+            mpr_dev_poll(dst, 10);
+
+        /* messages should always arrive in the same order */
+        if (num_ordered == NUM_MAPS) {
+            if (!has_first_order) {
+                memcpy(first_order, order, sizeof(order));
+                has_first_order = 1;
+            }
+            else if (memcmp(first_order, order, sizeof(order))) {
+                eprintf("Error: update order changed.\n");
+                ++errors;
+            }
+        }
+        i++;
+
+        if (!verbose) {
+            printf("\r  Sent: %4i, Received: %4i   ", sent, received);
+            fflush(stdout);
+        }
+        else {
+            eprintf("received updates for signals:");
+            for (j = 0; j < num_ordered; j++)
+                eprintf(" %d", order[j]);
+            eprintf("\n");
+        }
+    }
+}
+
+void ctrlc(int signal)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testparallel.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'f':
+                        period = 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface")==0 && argc>i+1) {
+                            i++;
+                            iface = argv[i];
+                            j = 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup_devs(iface)) {
+        eprintf("Error initializing devices.\n");
+        result = 1;
+        goto done;
+    }
+
+    wait_ready();
+
+    if (setup_maps()) {
+        eprintf("Error initializing maps.\n");
+        result = 1;
+        goto done;
+    }
+
+    loop();
+
+    /* allow the last updates to arrive */
+    mpr_dev_poll(dst, 100);
+
+    if (errors || !received || sent != received) {
+        eprintf("Not all sent messages were received correctly.\n");
+        eprintf("Sent %d updates and received %d of them, %d errors.\n",
+                sent, received, errors);
+        result = 1;
+    }
+
+  done:
+    cleanup_devs();
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
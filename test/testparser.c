@@ -36,6 +36,19 @@ mpr_type out_types[DST_ARRAY_LEN];
 
 mpr_time time_in = {0, 0}, time_out = {0, 0};
 
+/* lookup tables and curves that can be referenced by expressions */
+#define NUM_TBLS 4
+struct {
+    const char *name;
+    int len;
+    double vals[8];
+} tbls[NUM_TBLS] = {
+    { "lut.steps",  5, {0, 10, 20, 40, 80}          },
+    { "lut.sq",     4, {0, 1, 4, 9}                 },
+    { "curve.knee", 6, {0, 0, 0.5, 1, 1, 4}         },
+    { "curve.sq",   8, {0, 0, 1, 1, 2, 4, 4, 16}    },
+};
+
 /* evaluation stack */
 mpr_expr_stack eval_stk = 0;
 
@@ -294,11 +307,13 @@ int parse_and_eval(int expectation, int max_tokens, int check, int exp_updates)
         result = 1;
         goto free;
     }
+    for (i = 0; i < NUM_TBLS; i++)
+        mpr_expr_set_tbl(e, tbls[i].name, tbls[i].len, MPR_DBL, tbls[i].vals);
     mpr_time_set(&time_in, MPR_NOW);
     for (i = 0; i < n_sources; i++) {
         mpr_value_reset_inst(&inh[i], 0);
         mlen = mpr_expr_get_in_hist_size(e, i);
-        mpr_value_realloc(&inh[i], src_lens[i], src_types[i], mlen, 1, 0);
+        mpr_value_realloc(&inh[i], src_lens[i], src_types[i], mlen, 1);
         switch (src_types[i]) {
             case MPR_INT32:
                 mpr_value_set_samp(&inh[i], 0, src_int, time_in);
@@ -315,7 +330,7 @@ int parse_and_eval(int expectation, int max_tokens, int check, int exp_updates)
     }
     mpr_value_reset_inst(&outh, 0);
     mlen = mpr_expr_get_out_hist_size(e);
-    mpr_value_realloc(&outh, dst_len, dst_type, mlen, 1, 1);
+    mpr_value_realloc(&outh, dst_len, dst_type, mlen, 1);
 
     if (mpr_expr_get_num_vars(e) > MAX_VARS) {
         eprintf("Maximum variables exceeded.\n");
@@ -327,7 +342,7 @@ int parse_and_eval(int expectation, int max_tokens, int check, int exp_updates)
         int vlen = mpr_expr_get_var_vec_len(e, i);
         mpr_type type = mpr_expr_get_var_type(e, i);
         mpr_value_reset_inst(&user_vars[i], 0);
-        mpr_value_realloc(&user_vars[i], vlen, type, 1, 1, 0);
+        mpr_value_realloc(&user_vars[i], vlen, type, 1, 1);
     }
     user_vars_p = user_vars;
 
@@ -1546,6 +1561,53 @@ int run_tests()
     if (parse_and_eval(EXPECT_SUCCESS, 9, 1, iterations))
         return 1;
 
+    /* 122) Uniform lookup table with linear interpolation, clamped to the table range */
+    set_expr_str("y=lut.steps([0.125,0.5,2])");
+    setup_test(MPR_FLT, 1, MPR_FLT, 3);
+    expect_flt[0] = 5.f;
+    expect_flt[1] = 20.f;
+    expect_flt[2] = 80.f;
+    if (parse_and_eval(EXPECT_SUCCESS, 0, 1, iterations))
+        return 1;
+
+    /* 123) Uniform lookup table with cubic interpolation */
+    set_expr_str("y=[lut.sq(0.5),lutCubic.sq(0.5)]");
+    setup_test(MPR_INT32, 1, MPR_DBL, 2);
+    expect_dbl[0] = 2.5;
+    expect_dbl[1] = 2.25;
+    if (parse_and_eval(EXPECT_SUCCESS, 0, 1, iterations))
+        return 1;
+
+    /* 124) Piecewise curve with linear interpolation */
+    set_expr_str("y=curve.knee([-1,0.25,0.75,3])");
+    setup_test(MPR_DBL, 1, MPR_FLT, 4);
+    expect_flt[0] = 0.f;
+    expect_flt[1] = 0.5f;
+    expect_flt[2] = 2.5f;
+    expect_flt[3] = 4.f;
+    if (parse_and_eval(EXPECT_SUCCESS, 0, 1, iterations))
+        return 1;
+
+    /* 125) Piecewise curve with cubic interpolation */
+    set_expr_str("y=curveCubic.sq(1.5)");
+    setup_test(MPR_FLT, 1, MPR_DBL, 1);
+    expect_dbl[0] = 2.125;
+    if (parse_and_eval(EXPECT_SUCCESS, 0, 1, iterations))
+        return 1;
+
+    /* 126) Table without data passes its input through */
+    set_expr_str("y=lut.missing(x)");
+    setup_test(MPR_FLT, 1, MPR_FLT, 1);
+    expect_flt[0] = src_flt[0];
+    if (parse_and_eval(EXPECT_SUCCESS, 0, 1, iterations))
+        return 1;
+
+    /* 127) Table reference without a name */
+    set_expr_str("y=lut.(x)");
+    setup_test(MPR_FLT, 1, MPR_FLT, 1);
+    if (parse_and_eval(EXPECT_FAILURE, 0, 1, iterations))
+        return 1;
+
     return 0;
 }
 
@@ -0,0 +1,211 @@
+#include <mapper/mapper.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <string.h>
+
+/* Register devices using mpr_dev_set_fast_registration() and check that they
+ * become ready quickly and keep their cached names when they are recreated. */
+
+#define NUM_DEVS 4
+#define FIRST_ORDINAL 11
+#define CACHE_PATH "testregister.cache"
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+
+mpr_graph graph = 0;
+mpr_dev devs[NUM_DEVS];
+char names[NUM_DEVS][256];
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+/* start from a cache with ordinals that default registration would not pick */
+int seed_cache()
+{
+    int i;
+    FILE *file = fopen(CACHE_PATH, "w");
+    if (!file)
+        return 1;
+    for (i = 0; i < NUM_DEVS; i++)
+        fprintf(file, "testregister %d\n", FIRST_ORDINAL + i);
+    fclose(file);
+    return 0;
+}
+
+int setup(const char *iface)
+{
+    int i;
+    graph = mpr_graph_new(0);
+    if (!graph)
+        return 1;
+    if (iface)
+        mpr_graph_set_interface(graph, iface);
+    for (i = 0; i < NUM_DEVS; i++) {
+        devs[i] = mpr_dev_new("testregister", graph);
+        if (!devs[i])
+            return 1;
+        if (mpr_dev_set_fast_registration(devs[i], CACHE_PATH)) {
+            eprintf("Error enabling fast registration.\n");
+            return 1;
+        }
+    }
+    eprintf("devices created using interface %s.\n", mpr_graph_get_interface(graph));
+    return 0;
+}
+
+void cleanup()
+{
+    int i;
+    for (i = 0; i < NUM_DEVS; i++) {
+        if (!devs[i])
+            continue;
+        eprintf("Freeing device %d.. ", i);
+        fflush(stdout);
+        mpr_dev_free(devs[i]);
+        devs[i] = 0;
+        eprintf("ok\n");
+    }
+    if (graph)
+        mpr_graph_free(graph);
+    graph = 0;
+}
+
+int wait_ready()
+{
+    int i, ready = 0;
+    mpr_time start, now;
+    mpr_time_set(&start, MPR_NOW);
+    while (!done && ready < NUM_DEVS) {
+        for (i = 0, ready = 0; i < NUM_DEVS; i++) {
+            mpr_dev_poll(devs[i], 5);
+            ready += mpr_dev_get_is_ready(devs[i]);
+        }
+    }
+    mpr_time_set(&now, MPR_NOW);
+    eprintf("devices ready after %.3f seconds\n", mpr_time_as_dbl(now) - mpr_time_as_dbl(start));
+
+    /* default registration waits at least two seconds */
+    return done || mpr_time_as_dbl(now) - mpr_time_as_dbl(start) > 1.5;
+}
+
+int check_names(int reuse)
+{
+    int i, j;
+    for (i = 0; i < NUM_DEVS; i++) {
+        const char *name = mpr_obj_get_prop_as_str(devs[i], MPR_PROP_NAME, NULL);
+        if (!name)
+            return 1;
+        eprintf("device %d registered as '%s'\n", i, name);
+        if (!reuse) {
+            strncpy(names[i], name, 255);
+            names[i][255] = 0;
+            continue;
+        }
+        for (j = 0; j < NUM_DEVS; j++) {
+            if (0 == strcmp(names[j], name))
+                break;
+        }
+        if (j == NUM_DEVS) {
+            eprintf("Error: cached name was not reused.\n");
+            return 1;
+        }
+    }
+    for (i = 0; i < NUM_DEVS; i++) {
+        for (j = i + 1; j < NUM_DEVS; j++) {
+            if (0 == strcmp(mpr_obj_get_prop_as_str(devs[i], MPR_PROP_NAME, NULL),
+                            mpr_obj_get_prop_as_str(devs[j], MPR_PROP_NAME, NULL))) {
+                eprintf("Error: devices %d and %d have the same name.\n", i, j);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+void ctrlc(int signal)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testregister.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'f':
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface")==0 && argc>i+1) {
+                            i++;
+                            iface = argv[i];
+                            j = 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (seed_cache()) {
+        eprintf("Error writing registration cache.\n");
+        result = 1;
+        goto done;
+    }
+
+    /* register twice, the second time reusing the names cached by the first */
+    for (i = 0; i < 2 && !result; i++) {
+        if (setup(iface)) {
+            eprintf("Error initializing test.\n");
+            result = 1;
+        }
+        else if (wait_ready()) {
+            eprintf("Error: devices took too long to register.\n");
+            result = 1;
+        }
+        else
+            result = check_names(i);
+        cleanup();
+    }
+
+  done:
+    remove(CACHE_PATH);
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -0,0 +1,270 @@
+#include <mapper/mapper.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <string.h>
+
+/* Save a set of maps with mpr_graph_save_session(), release them, and check that
+ * mpr_graph_load_session() recreates them with their properties from a different graph. */
+
+#define NUM_SIGS 20
+#define EXPR "y=x*0.5"
+#define SESSION_PATH "testsession.mprs"
+#define JSON_PATH "testsession.json"
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+
+mpr_graph graph = 0;
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig sendsigs[NUM_SIGS];
+mpr_sig recvsigs[NUM_SIGS];
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+int setup(const char *iface)
+{
+    float mn = 0, mx = 1;
+    char name[32];
+    int i;
+
+    src = mpr_dev_new("testsession-send", 0);
+    dst = mpr_dev_new("testsession-recv", 0);
+    if (!src || !dst)
+        return 1;
+    if (iface) {
+        mpr_graph_set_interface(mpr_obj_get_graph(src), iface);
+        mpr_graph_set_interface(mpr_obj_get_graph(dst), iface);
+    }
+    eprintf("devices created using interface %s.\n",
+            mpr_graph_get_interface(mpr_obj_get_graph(src)));
+
+    for (i = 0; i < NUM_SIGS; i++) {
+        snprintf(name, 32, "outsig%d", i);
+        sendsigs[i] = mpr_sig_new(src, MPR_DIR_OUT, name, 1, MPR_FLT, NULL,
+                                  &mn, &mx, NULL, NULL, 0);
+        snprintf(name, 32, "insig%d", i);
+        recvsigs[i] = mpr_sig_new(dst, MPR_DIR_IN, name, 1, MPR_FLT, NULL,
+                                  &mn, &mx, NULL, NULL, 0);
+    }
+    return 0;
+}
+
+void cleanup()
+{
+    if (graph) {
+        eprintf("Freeing graph.. ");
+        fflush(stdout);
+        mpr_graph_free(graph);
+        eprintf("ok\n");
+    }
+    if (src) {
+        eprintf("Freeing source.. ");
+        fflush(stdout);
+        mpr_dev_free(src);
+        eprintf("ok\n");
+    }
+    if (dst) {
+        eprintf("Freeing destination.. ");
+        fflush(stdout);
+        mpr_dev_free(dst);
+        eprintf("ok\n");
+    }
+}
+
+void poll_all(int block_ms)
+{
+    mpr_dev_poll(src, 0);
+    mpr_dev_poll(dst, 0);
+    if (graph)
+        mpr_graph_poll(graph, block_ms);
+    else
+        mpr_dev_poll(dst, block_ms);
+}
+
+/* return the number of established maps at the destination, or -1 if one has lost its expression */
+int count_maps()
+{
+    int num_ready = 0;
+    mpr_list list = mpr_dev_get_maps(dst, MPR_DIR_IN);
+    while (list) {
+        mpr_map map = (mpr_map)*list;
+        const char *expr = mpr_obj_get_prop_as_str((mpr_obj)map, MPR_PROP_EXPR, NULL);
+        list = mpr_list_get_next(list);
+        if (!mpr_map_get_is_ready(map))
+            continue;
+        if (!expr || strcmp(expr, EXPR)) {
+            eprintf("Error: map has expression '%s'\n", expr ? expr : "(null)");
+            mpr_list_free(list);
+            return -1;
+        }
+        ++num_ready;
+    }
+    return num_ready;
+}
+
+int wait_maps(int num_expected)
+{
+    int num_ready = -1, iterations = 0;
+    while (!done && iterations++ < 200 && num_ready != num_expected) {
+        poll_all(25);
+        num_ready = count_maps();
+        if (num_ready < 0)
+            return 1;
+    }
+    eprintf("%d of %d maps established after %d iterations\n", num_ready, num_expected, iterations);
+    return num_ready != num_expected;
+}
+
+int create_maps()
+{
+    int i;
+    mpr_map map;
+
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst)))
+        poll_all(25);
+
+    for (i = 0; i < NUM_SIGS; i++) {
+        map = mpr_map_new(1, &sendsigs[i], 1, &recvsigs[i]);
+        mpr_obj_set_prop((mpr_obj)map, MPR_PROP_EXPR, NULL, 1, MPR_STR, EXPR, 1);
+        mpr_obj_push((mpr_obj)map);
+    }
+    return wait_maps(NUM_SIGS);
+}
+
+int save_session()
+{
+    int num_saved, num_json, num_state = 0;
+    char buf[256];
+    FILE *file;
+
+    num_saved = mpr_graph_save_session(mpr_obj_get_graph(dst), SESSION_PATH, 0);
+    num_json = mpr_graph_save_session(mpr_obj_get_graph(dst), JSON_PATH, 1);
+    eprintf("saved %d maps, exported %d maps as JSON\n", num_saved, num_json);
+    if (num_saved != NUM_SIGS || num_json != NUM_SIGS)
+        return 1;
+
+    /* the JSON export should be an object listing the maps with their properties */
+    if (!(file = fopen(JSON_PATH, "r")))
+        return 1;
+    num_json = fgets(buf, 256, file) && buf[0] == '{';
+    while (fgets(buf, 256, file)) {
+        num_json += (0 != strstr(buf, EXPR));
+        /* read-only runtime state should not be saved */
+        num_state += (strstr(buf, "\"status\"") || strstr(buf, "\"version\"")) ? 1 : 0;
+    }
+    fclose(file);
+    if (num_json < 2) {
+        eprintf("Error: JSON export is missing map expressions.\n");
+        return 1;
+    }
+    if (num_state) {
+        eprintf("Error: JSON export includes map status or version.\n");
+        return 1;
+    }
+    return 0;
+}
+
+int release_maps()
+{
+    mpr_list list = mpr_dev_get_maps(dst, MPR_DIR_IN);
+    while (list) {
+        mpr_map_release((mpr_map)*list);
+        list = mpr_list_get_next(list);
+    }
+    return wait_maps(0);
+}
+
+int load_session()
+{
+    int num_loaded;
+    graph = mpr_graph_new(MPR_OBJ);
+    if (!graph)
+        return 1;
+    num_loaded = mpr_graph_load_session(graph, SESSION_PATH);
+    eprintf("loaded %d maps\n", num_loaded);
+    return num_loaded != NUM_SIGS || wait_maps(NUM_SIGS);
+}
+
+void ctrlc(int signal)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testsession.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'f':
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface")==0 && argc>i+1) {
+                            i++;
+                            iface = argv[i];
+                            j = 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup(iface) || create_maps()) {
+        eprintf("Error initializing test.\n");
+        result = 1;
+    }
+    else if (save_session()) {
+        eprintf("Error saving session.\n");
+        result = 1;
+    }
+    else if (release_maps()) {
+        eprintf("Error releasing maps.\n");
+        result = 1;
+    }
+    else
+        result = load_session();
+
+    cleanup();
+    remove(SESSION_PATH);
+    remove(JSON_PATH);
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
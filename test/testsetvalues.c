@@ -0,0 +1,215 @@
+#include <mapper/mapper.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <string.h>
+
+/* Update many output signals with a single call to mpr_dev_set_values() and check that every
+ * mapped input receives its value. */
+
+#define NUM_SIGS 16
+#define VEC_LEN 2
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig sendsigs[NUM_SIGS];
+mpr_sig recvsigs[NUM_SIGS];
+
+int received = 0;
+int errors = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    int i;
+    float *v = (float*)value;
+    if (!value)
+        return;
+    /* each signal was updated with its index in the array of signals */
+    for (i = 0; i < NUM_SIGS && recvsigs[i] != sig; i++) {}
+    if (i == NUM_SIGS || v[0] != i || v[1] != i) {
+        eprintf("unexpected value [%g, %g] at signal %d\n", v[0], v[1], i);
+        ++errors;
+    }
+    ++received;
+}
+
+int setup(const char *iface)
+{
+    float mn = 0, mx = NUM_SIGS;
+    char name[32];
+    int i;
+
+    src = mpr_dev_new("testsetvalues-send", 0);
+    dst = mpr_dev_new("testsetvalues-recv", 0);
+    if (!src || !dst)
+        return 1;
+    if (iface) {
+        mpr_graph_set_interface(mpr_obj_get_graph(src), iface);
+        mpr_graph_set_interface(mpr_obj_get_graph(dst), iface);
+    }
+    eprintf("devices created using interface %s.\n",
+            mpr_graph_get_interface(mpr_obj_get_graph(src)));
+
+    for (i = 0; i < NUM_SIGS; i++) {
+        snprintf(name, 32, "outsig%d", i);
+        sendsigs[i] = mpr_sig_new(src, MPR_DIR_OUT, name, VEC_LEN, MPR_FLT, NULL,
+                                  &mn, &mx, NULL, NULL, 0);
+        snprintf(name, 32, "insig%d", i);
+        recvsigs[i] = mpr_sig_new(dst, MPR_DIR_IN, name, VEC_LEN, MPR_FLT, NULL,
+                                  &mn, &mx, NULL, handler, MPR_SIG_UPDATE);
+    }
+    return 0;
+}
+
+void cleanup()
+{
+    if (src) {
+        eprintf("Freeing source.. ");
+        fflush(stdout);
+        mpr_dev_free(src);
+        eprintf("ok\n");
+    }
+    if (dst) {
+        eprintf("Freeing destination.. ");
+        fflush(stdout);
+        mpr_dev_free(dst);
+        eprintf("ok\n");
+    }
+}
+
+int wait_ready()
+{
+    int i, num_ready = 0, iterations = 0;
+    mpr_map maps[NUM_SIGS];
+
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst))) {
+        mpr_dev_poll(src, 25);
+        mpr_dev_poll(dst, 25);
+    }
+    for (i = 0; i < NUM_SIGS; i++) {
+        maps[i] = mpr_map_new(1, &sendsigs[i], 1, &recvsigs[i]);
+        mpr_obj_set_prop((mpr_obj)maps[i], MPR_PROP_EXPR, NULL, 1, MPR_STR, "y=x", 1);
+        mpr_obj_push((mpr_obj)maps[i]);
+    }
+    while (!done && iterations++ < 200 && num_ready < NUM_SIGS) {
+        mpr_dev_poll(src, 25);
+        mpr_dev_poll(dst, 25);
+        for (i = 0, num_ready = 0; i < NUM_SIGS; i++)
+            num_ready += mpr_map_get_is_ready(maps[i]);
+    }
+    eprintf("%d of %d maps ready\n", num_ready, NUM_SIGS);
+    return num_ready != NUM_SIGS;
+}
+
+int run()
+{
+    float vals[NUM_SIGS * VEC_LEN];
+    int i, num_set, iterations = 0;
+
+    for (i = 0; i < NUM_SIGS * VEC_LEN; i++)
+        vals[i] = i / VEC_LEN;
+
+    /* too few values for the last signal */
+    num_set = mpr_dev_set_values(src, NUM_SIGS, sendsigs, NULL, NUM_SIGS * VEC_LEN - 1,
+                                 MPR_FLT, vals);
+    if (num_set != NUM_SIGS - 1) {
+        eprintf("Error: updated %d signals with too few values.\n", num_set);
+        return 1;
+    }
+    mpr_dev_poll(src, 0);
+    while (!done && iterations++ < 20 && received < NUM_SIGS - 1)
+        mpr_dev_poll(dst, 25);
+
+    received = 0;
+    num_set = mpr_dev_set_values(src, NUM_SIGS, sendsigs, NULL, NUM_SIGS * VEC_LEN, MPR_FLT, vals);
+    mpr_dev_poll(src, 0);
+    iterations = 0;
+    while (!done && iterations++ < 20 && received < NUM_SIGS)
+        mpr_dev_poll(dst, 25);
+    eprintf("set %d signals, received %d updates\n", num_set, received);
+    return num_set != NUM_SIGS || received != NUM_SIGS || errors;
+}
+
+void ctrlc(int signal)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testsetvalues.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'f':
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface")==0 && argc>i+1) {
+                            i++;
+                            iface = argv[i];
+                            j = 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup(iface)) {
+        eprintf("Error initializing test.\n");
+        result = 1;
+        goto done;
+    }
+    if (wait_ready()) {
+        eprintf("Error establishing maps.\n");
+        result = 1;
+        goto done;
+    }
+    result = run();
+
+  done:
+    cleanup();
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
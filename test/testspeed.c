@@ -1,278 +1,482 @@
-#include "../src/mapper_internal.h"
 #include <mapper/mapper.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <math.h>
 #include <time.h>
-
-#include <lo/lo.h>
-#ifdef WIN32
-#include <io.h>
-#else
-#include <sys/time.h>
-#include <unistd.h>
-#endif
 #include <signal.h>
 #include <string.h>
 
-int count = 0;
+/* Throughput and latency benchmark. Each configuration creates a number of
+ * source and destination devices with a number of signals each, maps every
+ * source signal to the matching signal of every destination device (or one
+ * convergent map per destination signal) and measures how quickly updates of
+ * all source signals and instances arrive at the destinations. Run with
+ * --sweep to scale one dimension at a time from the baseline configuration,
+ * and with --json <file> to write the results in machine-readable form. */
 
-int verbose = 1;
-int shared_graph = 0;
-
-mpr_dev src = 0;
-mpr_dev dst = 0;
-mpr_sig sendsig = 0;
-mpr_sig recvsig = 0;
-
-int numTrials = 10;
-int trial = 0;
-int numModes = 2;
-int mode = 0;
-int use_inst = 1;
-int iterations = 10000;
-int counter = 0;
-int received = 0;
-int done = 0;
+#define MAX_SAMPLES 100000
+#define NUM_WARMUP 10
+#define ITERATION_TIMEOUT 0.25
 
-double times[100];
+/* allocations are counted by interposing the allocator where possible */
+#if defined(__GLIBC__) && !defined(WIN32)
+#define COUNT_ALLOCS
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t num, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
 
-void switch_modes();
-void print_results();
+static volatile long num_allocs = 0;
+
+void *malloc(size_t size)
+{
+    ++num_allocs;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t num, size_t size)
+{
+    ++num_allocs;
+    return __libc_calloc(num, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    ++num_allocs;
+    return __libc_realloc(ptr, size);
+}
+#endif
+
+typedef struct _config {
+    const char *proto;  /* "local" (in-process), "udp" or "tcp" */
+    int num_srcs;
+    int num_dsts;
+    int num_sigs;
+    int vec_len;
+    int num_inst;
+    int convergent;
+} config_t;
+
+typedef struct _result {
+    int skipped;
+    long expected;
+    long received;
+    double seconds;
+    double cpu_seconds;
+    double p50_us;
+    double p99_us;
+    double max_us;
+    long allocs;
+} result_t;
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+int iterations = 10000;
+int sweep = 0;
+const char *iface = 0;
+const char *json_path = 0;
+
+mpr_graph graph = 0;
+mpr_dev *srcs = 0;
+mpr_dev *dsts = 0;
+mpr_sig *sendsigs = 0;
+mpr_sig *recvsigs = 0;
+mpr_map *maps = 0;
+int num_maps = 0;
+float *values = 0;
+
+long received = 0;
+double iter_start = 0;
+double samples[MAX_SAMPLES];
+long num_samples = 0;
+long num_latencies = 0;
 
 static void eprintf(const char *format, ...)
 {
     va_list args;
-    if (!verbose) {
-        if (count >= 20) {
-            count = 0;
-            fprintf(stdout, "\33[2K\r");
-        }
-        else {
-            fprintf(stdout, ".");
-            ++count;
-        }
-        fflush(stdout);
+    if (!verbose)
         return;
-    }
     va_start(args, format);
     vprintf(format, args);
     va_end(args);
 }
 
-/*! Internal function to get the current time. */
 static double current_time()
 {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return (double) tv.tv_sec + tv.tv_usec / 1000000.0;
+    mpr_time t;
+    mpr_time_set(&t, MPR_NOW);
+    return mpr_time_as_dbl(t);
 }
 
-/*! Creation of a local source. */
-int setup_src(mpr_graph g, const char *iface)
+/* Keep a uniform random sample of all latencies if there are too many. */
+static void add_sample(double latency)
 {
-    mpr_list l;
-    src = mpr_dev_new("testspeed-send", g);
-    if (!src)
-        goto error;
-    if (iface)
-        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)src), iface);
-    eprintf("source created using interface %s.\n",
-            mpr_graph_get_interface(mpr_obj_get_graph((mpr_obj)src)));
-
-    sendsig = mpr_sig_new(src, MPR_DIR_OUT, "outsig", 1, MPR_FLT, NULL,
-                          NULL, NULL, NULL, NULL, 0);
-    if (!sendsig)
-        goto error;
-    mpr_sig_reserve_inst(sendsig, 10, 0, 0);
-
-    eprintf("Output signal registered.\n");
-    l = mpr_dev_get_sigs(src, MPR_DIR_OUT);
-    eprintf("Number of outputs: %d\n", mpr_list_get_size(l));
-    mpr_list_free(l);
-
-    return 0;
+    long idx = num_latencies++;
+    if (idx >= MAX_SAMPLES) {
+        idx = (long)(((double)rand() / ((double)RAND_MAX + 1)) * num_latencies);
+        if (idx >= MAX_SAMPLES)
+            return;
+    }
+    else
+        ++num_samples;
+    samples[idx] = latency;
+}
 
-  error:
-    return 1;
+static int compare_samples(const void *l, const void *r)
+{
+    double diff = *(const double*)l - *(const double*)r;
+    return diff < 0 ? -1 : diff > 0;
 }
 
-void cleanup_src()
+static double percentile(double pct)
 {
-    if (src) {
-        eprintf("Freeing source... ");
-        fflush(stdout);
-        mpr_dev_free(src);
-        eprintf("ok\n");
-    }
+    long idx;
+    if (!num_samples)
+        return 0;
+    idx = (long)(pct * 0.01 * num_samples);
+    return samples[idx < num_samples ? idx : num_samples - 1];
 }
 
 void handler(mpr_sig sig, mpr_sig_evt event, mpr_id inst, int length,
              mpr_type type, const void *value, mpr_time t)
 {
-    if (value) {
-        counter = (counter+1)%10;
-        if (++received >= iterations)
-            switch_modes();
-        if (use_inst)
-            mpr_sig_set_value(sendsig, counter, length, type, value);
-        else
-            mpr_sig_set_value(sendsig, 0, length, type, value);
-        mpr_dev_update_maps(mpr_sig_get_dev(sig));
-    }
-    else {
-        const char *name = mpr_obj_get_prop_as_str((mpr_obj)sig, MPR_PROP_NAME, NULL);
-        eprintf("--> destination %s instance %ld got NULL\n", name, (long)inst);
-    }
+    if (!value)
+        return;
+    ++received;
+    add_sample(current_time() - iter_start);
 }
 
-/*! Creation of a local destination. */
-int setup_dst(mpr_graph g, const char *iface)
+void poll_all(int block_ms)
 {
-    mpr_list l;
-    dst = mpr_dev_new("testspeed-recv", g);
-    if (!dst)
-        goto error;
-    if (iface)
-        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)dst), iface);
-    eprintf("destination created using interface %s.\n",
-            mpr_graph_get_interface(mpr_obj_get_graph((mpr_obj)dst)));
-
-    recvsig = mpr_sig_new(dst, MPR_DIR_IN, "insig", 1, MPR_FLT, NULL,
-                          NULL, NULL, NULL, handler, MPR_SIG_UPDATE);
-    if (!recvsig)
-        goto error;
-    mpr_sig_reserve_inst(recvsig, 10, 0, 0);
-
-    eprintf("Input signal registered.\n");
-    l = mpr_dev_get_sigs(dst, MPR_DIR_IN);
-    eprintf("Number of inputs: %d\n", mpr_list_get_size(l));
-    mpr_list_free(l);
-
-    return 0;
-
-  error:
-    return 1;
+    int i;
+    for (i = 0; srcs[i]; i++)
+        mpr_dev_poll(srcs[i], 0);
+    for (i = 0; dsts[i]; i++)
+        mpr_dev_poll(dsts[i], dsts[i + 1] ? 0 : block_ms);
 }
 
-void cleanup_dst()
+void cleanup()
 {
-    if (dst) {
-        eprintf("Freeing destination... ");
-        fflush(stdout);
-        mpr_dev_free(dst);
-        eprintf("ok\n");
+    int i;
+    if (srcs) {
+        for (i = 0; srcs[i]; i++)
+            mpr_dev_free(srcs[i]);
+        free(srcs);
+    }
+    if (dsts) {
+        for (i = 0; dsts[i]; i++)
+            mpr_dev_free(dsts[i]);
+        free(dsts);
     }
+    if (graph)
+        mpr_graph_free(graph);
+    free(sendsigs);
+    free(recvsigs);
+    free(maps);
+    free(values);
+    graph = 0;
+    srcs = dsts = 0;
+    sendsigs = recvsigs = 0;
+    maps = 0;
+    values = 0;
 }
 
-void wait_local_devs()
+int setup(config_t *c)
 {
-    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst))) {
-        mpr_dev_poll(src, 25);
-        mpr_dev_poll(dst, 25);
+    int i, j, num_inst = c->num_inst;
+    float mn = 0, mx = 1;
+    char name[32];
+
+    if (0 == strcmp(c->proto, "local")) {
+        /* devices sharing a graph are linked in-process */
+        graph = mpr_graph_new(0);
+        if (!graph)
+            return 1;
+        if (iface)
+            mpr_graph_set_interface(graph, iface);
     }
-    eprintf("Devices are ready.\n");
-}
 
-void map_sigs()
-{
-    mpr_map map;
-    const char *expr = "y=y{-1}+1";
-
-    eprintf("Creating maps... ");
-    map = mpr_map_new(1, &sendsig, 1, &recvsig);
-    mpr_obj_set_prop((mpr_obj)map, MPR_PROP_EXPR, NULL, 1, MPR_STR, expr, 1);
-    mpr_obj_push((mpr_obj)map);
-
-    /* wait until mapping has been established */
-    while (!done && !mpr_map_get_is_ready(map)) {
-        mpr_dev_poll(src, 10);
-        mpr_dev_poll(dst, 10);
+    srcs = (mpr_dev*)calloc(1, sizeof(mpr_dev) * (c->num_srcs + 1));
+    dsts = (mpr_dev*)calloc(1, sizeof(mpr_dev) * (c->num_dsts + 1));
+    sendsigs = (mpr_sig*)calloc(1, sizeof(mpr_sig) * c->num_srcs * c->num_sigs);
+    recvsigs = (mpr_sig*)calloc(1, sizeof(mpr_sig) * c->num_dsts * c->num_sigs);
+    values = (float*)calloc(1, sizeof(float) * c->vec_len);
+
+    for (i = 0; i < c->num_srcs; i++) {
+        if (!(srcs[i] = mpr_dev_new("testspeed-send", graph)))
+            return 1;
+        if (iface && !graph)
+            mpr_graph_set_interface(mpr_obj_get_graph(srcs[i]), iface);
+        for (j = 0; j < c->num_sigs; j++) {
+            snprintf(name, 32, "outsig%d", j);
+            sendsigs[i * c->num_sigs + j] = mpr_sig_new(srcs[i], MPR_DIR_OUT, name, c->vec_len,
+                                                        MPR_FLT, NULL, &mn, &mx,
+                                                        num_inst > 1 ? &num_inst : NULL, NULL, 0);
+        }
+    }
+    for (i = 0; i < c->num_dsts; i++) {
+        if (!(dsts[i] = mpr_dev_new("testspeed-recv", graph)))
+            return 1;
+        if (iface && !graph)
+            mpr_graph_set_interface(mpr_obj_get_graph(dsts[i]), iface);
+        for (j = 0; j < c->num_sigs; j++) {
+            snprintf(name, 32, "insig%d", j);
+            recvsigs[i * c->num_sigs + j] = mpr_sig_new(dsts[i], MPR_DIR_IN, name, c->vec_len,
+                                                        MPR_FLT, NULL, &mn, &mx,
+                                                        num_inst > 1 ? &num_inst : NULL,
+                                                        handler, MPR_SIG_UPDATE);
+        }
     }
+    return 0;
 }
 
-void segv(int sig)
+int wait_ready(config_t *c)
 {
-    printf("\x1B[31m(SEGV)\n\x1B[0m");
-    exit(1);
+    int i, ready = 0;
+    double then = current_time();
+    while (!done && !ready) {
+        poll_all(10);
+        ready = 1;
+        for (i = 0; i < c->num_srcs; i++)
+            ready &= mpr_dev_get_is_ready(srcs[i]);
+        for (i = 0; i < c->num_dsts; i++)
+            ready &= mpr_dev_get_is_ready(dsts[i]);
+        if (current_time() - then > 30) {
+            eprintf("Error: timed out waiting for devices.\n");
+            return 1;
+        }
+    }
+    return done;
 }
 
-void ctrlc(int sig)
+mpr_map add_map(config_t *c, int num_src, mpr_sig *src, mpr_sig dst)
 {
-    done = 1;
+    mpr_map map = mpr_map_new(num_src, src, 1, &dst);
+    if (!map)
+        return 0;
+    if (strcmp(c->proto, "local")) {
+        int proto = strcmp(c->proto, "tcp") ? MPR_PROTO_UDP : MPR_PROTO_TCP;
+        mpr_obj_set_prop(map, MPR_PROP_PROTOCOL, NULL, 1, MPR_INT32, &proto, 1);
+    }
+    mpr_obj_push(map);
+    return map;
 }
 
-void switch_modes()
+int setup_maps(config_t *c)
 {
-    int i;
-    eprintf("MODE %i TRIAL %i COMPLETED...\n", mode, trial);
-    received = 0;
-    times[mode*numTrials+trial] = current_time() - times[mode*numTrials+trial];
-    if (++trial >= numTrials) {
-        eprintf("SWITCHING MODES...\n");
-        trial = 0;
-        mode++;
+    int i, j, k, ready = 0;
+    double then;
+
+    maps = (mpr_map*)calloc(1, sizeof(mpr_map) * c->num_srcs * c->num_dsts * c->num_sigs);
+    num_maps = 0;
+    for (i = 0; i < c->num_dsts; i++) {
+        for (j = 0; j < c->num_sigs; j++) {
+            mpr_sig dst = recvsigs[i * c->num_sigs + j];
+            if (c->convergent) {
+                mpr_sig *src = (mpr_sig*)malloc(sizeof(mpr_sig) * c->num_srcs);
+                for (k = 0; k < c->num_srcs; k++)
+                    src[k] = sendsigs[k * c->num_sigs + j];
+                maps[num_maps++] = add_map(c, c->num_srcs, src, dst);
+                free(src);
+                continue;
+            }
+            for (k = 0; k < c->num_srcs; k++)
+                maps[num_maps++] = add_map(c, 1, &sendsigs[k * c->num_sigs + j], dst);
+        }
     }
-    if (mode >= numModes) {
-        done = 1;
-        return;
+
+    then = current_time();
+    while (!done && ready < num_maps) {
+        poll_all(10);
+        for (i = 0, ready = 0; i < num_maps; i++)
+            ready += maps[i] && mpr_map_get_is_ready(maps[i]);
+        if (current_time() - then > 30) {
+            eprintf("Error: timed out waiting for maps (%d of %d ready).\n", ready, num_maps);
+            return 1;
+        }
     }
+    return done;
+}
+
+/* Update every instance of every source signal once per iteration and wait
+ * for the resulting updates to arrive before starting the next one. */
+void run(config_t *c, result_t *r)
+{
+    int i, j, k, num_sendsigs = c->num_srcs * c->num_sigs;
+    long per_iteration = (long)c->num_srcs * c->num_dsts * c->num_sigs * c->num_inst;
+    long allocs = 0;
+    double start = 0;
+    clock_t cpu_start = 0;
+
+    for (i = 0; i < NUM_WARMUP + iterations && !done; i++) {
+        if (NUM_WARMUP == i) {
+            /* start measuring */
+            r->expected = received = 0;
+            num_samples = num_latencies = 0;
+#ifdef COUNT_ALLOCS
+            allocs = num_allocs;
+#endif
+            cpu_start = clock();
+            start = current_time();
+        }
+        for (j = 0; j < c->vec_len; j++)
+            values[j] = (float)((i + j) % 100) * 0.01f;
 
-    switch (mode)
-    {
-        case 0:
-            use_inst = 1;
-            break;
-        case 1:
-            use_inst = 0;
-            for (i=1; i<10; i++) {
-                mpr_sig_release_inst(sendsig, i);
+        iter_start = current_time();
+        for (j = 0; j < num_sendsigs; j++) {
+            for (k = 0; k < c->num_inst; k++)
+                mpr_sig_set_value(sendsigs[j], k, c->vec_len, MPR_FLT, values);
+        }
+        for (j = 0; j < c->num_srcs; j++)
+            mpr_dev_update_maps(srcs[j]);
+        r->expected += per_iteration;
+
+        while (!done && received < r->expected) {
+            poll_all(0);
+            if (current_time() - iter_start > ITERATION_TIMEOUT) {
+                /* count the missing updates as lost and move on */
+                break;
             }
-            break;
+        }
     }
+    r->seconds = current_time() - start;
+    r->cpu_seconds = (double)(clock() - cpu_start) / CLOCKS_PER_SEC;
+#ifdef COUNT_ALLOCS
+    r->allocs = num_allocs - allocs;
+#else
+    r->allocs = -1;
+#endif
+    r->received = received;
 
-    times[mode*numTrials+trial] = current_time();
+    qsort(samples, num_samples, sizeof(double), compare_samples);
+    r->p50_us = percentile(50) * 1000000.0;
+    r->p99_us = percentile(99) * 1000000.0;
+    r->max_us = num_samples ? samples[num_samples - 1] * 1000000.0 : 0;
 }
 
-void print_results()
+int benchmark(config_t *c, result_t *r)
 {
-    int i, j;
-    double total_elapsed_time = 0;
+    int result = 0;
+    memset(r, 0, sizeof(result_t));
+
+    /* map updates are not split across datagrams */
+    if (strcmp(c->proto, "udp") == 0
+        && (long)c->num_srcs * c->num_sigs * c->num_inst * (c->vec_len * 4 + 64) > 60000) {
+        eprintf("Skipping configuration exceeding the maximum UDP datagram size.\n");
+        r->skipped = 1;
+        return 0;
+    }
 
-    for (i = 0; i < numModes; i++) {
-        for (j = 0; j < numTrials; j++)
-            total_elapsed_time += times[i * numTrials + j];
+    received = 0;
+    if (setup(c) || wait_ready(c) || setup_maps(c)) {
+        eprintf("Error initializing configuration.\n");
+        result = 1;
     }
-    printf(" (%i messages in %f seconds).\n", iterations * numModes * numTrials,
-           total_elapsed_time);
-    if (!verbose)
+    else {
+        run(c, r);
+        if (!r->received) {
+            eprintf("Error: no updates received.\n");
+            result = 1;
+        }
+    }
+    cleanup();
+    return result;
+}
+
+void print_result(config_t *c, result_t *r)
+{
+    if (r->skipped)
         return;
+    eprintf("%-5s srcs %3d dsts %3d sigs %3d len %4d inst %3d%s: %8.0f updates/s, "
+            "p50 %7.1fus, p99 %7.1fus, %5.2fus cpu/update", c->proto, c->num_srcs, c->num_dsts,
+            c->num_sigs, c->vec_len, c->num_inst, c->convergent ? " convergent" : "",
+            r->seconds > 0 ? r->received / r->seconds : 0, r->p50_us, r->p99_us,
+            r->received ? r->cpu_seconds * 1000000.0 / r->received : 0);
+    if (r->allocs >= 0)
+        eprintf(", %5.2f allocs/update", r->received ? (double)r->allocs / r->received : 0);
+    if (r->received < r->expected)
+        eprintf(", %ld lost", r->expected - r->received);
+    eprintf("\n");
+}
 
-    eprintf("\n*****************************************************\n");
-    eprintf("\nRESULTS OF SPEED TEST:\n");
-    for (i = 0; i < numModes; i++) {
-        float bestTime = times[i*numTrials];
-        eprintf("MODE %i\n", i);
-        for (j = 0; j < numTrials; j++) {
-            eprintf("trial %i: %i messages processed in %f seconds\n", j,
-                    iterations, times[i * numTrials + j]);
-            if (times[i * numTrials + j] < bestTime)
-                bestTime = times[i * numTrials + j];
-        }
-        eprintf("\nbest trial: %i messages in %f seconds\n", iterations, bestTime);
+void print_json(FILE *f, config_t *c, result_t *r, int first)
+{
+    fprintf(f, "%s\n    {\"proto\": \"%s\", \"srcs\": %d, \"dsts\": %d, \"sigs\": %d, "
+            "\"maps\": %d, \"vec_len\": %d, \"instances\": %d, \"convergent\": %s, ",
+            first ? "" : ",", c->proto, c->num_srcs, c->num_dsts, c->num_sigs,
+            c->num_dsts * c->num_sigs * (c->convergent ? 1 : c->num_srcs), c->vec_len,
+            c->num_inst, c->convergent ? "true" : "false");
+    if (r->skipped) {
+        fprintf(f, "\"skipped\": true}");
+        return;
     }
-    eprintf("\n*****************************************************\n");
+    fprintf(f, "\"iterations\": %d, \"expected\": %ld, \"received\": %ld, \"seconds\": %f, "
+            "\"updates_per_sec\": %f, \"latency_us\": {\"p50\": %.1f, \"p99\": %.1f, "
+            "\"max\": %.1f}, \"cpu_seconds\": %f, \"cpu_us_per_update\": %f, ",
+            iterations, r->expected, r->received, r->seconds,
+            r->seconds > 0 ? r->received / r->seconds : 0, r->p50_us, r->p99_us, r->max_us,
+            r->cpu_seconds, r->received ? r->cpu_seconds * 1000000.0 / r->received : 0);
+    if (r->allocs >= 0)
+        fprintf(f, "\"allocs_per_update\": %f}",
+                r->received ? (double)r->allocs / r->received : 0);
+    else
+        fprintf(f, "\"allocs_per_update\": null}");
+}
+
+/* Configurations scaling one dimension at a time from the baseline. */
+int build_sweep(config_t *base, config_t *configs)
+{
+    int i, n = 0;
+    const char *protos[] = {"local", "udp", "tcp"};
+    int vec_lens[] = {4, 16, 64, 256, 1024};
+    int insts[] = {8, 32, 128, 512};
+    int sigs[] = {8, 64};
+    int dst_devs[] = {4, 16};
+    int src_devs[] = {2, 4, 8};
+
+    for (i = 0; i < 3; i++) {
+        configs[n] = *base;
+        configs[n++].proto = protos[i];
+    }
+    for (i = 0; i < 5; i++) {
+        configs[n] = *base;
+        configs[n++].vec_len = vec_lens[i];
+    }
+    for (i = 0; i < 4; i++) {
+        configs[n] = *base;
+        configs[n++].num_inst = insts[i];
+    }
+    for (i = 0; i < 2; i++) {
+        configs[n] = *base;
+        configs[n++].num_sigs = sigs[i];
+    }
+    for (i = 0; i < 2; i++) {
+        configs[n] = *base;
+        configs[n++].num_dsts = dst_devs[i];
+    }
+    for (i = 0; i < 3; i++) {
+        configs[n] = *base;
+        configs[n].num_srcs = src_devs[i];
+        configs[n++].convergent = 1;
+    }
+    return n;
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
 }
 
 int main(int argc, char **argv)
 {
-    int i, j, result = 0;
-    float value = (float)rand();
-    char *iface = 0;
-    mpr_graph g;
+    int i, j, num_configs = 1, result = 0;
+    config_t base = {"udp", 1, 1, 1, 1, 1, 0};
+    config_t configs[32];
+    result_t results[32];
+    FILE *json = 0;
 
-    /* process flags for -v verbose, -h help */
+    /* process flags for -v verbose, -t terminate, -h help */
     for (i = 1; i < argc; i++) {
         if (argv[i] && argv[i][0] == '-') {
             int len = strlen(argv[i]);
@@ -280,24 +484,61 @@ int main(int argc, char **argv)
                 switch (argv[i][j]) {
                     case 'h':
                         printf("testspeed.c: possible arguments "
+                               "-f fast (execute quickly), "
                                "-q quiet (suppress output), "
-                               "-s shared (use one mpr_graph only), "
+                               "-t terminate automatically, "
                                "-h help, "
-                               "--iface network interface\n");
+                               "--iface network interface, "
+                               "--proto local|udp|tcp, "
+                               "--srcs number of source devices, "
+                               "--dsts number of destination devices, "
+                               "--sigs signals per device, "
+                               "--len vector length, "
+                               "--inst number of instances, "
+                               "--convergent (one map per destination signal), "
+                               "--iterations number of updates, "
+                               "--sweep (scale each dimension in turn), "
+                               "--json output file\n");
                         return 1;
                         break;
-                    case 's':
-                        shared_graph = 0;
+                    case 'f':
+                        iterations = 100;
                         break;
                     case 'q':
                         verbose = 0;
                         break;
+                    case 't':
+                        terminate = 1;
+                        break;
                     case '-':
-                        if (strcmp(argv[i], "--iface")==0 && argc>i+1) {
-                            i++;
-                            iface = argv[i];
-                            j = 1;
+                        if (strcmp(argv[i], "--sweep")==0)
+                            sweep = 1;
+                        else if (strcmp(argv[i], "--convergent")==0)
+                            base.convergent = 1;
+                        else if (argc>i+1) {
+                            const char *arg = argv[i++];
+                            if (strcmp(arg, "--iface")==0)
+                                iface = argv[i];
+                            else if (strcmp(arg, "--json")==0)
+                                json_path = argv[i];
+                            else if (strcmp(arg, "--proto")==0)
+                                base.proto = argv[i];
+                            else if (strcmp(arg, "--srcs")==0)
+                                base.num_srcs = atoi(argv[i]);
+                            else if (strcmp(arg, "--dsts")==0)
+                                base.num_dsts = atoi(argv[i]);
+                            else if (strcmp(arg, "--sigs")==0)
+                                base.num_sigs = atoi(argv[i]);
+                            else if (strcmp(arg, "--len")==0)
+                                base.vec_len = atoi(argv[i]);
+                            else if (strcmp(arg, "--inst")==0)
+                                base.num_inst = atoi(argv[i]);
+                            else if (strcmp(arg, "--iterations")==0)
+                                iterations = atoi(argv[i]);
+                            else
+                                --i;
                         }
+                        j = len;
                         break;
                     default:
                         break;
@@ -306,46 +547,46 @@ int main(int argc, char **argv)
         }
     }
 
-    signal(SIGSEGV, segv);
-    signal(SIGINT, ctrlc);
-
-    g = shared_graph ? mpr_graph_new(0) : 0;
-
-    if (setup_dst(g, iface)) {
-        printf("Error initializing destination.\n");
-        result = 1;
-        goto done;
+    if (strcmp(base.proto, "local") && strcmp(base.proto, "udp") && strcmp(base.proto, "tcp")) {
+        printf("testspeed.c: unknown protocol '%s'\n", base.proto);
+        return 1;
     }
-
-    if (setup_src(g, iface)) {
-        eprintf("Error initializing source.\n");
-        result = 1;
-        goto done;
+    if (base.num_srcs < 1 || base.num_dsts < 1 || base.num_sigs < 1 || base.vec_len < 1
+        || base.num_inst < 1 || iterations < 1) {
+        printf("testspeed.c: configuration values must be positive\n");
+        return 1;
     }
 
-    wait_local_devs();
+    signal(SIGINT, ctrlc);
+
+    if (sweep)
+        num_configs = build_sweep(&base, configs);
+    else
+        configs[0] = base;
 
-    map_sigs();
+    for (i = 0; i < num_configs && !done; i++) {
+        if (benchmark(&configs[i], &results[i]))
+            result = 1;
+        print_result(&configs[i], &results[i]);
+    }
+    num_configs = i;
 
-    /* start things off */
-    eprintf("STARTING TEST...\n");
-    times[0] = current_time();
-    mpr_sig_set_value(sendsig, counter, 1, MPR_FLT, &value);
-    while (!done) {
-        mpr_dev_poll(src, 0);
-        mpr_dev_poll(dst, 0);
+    if (json_path) {
+        if (!(json = fopen(json_path, "w"))) {
+            printf("Error opening file '%s'.\n", json_path);
+            result = 1;
+        }
+        else {
+            fprintf(json, "{\n  \"version\": \"%s\",\n  \"time\": %ld,\n  \"results\": [",
+                    mpr_get_version(), (long)time(NULL));
+            for (i = 0; i < num_configs; i++)
+                print_json(json, &configs[i], &results[i], 0 == i);
+            fprintf(json, "\n  ]\n}\n");
+            fclose(json);
+        }
     }
-    goto done;
 
-  done:
-    cleanup_dst();
-    cleanup_src();
-    if (g) mpr_graph_free(g);
-    printf("\r..................................................Test %s\x1B[0m.",
+    printf("...................Test %s\x1B[0m.\n",
            result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
-    if (!result)
-        print_results();
-    else
-        printf(".\n");
     return result;
 }
@@ -0,0 +1,315 @@
+#include <mapper/mapper.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <string.h>
+
+/* Check the runtime statistics enabled with mpr_dev_set_stats(), both locally
+ * and as seen by a subscribed graph. */
+
+/* order of the counters in the "@stats" vectors */
+#define DEV_UPDATES_IN      0
+#define DEV_UPDATES_OUT     1
+#define DEV_BUNDLES_SENT    5
+#define MAP_UPDATES_IN      0
+#define MAP_UPDATES_OUT     1
+#define MAP_EVALS           2
+#define MAP_EVAL_TIME_BINS  4
+#define NUM_MAP_STATS       12
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+int period = 100;
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_graph mon = 0;
+mpr_sig sendsig = 0;
+mpr_sig recvsig = 0;
+mpr_map map = 0;
+
+int sent = 0;
+int received = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    if (value)
+        ++received;
+}
+
+/* Retrieve the "@stats" property of an object. */
+const int64_t *get_stats(mpr_obj obj, int *len)
+{
+    mpr_type type;
+    const void *val;
+    if (!mpr_obj_get_prop_by_key(obj, "stats", len, &type, &val, NULL)
+        || MPR_INT64 != type || !val)
+        return 0;
+    return (const int64_t*)val;
+}
+
+int setup(const char *iface)
+{
+    float mn = 0, mx = 1;
+
+    src = mpr_dev_new("teststats-send", 0);
+    dst = mpr_dev_new("teststats-recv", 0);
+    mon = mpr_graph_new(0);
+    if (!src || !dst || !mon)
+        return 1;
+    if (iface) {
+        mpr_graph_set_interface(mpr_obj_get_graph(src), iface);
+        mpr_graph_set_interface(mpr_obj_get_graph(dst), iface);
+        mpr_graph_set_interface(mon, iface);
+    }
+    eprintf("devices created using interface %s.\n",
+            mpr_graph_get_interface(mpr_obj_get_graph(src)));
+
+    sendsig = mpr_sig_new(src, MPR_DIR_OUT, "outsig", 1, MPR_FLT, NULL,
+                          &mn, &mx, NULL, NULL, 0);
+    recvsig = mpr_sig_new(dst, MPR_DIR_IN, "insig", 1, MPR_FLT, NULL,
+                          &mn, &mx, NULL, handler, MPR_SIG_UPDATE);
+
+    /* the source device is enabled after its map exists */
+    if (mpr_dev_set_stats(dst, 1)) {
+        eprintf("Error enabling statistics.\n");
+        return 1;
+    }
+    if (get_stats(src, NULL)) {
+        eprintf("Error: statistics exposed before being enabled.\n");
+        return 1;
+    }
+    return 0;
+}
+
+void cleanup()
+{
+    if (mon) {
+        eprintf("Freeing graph.. ");
+        fflush(stdout);
+        mpr_graph_free(mon);
+        eprintf("ok\n");
+    }
+    if (src) {
+        eprintf("Freeing source.. ");
+        fflush(stdout);
+        mpr_dev_free(src);
+        eprintf("ok\n");
+    }
+    if (dst) {
+        eprintf("Freeing destination.. ");
+        fflush(stdout);
+        mpr_dev_free(dst);
+        eprintf("ok\n");
+    }
+}
+
+void poll_all(int block_ms)
+{
+    mpr_dev_poll(src, 0);
+    mpr_dev_poll(dst, block_ms);
+    mpr_graph_poll(mon, 0);
+}
+
+int setup_map()
+{
+    int loc = MPR_LOC_SRC;
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst)))
+        poll_all(25);
+
+    map = mpr_map_new(1, &sendsig, 1, &recvsig);
+    mpr_obj_set_prop(map, MPR_PROP_EXPR, NULL, 1, MPR_STR, "y=x*0.5", 1);
+    mpr_obj_set_prop(map, MPR_PROP_PROCESS_LOC, NULL, 1, MPR_INT32, &loc, 1);
+    mpr_obj_push(map);
+    while (!done && !mpr_map_get_is_ready(map))
+        poll_all(10);
+
+    if (mpr_dev_set_stats(src, 1)) {
+        eprintf("Error enabling statistics.\n");
+        return 1;
+    }
+    mpr_graph_subscribe(mon, dst, MPR_DEV, -1);
+    return done;
+}
+
+void loop()
+{
+    int i = 0;
+    eprintf("Polling device..\n");
+    while ((!terminate || i < 50) && !done) {
+        float v = (i % 10) * 0.1;
+        mpr_sig_set_value(sendsig, 0, 1, MPR_FLT, &v);
+        ++sent;
+        poll_all(period);
+        i++;
+
+        if (!verbose) {
+            printf("\r  Sent: %4i, Received: %4i   ", sent, received);
+            fflush(stdout);
+        }
+    }
+}
+
+int check_local()
+{
+    int i, len;
+    int64_t binned = 0;
+    const int64_t *stats;
+    mpr_list list;
+
+    stats = get_stats(dst, &len);
+    if (!stats || len < 2 || stats[DEV_UPDATES_IN] != received) {
+        eprintf("Error: destination counted %d updates, received %d.\n",
+                stats ? (int)stats[DEV_UPDATES_IN] : -1, received);
+        return 1;
+    }
+    stats = get_stats(src, &len);
+    if (!stats || len < 2 || stats[DEV_UPDATES_OUT] != sent) {
+        eprintf("Error: source counted %d updates, sent %d.\n",
+                stats ? (int)stats[DEV_UPDATES_OUT] : -1, sent);
+        return 1;
+    }
+
+    list = mpr_dev_get_maps(src, MPR_DIR_OUT);
+    stats = list ? get_stats(*list, &len) : 0;
+    mpr_list_free(list);
+    if (!stats || len != NUM_MAP_STATS || stats[MAP_EVALS] != sent
+        || stats[MAP_UPDATES_IN] != sent || stats[MAP_UPDATES_OUT] != sent) {
+        eprintf("Error: unexpected map statistics.\n");
+        return 1;
+    }
+    for (i = MAP_EVAL_TIME_BINS; i < NUM_MAP_STATS; i++)
+        binned += stats[i];
+    if (binned != stats[MAP_EVALS]) {
+        eprintf("Error: %d evaluations in histogram, expected %d.\n",
+                (int)binned, (int)stats[MAP_EVALS]);
+        return 1;
+    }
+    eprintf("map evaluated %d times\n", (int)stats[MAP_EVALS]);
+
+    stats = get_stats(src, &len);
+    if (stats[DEV_BUNDLES_SENT] < 1 || stats[DEV_BUNDLES_SENT] > sent) {
+        eprintf("Error: source counted %d bundles for %d updates.\n",
+                (int)stats[DEV_BUNDLES_SENT], sent);
+        return 1;
+    }
+    return 0;
+}
+
+int check_remote()
+{
+    int i, len;
+    const int64_t *stats = 0;
+    mpr_dev remote = 0;
+    mpr_list list;
+
+    /* statistics are published every few seconds */
+    for (i = 0; i < 100 && !done; i++) {
+        poll_all(50);
+        list = mpr_graph_get_list(mon, MPR_DEV);
+        while (list) {
+            if (mpr_obj_get_prop_as_int64(*list, MPR_PROP_ID, NULL)
+                == mpr_obj_get_prop_as_int64(dst, MPR_PROP_ID, NULL))
+                remote = (mpr_dev)*list;
+            list = mpr_list_get_next(list);
+        }
+        if (remote && (stats = get_stats(remote, &len)) && stats[DEV_UPDATES_IN] == received)
+            break;
+    }
+    if (!stats || stats[DEV_UPDATES_IN] != received) {
+        eprintf("Error: subscribed graph did not receive statistics.\n");
+        return 1;
+    }
+    eprintf("subscribed graph received statistics\n");
+    return 0;
+}
+
+void ctrlc(int signal)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("teststats.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'f':
+                        period = 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface")==0 && argc>i+1) {
+                            i++;
+                            iface = argv[i];
+                            j = 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup(iface) || setup_map()) {
+        eprintf("Error initializing test.\n");
+        result = 1;
+        goto done;
+    }
+
+    loop();
+
+    /* allow the last updates to arrive */
+    poll_all(100);
+
+    result = check_local() || check_remote();
+
+    if (!received || sent != received) {
+        eprintf("Not all sent messages were received.\n");
+        eprintf("Updated value %d time%s and received %d of them.\n",
+                sent, sent == 1 ? "" : "s", received);
+        result = 1;
+    }
+
+  done:
+    cleanup();
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -0,0 +1,233 @@
+#include <mapper/mapper.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <string.h>
+
+/* Check that a graph which already knows a device from its bus announcements
+ * receives the device's signals and maps when it subscribes with a timeout. */
+
+#define NUM_SIGS 4
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+int period = 50;
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_graph mon = 0;
+mpr_sig sendsigs[NUM_SIGS];
+mpr_sig recvsigs[NUM_SIGS];
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+int setup(const char *iface)
+{
+    int i;
+    char name[32];
+    float mn = 0, mx = 1;
+
+    src = mpr_dev_new("testsubscribe-send", 0);
+    dst = mpr_dev_new("testsubscribe-recv", 0);
+    mon = mpr_graph_new(0);
+    if (!src || !dst || !mon)
+        return 1;
+    if (iface) {
+        mpr_graph_set_interface(mpr_obj_get_graph(src), iface);
+        mpr_graph_set_interface(mpr_obj_get_graph(dst), iface);
+        mpr_graph_set_interface(mon, iface);
+    }
+    eprintf("devices created using interface %s.\n",
+            mpr_graph_get_interface(mpr_obj_get_graph(src)));
+
+    for (i = 0; i < NUM_SIGS; i++) {
+        snprintf(name, 32, "outsig%d", i);
+        sendsigs[i] = mpr_sig_new(src, MPR_DIR_OUT, name, 1, MPR_FLT, NULL,
+                                  &mn, &mx, NULL, NULL, 0);
+        snprintf(name, 32, "insig%d", i);
+        recvsigs[i] = mpr_sig_new(dst, MPR_DIR_IN, name, 1, MPR_FLT, NULL,
+                                  &mn, &mx, NULL, NULL, 0);
+    }
+    return 0;
+}
+
+void cleanup()
+{
+    if (mon) {
+        eprintf("Freeing graph.. ");
+        fflush(stdout);
+        mpr_graph_free(mon);
+        eprintf("ok\n");
+    }
+    if (src) {
+        eprintf("Freeing source.. ");
+        fflush(stdout);
+        mpr_dev_free(src);
+        eprintf("ok\n");
+    }
+    if (dst) {
+        eprintf("Freeing destination.. ");
+        fflush(stdout);
+        mpr_dev_free(dst);
+        eprintf("ok\n");
+    }
+}
+
+void poll_all(int block_ms)
+{
+    mpr_dev_poll(src, 0);
+    mpr_dev_poll(dst, block_ms);
+    mpr_graph_poll(mon, 0);
+}
+
+int setup_maps()
+{
+    int i, num_ready = 0;
+    mpr_map maps[NUM_SIGS];
+
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst)))
+        poll_all(25);
+
+    for (i = 0; i < NUM_SIGS; i++) {
+        maps[i] = mpr_map_new(1, &sendsigs[i], 1, &recvsigs[i]);
+        mpr_obj_push(maps[i]);
+    }
+    while (!done && num_ready < NUM_SIGS) {
+        poll_all(10);
+        for (i = 0, num_ready = 0; i < NUM_SIGS; i++)
+            num_ready += mpr_map_get_is_ready(maps[i]);
+    }
+    eprintf("%d maps established\n", num_ready);
+    return done;
+}
+
+/* Find the graph's copy of the source device once it has been announced on the bus. */
+mpr_dev find_remote()
+{
+    int i;
+    mpr_id id = mpr_obj_get_prop_as_int64(src, MPR_PROP_ID, NULL);
+    for (i = 0; i < 200 && !done; i++) {
+        mpr_list list = mpr_graph_get_list(mon, MPR_DEV);
+        poll_all(period);
+        while (list) {
+            mpr_dev dev = (mpr_dev)*list;
+            list = mpr_list_get_next(list);
+            if (   mpr_obj_get_prop_as_int64(dev, MPR_PROP_ID, NULL) == id
+                && mpr_obj_get_prop_as_int32(dev, MPR_PROP_VERSION, NULL) > 0) {
+                mpr_list_free(list);
+                return dev;
+            }
+        }
+    }
+    return 0;
+}
+
+int check_subscription(mpr_dev remote)
+{
+    int i, num_sigs = 0, num_maps = 0;
+
+    if (mpr_list_get_size(mpr_dev_get_sigs(remote, MPR_DIR_ANY))) {
+        eprintf("Error: graph received signals before subscribing.\n");
+        return 1;
+    }
+    eprintf("graph knows device at version %d, subscribing for 10 seconds\n",
+            mpr_obj_get_prop_as_int32(remote, MPR_PROP_VERSION, NULL));
+    mpr_graph_subscribe(mon, remote, MPR_SIG | MPR_MAP, 10);
+
+    for (i = 0; i < 100 && !done; i++) {
+        poll_all(period);
+        num_sigs = mpr_list_get_size(mpr_dev_get_sigs(remote, MPR_DIR_ANY));
+        num_maps = mpr_list_get_size(mpr_dev_get_maps(remote, MPR_DIR_ANY));
+        if (num_sigs == NUM_SIGS && num_maps == NUM_SIGS)
+            break;
+        if (!terminate && !verbose) {
+            printf("\r  Signals: %2i, Maps: %2i   ", num_sigs, num_maps);
+            fflush(stdout);
+        }
+    }
+    eprintf("graph received %d of %d signals and %d of %d maps\n",
+            num_sigs, NUM_SIGS, num_maps, NUM_SIGS);
+    return num_sigs != NUM_SIGS || num_maps != NUM_SIGS;
+}
+
+void ctrlc(int signal)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+    mpr_dev remote;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testsubscribe.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'f':
+                        period = 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface")==0 && argc>i+1) {
+                            i++;
+                            iface = argv[i];
+                            j = 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup(iface) || setup_maps()) {
+        eprintf("Error initializing test.\n");
+        result = 1;
+        goto done;
+    }
+
+    if (!(remote = find_remote())) {
+        eprintf("Error: graph did not see the source device on the bus.\n");
+        result = 1;
+        goto done;
+    }
+
+    result = check_subscription(remote);
+
+  done:
+    cleanup();
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
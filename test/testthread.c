@@ -249,6 +249,42 @@ void loop2()
     mpr_dev_stop_polling(dst);
 }
 
+void loop3()
+{
+    int count = 0;
+    const char *name = mpr_obj_get_prop_as_str((mpr_obj)sendsig, MPR_PROP_NAME, NULL);
+
+    /* poll both devices from a pool of shared threads */
+    if (mpr_set_poll_threads(2)) {
+        eprintf("Error enabling shared polling threads.\n");
+        done = 1;
+        return;
+    }
+    mpr_dev_start_polling(src);
+    mpr_dev_start_polling(dst);
+
+    while ((!terminate || count < 50) && !done) {
+        eprintf("Updating signal %s to %d\n", name, sent);
+        mpr_sig_set_value(sendsig, 0, 1, MPR_INT32, &sent);
+        expected = sent;
+        sent++;
+        count++;
+
+        if (!verbose) {
+            printf("\r  Sent: %4i, Received: %4i   ", sent, received);
+            fflush(stdout);
+        }
+
+        SLEEP_MS(period * 2);
+    }
+    /* allow the last update to be delivered */
+    SLEEP_MS(100);
+
+    mpr_dev_stop_polling(src);
+    mpr_dev_stop_polling(dst);
+    mpr_set_poll_threads(0);
+}
+
 void segv(int sig)
 {
     printf("\x1B[31m(SEGV)\n\x1B[0m");
@@ -339,6 +375,9 @@ int main(int argc, char **argv)
     // poll device in another thread
     loop2();
 
+    // poll both devices using shared threads
+    loop3();
+
     if (autoconnect && (!received || sent > received)) {
         eprintf("Not all sent messages were received.\n");
         eprintf("Updated value %d time%s and received %d of them.\n",
@@ -0,0 +1,116 @@
+#include <mapper/mapper.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+/* Check that MPR_NOW follows a time source set with mpr_set_time_source() and
+ * that the default clock never goes backwards. */
+
+int verbose = 1;
+int terminate = 0;
+
+mpr_time fake_now = {1000, 0};
+int num_calls = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void fake_clock(mpr_time *t, void *data)
+{
+    ++(*(int*)data);
+    *t = fake_now;
+}
+
+int test_source()
+{
+    mpr_time t;
+    int calls = 0, i;
+
+    mpr_set_time_source(fake_clock, &calls);
+    for (i = 0; i < 10; i++) {
+        mpr_time_add_dbl(&fake_now, 0.25);
+        mpr_time_set(&t, MPR_NOW);
+        if (mpr_time_cmp(t, fake_now)) {
+            eprintf("Error: expected time %f, got %f.\n",
+                    mpr_time_as_dbl(fake_now), mpr_time_as_dbl(t));
+            mpr_set_time_source(NULL, NULL);
+            return 1;
+        }
+    }
+    mpr_set_time_source(NULL, NULL);
+    if (calls != 10) {
+        eprintf("Error: time source called %d times, expected 10.\n", calls);
+        return 1;
+    }
+    mpr_time_set(&t, MPR_NOW);
+    if (calls != 10 || !mpr_time_cmp(t, fake_now)) {
+        eprintf("Error: time source still in use after being removed.\n");
+        return 1;
+    }
+    eprintf("time source ok\n");
+    return 0;
+}
+
+int test_monotonic()
+{
+    mpr_time then, now;
+    int i, num = terminate ? 100000 : 1000000;
+
+    mpr_time_set(&then, MPR_NOW);
+    for (i = 0; i < num; i++) {
+        mpr_time_set(&now, MPR_NOW);
+        if (mpr_time_as_dbl(now) < mpr_time_as_dbl(then)) {
+            eprintf("Error: time went backwards from %f to %f.\n",
+                    mpr_time_as_dbl(then), mpr_time_as_dbl(now));
+            return 1;
+        }
+        then = now;
+    }
+    eprintf("default clock ok after %d reads\n", num);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testtime.c: possible arguments "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    result = test_source() || test_monotonic();
+
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
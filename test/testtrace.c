@@ -0,0 +1,271 @@
+#include <mapper/mapper.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <string.h>
+
+/* Trace updates through a chain of three devices using mpr_dev_set_tracing()
+ * and check the latencies recorded by each hop. */
+
+#define NUM_DEVS 3
+
+/* order of the counters in the "@latency" vector */
+#define NUM_TRACED          0
+#define ORIGIN_US           1
+#define HOP_US              2
+#define ORIGIN_BINS         3
+#define HOP_BINS            13
+#define NUM_LATENCY_STATS   23
+
+int verbose = 1;
+int terminate = 0;
+int done = 0;
+int period = 100;
+
+mpr_dev devs[NUM_DEVS];
+mpr_sig inputs[NUM_DEVS];
+mpr_sig outputs[NUM_DEVS];
+
+int sent = 0;
+int received = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+/* pass updates on to the next device in the chain */
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    int i;
+    if (!value)
+        return;
+    for (i = 1; i < NUM_DEVS; i++) {
+        if (sig != inputs[i])
+            continue;
+        if (outputs[i])
+            mpr_sig_set_value(outputs[i], 0, length, type, value);
+        else
+            ++received;
+    }
+}
+
+int setup(const char *iface)
+{
+    float mn = 0, mx = 1;
+    char name[32];
+    int i;
+
+    for (i = 0; i < NUM_DEVS; i++) {
+        snprintf(name, 32, "testtrace%d", i);
+        devs[i] = mpr_dev_new(name, 0);
+        if (!devs[i])
+            return 1;
+        if (iface)
+            mpr_graph_set_interface(mpr_obj_get_graph(devs[i]), iface);
+        if (mpr_dev_set_tracing(devs[i], 1)) {
+            eprintf("Error enabling tracing.\n");
+            return 1;
+        }
+        inputs[i] = i ? mpr_sig_new(devs[i], MPR_DIR_IN, "insig", 1, MPR_FLT, NULL,
+                                    &mn, &mx, NULL, handler, MPR_SIG_UPDATE) : 0;
+        outputs[i] = i < NUM_DEVS - 1 ? mpr_sig_new(devs[i], MPR_DIR_OUT, "outsig", 1, MPR_FLT,
+                                                    NULL, &mn, &mx, NULL, NULL, 0) : 0;
+    }
+    eprintf("devices created using interface %s.\n",
+            mpr_graph_get_interface(mpr_obj_get_graph(devs[0])));
+    return 0;
+}
+
+void cleanup()
+{
+    int i;
+    for (i = 0; i < NUM_DEVS; i++) {
+        if (!devs[i])
+            continue;
+        eprintf("Freeing device %d.. ", i);
+        fflush(stdout);
+        mpr_dev_free(devs[i]);
+        eprintf("ok\n");
+    }
+}
+
+void poll_all(int block_ms)
+{
+    int i;
+    for (i = 0; i < NUM_DEVS - 1; i++)
+        mpr_dev_poll(devs[i], 0);
+    mpr_dev_poll(devs[NUM_DEVS - 1], block_ms);
+}
+
+int setup_maps()
+{
+    int i, ready = 0;
+    mpr_map maps[NUM_DEVS - 1];
+
+    while (!done && ready < NUM_DEVS) {
+        poll_all(25);
+        for (i = 0, ready = 0; i < NUM_DEVS; i++)
+            ready += mpr_dev_get_is_ready(devs[i]);
+    }
+
+    for (i = 0; i < NUM_DEVS - 1; i++) {
+        maps[i] = mpr_map_new(1, &outputs[i], 1, &inputs[i + 1]);
+        mpr_obj_push(maps[i]);
+    }
+    ready = 0;
+    while (!done && ready < NUM_DEVS - 1) {
+        poll_all(10);
+        for (i = 0, ready = 0; i < NUM_DEVS - 1; i++)
+            ready += mpr_map_get_is_ready(maps[i]);
+    }
+    eprintf("maps initialized\n");
+    return done;
+}
+
+void loop()
+{
+    int i = 0, j;
+    eprintf("Polling devices..\n");
+    while ((!terminate || i < 50) && !done) {
+        float v = (i % 10) * 0.1;
+        mpr_sig_set_value(outputs[0], 0, 1, MPR_FLT, &v);
+        ++sent;
+        /* one poll per hop */
+        for (j = 0; j < NUM_DEVS; j++)
+            poll_all(period / NUM_DEVS);
+        i++;
+
+        if (!verbose) {
+            printf("\r  Sent: %4i, Received: %4i   ", sent, received);
+            fflush(stdout);
+        }
+    }
+}
+
+int check_latency()
+{
+    int i, j, len;
+    int64_t origin, hop;
+    mpr_type type;
+    const void *val;
+    const int64_t *latency;
+
+    for (i = 0; i < NUM_DEVS; i++) {
+        if (!mpr_obj_get_prop_by_key(devs[i], "latency", &len, &type, &val, NULL)
+            || MPR_INT64 != type || NUM_LATENCY_STATS != len) {
+            eprintf("Error: device %d has no latency property.\n", i);
+            return 1;
+        }
+        latency = (const int64_t*)val;
+        if (!i) {
+            /* the first device originates traces but does not receive any */
+            if (latency[NUM_TRACED]) {
+                eprintf("Error: device 0 received %d traces.\n", (int)latency[NUM_TRACED]);
+                return 1;
+            }
+            continue;
+        }
+        for (j = 0, origin = 0, hop = 0; j < HOP_BINS - ORIGIN_BINS; j++) {
+            origin += latency[ORIGIN_BINS + j];
+            hop += latency[HOP_BINS + j];
+        }
+        if (latency[NUM_TRACED] != sent || origin != sent || hop != sent) {
+            eprintf("Error: device %d recorded %d traces, %d and %d in histograms, "
+                    "expected %d.\n", i, (int)latency[NUM_TRACED], (int)origin, (int)hop, sent);
+            return 1;
+        }
+        if (latency[ORIGIN_US] < latency[HOP_US]) {
+            eprintf("Error: device %d latency since origin is shorter than the last hop.\n", i);
+            return 1;
+        }
+        eprintf("device %d: mean latency %.1fus since origin, %.1fus since last hop\n", i,
+                (double)latency[ORIGIN_US] / sent, (double)latency[HOP_US] / sent);
+    }
+    return 0;
+}
+
+void ctrlc(int signal)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -v verbose, -t terminate, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testtrace.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-t terminate automatically, "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'f':
+                        period = 3;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 't':
+                        terminate = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface")==0 && argc>i+1) {
+                            i++;
+                            iface = argv[i];
+                            j = 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup(iface) || setup_maps()) {
+        eprintf("Error initializing test.\n");
+        result = 1;
+        goto done;
+    }
+
+    loop();
+
+    /* allow the last updates to arrive */
+    for (i = 0; i < NUM_DEVS; i++)
+        poll_all(100);
+
+    if (!received || sent != received) {
+        eprintf("Not all sent messages were received.\n");
+        eprintf("Updated value %d time%s and received %d of them.\n",
+                sent, sent == 1 ? "" : "s", received);
+        result = 1;
+    }
+    else
+        result = check_latency();
+
+  done:
+    cleanup();
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}